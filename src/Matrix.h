@@ -1,8 +1,16 @@
 /// @author Sudhanva Kulkarni
 /// Simplke implementation of Varying Layout dense matrix
 
+#pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
 #include "layouts.h"
 
 
@@ -10,39 +18,62 @@ namespace Lo_Gemm {
 
 template<typename T, typename idx, Layout L = ColMajor>
 class Matrix {
-    
+    public:
     idx m;
     idx n;
     idx ld;
     T* data;
     static constexpr Layout layout = L;
     using scalar_type = T;
+    using value_type = T;
+    using index_type = idx;
 
     
-    Matrix(T* data, idx m, idx n, idx ld) : data(data), m(m), n(n), ld(ld) {}
+    Matrix(T* data, idx m, idx n, idx ld) : m(m), n(n), ld(ld), data(data) {}
 
-    constexpr inline T& operator() const (idx row, idx col) {
+    constexpr inline T& operator()(idx row, idx col) const {
        return L == ColMajor ? data[col*ld + row] : data[row*ld + col];
     }
 
+    constexpr inline idx get_idx(idx row, idx col) const {
+        if constexpr (L == ColMajor) return col*ld + row;
+        else return row*ld + col;
+    }
+
+    //view of the r×c block whose top left element is (row, col)
+    constexpr inline Matrix block(idx row, idx col, idx r, idx c) const {
+        return Matrix(data + get_idx(row, col), r, c, ld);
+    }
+
     bool isNaN() const {
-        for(int row = 0; row < m; row++) {
-            for(int col = 0; col < n; col++) {
-                if(isnan((*this)(i,j))) return true;
+        using std::isnan;
+        for(idx row = 0; row < m; row++) {
+            for(idx col = 0; col < n; col++) {
+                if(isnan((*this)(row,col))) return true;
             }
         }
         return false;
     }
 
     bool isInf() const {
-        for(int row = 0; row < m; row++) {
-            for(int col = 0; col < n; col++) {
-                if(isinf((*this)(i,j))) return true;
+        using std::isinf;
+        for(idx row = 0; row < m; row++) {
+            for(idx col = 0; col < n; col++) {
+                if(isinf((*this)(row,col))) return true;
             }
         }
         return false;
     }
 
+    //distance between consecutive rows / columns of the same column / row
+    constexpr inline idx row_stride() const {
+        return L == ColMajor ? static_cast<idx>(1) : ld;
+    }
+
+    constexpr inline idx col_stride() const {
+        return L == ColMajor ? ld : static_cast<idx>(1);
+    }
+
     constexpr inline idx rows() const {
         return this->m;
     }
@@ -55,7 +86,7 @@ class Matrix {
 
 template<typename T, typename idx, typename T_scal , Layout L = ColMajor>
 class MX_Matrix {
-    
+    public:
     idx m;
     idx n;
     idx ld;
@@ -64,61 +95,58 @@ class MX_Matrix {
     T_scal* shared_exps;
     static constexpr Layout layout = L;
     using scalar_type = T;
+    using value_type = T;
+    using index_type = idx;
     using shared_exp_type = T_scal;
 
     
-    MX_Matrix(T* data, T_scal* shared_exp, idx m, idx n, idx ld, idx r) : data(data), shared_exp(shared_exp), m(m), n(n), ld(ld), r(r) {}
+    MX_Matrix(T* data, T_scal* shared_exps, idx m, idx n, idx ld, idx r) : m(m), n(n), ld(ld), r(r), data(data), shared_exps(shared_exps) {}
 
     constexpr inline idx get_idx(idx row, idx col) const {
         if constexpr (L == ColMajor) return col*ld + row;
         else return row*ld + col;
     }
 
-    constexpr inline T& operator() const (idx row, idx col) {
+    constexpr inline T& operator()(idx row, idx col) const {
         return L == ColMajor ? data[col*ld + row] : data[row*ld + col];
     } 
 
     constexpr inline T_scal get_exp(idx row, idx col) const {
         if constexpr (L == Layout::ColMajor) {
-            return T_scal[(col*ld + row)/r];
+            return shared_exps[(col*ld + row)/r];
         } else {
-            return T_scal[(row*ld + col)/r];
+            return shared_exps[(row*ld + col)/r];
         }
     }
 
-    template<typename T>
-    constexpr inline void set_exp(idx row, idx col, T value) const {
+    template<typename V>
+    constexpr inline void set_exp(idx row, idx col, V value) const {
 
         if constexpr (L == Layout::ColMajor) {
-            T_scal[(col*ld + row)/r] = std::is_integral_v<shared_exp_type> ? static_cast<shared_exp_type>(log2(value)) : static_cast<shared_exp_type>(value);
+            shared_exps[(col*ld + row)/r] = std::is_integral_v<shared_exp_type> ? static_cast<shared_exp_type>(std::log2(value)) : static_cast<shared_exp_type>(value);
         } else {
-            T_scal[(row*ld + col)/r] = std::is_integral_v<shared_exp_type> ? static_cast<shared_exp_type>(log2(value)) : static_cast<shared_exp_type>(value);
+            shared_exps[(row*ld + col)/r] = std::is_integral_v<shared_exp_type> ? static_cast<shared_exp_type>(std::log2(value)) : static_cast<shared_exp_type>(value);
         }
     }
 
-    template<typename V>
+    template<typename V = float>
     constexpr inline V scaled_val(idx row, idx col) const {
-        return operator()(row, col) * get_exp(row, col);
-    }
-
-
-    constexpr inline T& operator() const (idx row, idx col) {
-        return L == ColMajor ? data[col*ld + row] : data[row*ld + col];
+        return static_cast<V>(operator()(row, col)) * shared_scale<V>(get_exp(row, col));
     }
 
     bool isNaN() const {
-        for(int row = 0; row < m; row++) {
-            for(int col = 0; col < n; col++) {
-                if(isnan((this)->scaled_val(i,j))) return true;
+        for(idx row = 0; row < m; row++) {
+            for(idx col = 0; col < n; col++) {
+                if(std::isnan(this->scaled_val(row,col))) return true;
             }
         }
         return false;
     }
 
     bool isInf() const {
-        for(int row = 0; row < m; row++) {
-            for(int col = 0; col < n; col++) {
-                if(isinf((this)->scaled_val(i,j))) return true;
+        for(idx row = 0; row < m; row++) {
+            for(idx col = 0; col < n; col++) {
+                if(std::isinf(this->scaled_val(row,col))) return true;
             }
         }
         return false;
@@ -137,103 +165,223 @@ class MX_Matrix {
 
 };
 
-template<typename MatrixA, typename MatrixA_t, int n_block_size, int m_block_size>
+//split storage complex matrix : real and imaginary parts in two arrays of the same shape and leading dimension,
+//each of them a plain Matrix so it can go through the real kernels unchanged
+template<typename T, typename idx, Layout L = ColMajor>
+class ComplexMatrix {
+    public:
+    Matrix<T, idx, L> re;
+    Matrix<T, idx, L> im;
+    static constexpr Layout layout = L;
+    using scalar_type = T;
+    using value_type = T;
+    using index_type = idx;
+    using real_matrix_type = Matrix<T, idx, L>;
+
+    ComplexMatrix(T* re, T* im, idx m, idx n, idx ld) : re(re, m, n, ld), im(im, m, n, ld) {}
+    ComplexMatrix(const Matrix<T, idx, L>& re, const Matrix<T, idx, L>& im) : re(re), im(im) {}
+
+    //value of element (row, col), decoded
+    template<typename V = double>
+    constexpr inline std::complex<V> value(idx row, idx col) const {
+        return std::complex<V>(static_cast<V>(re(row, col)), static_cast<V>(im(row, col)));
+    }
+
+    //rounds v into element (row, col), each part once
+    template<typename V>
+    constexpr inline void set(idx row, idx col, const std::complex<V>& v) const {
+        re(row, col) = static_cast<T>(v.real());
+        im(row, col) = static_cast<T>(v.imag());
+    }
+
+    constexpr inline ComplexMatrix block(idx row, idx col, idx r, idx c) const {
+        return ComplexMatrix(re.block(row, col, r, c), im.block(row, col, r, c));
+    }
+
+    constexpr inline idx rows() const {
+        return re.rows();
+    }
+
+    constexpr inline idx cols() const {
+        return re.cols();
+    }
+
+};
+
+//helper that returns if the format is MX by checking if the type has a shared_exps member
+template<typename T>
+struct is_MX_format {
+    static constexpr bool value = false;
+};
+template<typename T, typename idx, typename T_scal, Layout L>
+struct is_MX_format<MX_Matrix<T, idx, T_scal, L>> {
+    static constexpr bool value = true;
+};
+template<typename T, typename idx, Layout L>
+struct is_MX_format<Matrix<T, idx, L>> {
+    static constexpr bool value = false;
+};
+
+//storage lines (columns for ColMajor, rows for RowMajor) and their length
+template<typename MatrixA>
+constexpr inline auto storage_lines(const MatrixA& A) {
+    return MatrixA::layout == ColMajor ? A.n : A.m;
+}
+template<typename MatrixA>
+constexpr inline auto line_length(const MatrixA& A) {
+    return MatrixA::layout == ColMajor ? A.m : A.n;
+}
+
+//At ← Aᵀ. In the other layout Aᵀ has the storage of A, so it is copied line by line (one memcpy when the leading
+//dimensions agree); in the same layout it is transposed in n_block_size × m_block_size tiles, spread over threads.
+//At must have room for A.n × A.m elements at its leading dimension.
+template<typename MatrixA, typename MatrixA_t, int n_block_size = 64, int m_block_size = 64>
+    requires (!is_MX_format<MatrixA>::value)
 void transpose(MatrixA& A, MatrixA_t& At) {
+    using T_a = typename MatrixA::value_type;
+    using T_t = typename MatrixA_t::value_type;
 
     At.m = A.n;
     At.n = A.m;
-    int n_blocks = (A.n + n_block_size - 1) / n_block_size;
-    int m_blocks = (A.m + m_block_size - 1) / m_block_size;
-    if constexpr (At::layout != A::layout) {
-        //just copy over the data with memcpy
-        std::memcpy(At.data, A.data, A.m*A.n*sizeof(typename MatrixA::value_type));
+    if (A.m == 0 || A.n == 0) return;
+
+    if constexpr (MatrixA_t::layout != MatrixA::layout) {
+        const auto lines = storage_lines(A), len = line_length(A);
+        if constexpr (std::is_same_v<T_a, T_t>) {
+            if (A.ld == At.ld) {
+                std::memcpy(At.data, A.data, ((lines - 1)*A.ld + len)*sizeof(T_a));
+                return;
+            }
+        }
+        #pragma omp parallel for schedule(static)
+        for (int l = 0; l < static_cast<int>(lines); l++) {
+            if constexpr (std::is_same_v<T_a, T_t>)
+                std::memcpy(At.data + l*At.ld, A.data + l*A.ld, len*sizeof(T_a));
+            else
+                for (int p = 0; p < static_cast<int>(len); p++)
+                    At.data[l*At.ld + p] = static_cast<T_t>(A.data[l*A.ld + p]);
+        }
     } else {
-        // block transpose
-        for(int b_row = 0; b_row < n_blocks; b_row++) {
-            for(int b_col = 0; b_col < m_blocks; b_col++) {
-                for(int row = b_row*n_block_size; row < std::min(A.m, row + n_block_size); row++) {
-                    for(int col = b_col*m_block_size; col < std::min(A.n, col + m_block_size); col++) {
-                            At.data[At.get_idx(row, col)] = A.data[A.get_idx(col, row)];
+        const int n_blocks = (At.m + n_block_size - 1) / n_block_size;
+        const int m_blocks = (At.n + m_block_size - 1) / m_block_size;
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (int b_row = 0; b_row < n_blocks; b_row++) {
+            for (int b_col = 0; b_col < m_blocks; b_col++) {
+                const int row_end = std::min<int>(At.m, (b_row + 1)*n_block_size);
+                const int col_end = std::min<int>(At.n, (b_col + 1)*m_block_size);
+                for (int row = b_row*n_block_size; row < row_end; row++) {
+                    for (int col = b_col*m_block_size; col < col_end; col++) {
+                        At.data[At.get_idx(row, col)] = static_cast<T_t>(A.data[A.get_idx(col, row)]);
                     }
                 }
             }
         }
     }
-    
 }
 
 
-//main edge case here is when A.r != At.r
-template<typename MX_MatrixA, typename MX_MatrixAt, int n_block_size, int m_block_size>
+//largest magnitude T holds with either sign, the clamp of MX requantization (formats can spend −max on NaN)
+template<typename T>
+inline float mx_element_limit() {
+    static const float lim = [] {
+        float v = static_cast<float>(std::numeric_limits<T>::max());
+        while (v > 0.0f && static_cast<float>(T(-v)) != -v) {
+            //next T below v : the smallest step down that does not round back to v
+            float below = 0.0f;
+            for (int k = 30; k > 0 && below == 0.0f; k--) {
+                const float c = static_cast<float>(T(v - std::ldexp(v, -k)));
+                if (c < v) below = c;
+            }
+            v = below;
+        }
+        return v;
+    }();
+    return lim;
+}
+
+//At ← Aᵀ for MX matrices, whose blocks are r consecutive elements of a storage line.
+//In the other layout, with the same formats and r, the blocks of Aᵀ are the blocks of A : codes and exponents are
+//copied as they are, line by line or in one memcpy each when the leading dimensions agree. Otherwise the blocks
+//run across those of A, so every block of At gets a new exponent from its amax,
+//    e = clamp(floor(log2(amax)) − emax(T), −127, 127),
+//and its elements are requantized to v·2^(−e), clamped to ±mx_element_limit. This goes over At in
+//n_block_size lines × m_block_size elements tiles (rounded to whole blocks), so the columns of A one tile reads stay
+//in cache, with tiles spread over threads. It needs At.ld % At.r == 0.
+template<typename MX_MatrixA, typename MX_MatrixAt, int n_block_size = 64, int m_block_size = 64>
+    requires is_MX_format<MX_MatrixA>::value
 void transpose(MX_MatrixA& A, MX_MatrixAt& At)
 {
+    using A_type = typename MX_MatrixA::scalar_type;
+    using At_type = typename MX_MatrixAt::scalar_type;
+    using A_scal = typename MX_MatrixA::shared_exp_type;
+    using At_scal = typename MX_MatrixAt::shared_exp_type;
+
     At.m = A.n;
     At.n = A.m;
+    if (A.m == 0 || A.n == 0) return;
+
+    const int lines = static_cast<int>(storage_lines(At)), len = static_cast<int>(line_length(At));
+
+    if constexpr (MX_MatrixA::layout != MX_MatrixAt::layout && std::is_same_v<A_type, At_type>
+                  && std::is_same_v<A_scal, At_scal>) {
+        if (A.r == At.r && (A.ld == At.ld || (A.ld % A.r == 0 && At.ld % At.r == 0))) {
+            if (A.ld == At.ld) {
+                const std::size_t count = static_cast<std::size_t>(lines - 1)*A.ld + len;
+                std::memcpy(At.data, A.data, count*sizeof(A_type));
+                std::memcpy(At.shared_exps, A.shared_exps, (count + A.r - 1)/A.r*sizeof(A_scal));
+                return;
+            }
+            const int exps_per_line = (len + At.r - 1)/At.r;
+            #pragma omp parallel for schedule(static)
+            for (int l = 0; l < lines; l++) {
+                std::memcpy(At.data + l*At.ld, A.data + l*A.ld, len*sizeof(A_type));
+                std::memcpy(At.shared_exps + l*(At.ld/At.r), A.shared_exps + l*(A.ld/A.r), exps_per_line*sizeof(A_scal));
+            }
+            return;
+        }
+    }
 
-    using A_type = MX_MatrixA::scalar_type;
-
-    int n_blocks = (A.n + n_block_size - 1) / n_block_size;
-    int m_blocks = (A.m + m_block_size - 1) / m_block_size;
-
-    if constexpr (A::layout != At::layout) {
-        std::memcpy(At.data, A.data, A.m*A.n*sizeof(typename MatrixA::value_type));
-        if constexpr (A.r = At.r) {
-            std::memcpy(A.shared_exp, At.shared_exp, A.m*A.n*sizeof(typename MatrixA::value_type)/A.r);
-
-        } else {
-            //traverse At and set exponents
-            if constexpr (At::layout == Layout::ColMajor) {
-                for(int i = 0; i < At.n; i++) {
-                    //parallelize with OpenMP
-                    for(int j_block = 0; j_block < At.m/r; j++) {
-                        //find max
-                        auto blk_max = static_cast<A_type>(0.0);
-                        for(int j = j_block*r; j < std::min(At.m, j + r); j++) {
-                            blk_max = std::max(blk_max, At(i,j));
+    assert(At.ld % At.r == 0);
+    const int r = static_cast<int>(At.r);
+    const int emax = std::ilogb(static_cast<double>(std::numeric_limits<At_type>::max()));
+    const float lim = mx_element_limit<At_type>();
+    //whole blocks per tile
+    const int tile = std::max(1, m_block_size / r) * r;
+    const int l_blocks = (lines + n_block_size - 1) / n_block_size;
+    const int p_blocks = (len + tile - 1) / tile;
+
+    #pragma omp parallel
+    {
+        std::vector<float> blk(r);
+
+        #pragma omp for collapse(2) schedule(static)
+        for (int lb = 0; lb < l_blocks; lb++) {
+            for (int pb = 0; pb < p_blocks; pb++) {
+                const int l_end = std::min(lines, (lb + 1)*n_block_size);
+                const int p_end = std::min(len, (pb + 1)*tile);
+                for (int p0 = pb*tile; p0 < p_end; p0 += r) {
+                    for (int l = lb*n_block_size; l < l_end; l++) {
+                        const int c = std::min(r, len - p0);
+                        //At(row, col) = A(col, row)
+                        float amax = 0.0f;
+                        for (int q = 0; q < c; q++) {
+                            const int row = MX_MatrixAt::layout == ColMajor ? p0 + q : l;
+                            const int col = MX_MatrixAt::layout == ColMajor ? l : p0 + q;
+                            blk[q] = A.template scaled_val<float>(col, row);
+                            amax = std::max(amax, std::abs(blk[q]));
                         }
-                        //set blk_max to exp array -
-
-                        
-
-                    }
-                }
-            } else {
-                for(int i = 0; i < At.m; i++) {
-                    for(int j = 0; j < At.n; j++) {
-
+                        int e = (amax > 0.0f && std::isfinite(amax)) ? std::ilogb(amax) - emax : -127;
+                        e = std::clamp(e, -127, 127);
+                        At.shared_exps[(l*At.ld + p0)/r] = store_scale<At_scal>(e);
+                        for (int q = 0; q < c; q++)
+                            At.data[l*At.ld + p0 + q] = static_cast<At_type>(std::clamp(std::ldexp(blk[q], -e), -lim, lim));
                     }
                 }
             }
         }
-    } else {
-
     }
-
-
 }
 
 
 
-//helper that returns if the format is MX by checking if the type has a shared_exps member
-template<typename T>
-struct is_MX_format {
-    static constexpr bool value = false;
-};
-template<typename T, typename idx, typename T_scal, Layout L, MX_Layout MX_L>
-struct is_MX_format<MX_Matrix<T, idx, T_scal, L, MX_L>> {
-    static constexpr bool value = true;
-};
-template<typename T>
-struct is_MX_format<Matrix<T, idx>> {
-    static constexpr bool value = false;
-};
-
-
-
-
-
-
-
-
-
 } //namespace Lo_gemm
\ No newline at end of file
@@ -1,4 +1,273 @@
-// outer prdt based MX GEMM
+///@author Sudhanva Kulkarni
+/// Block scaled GEMM on MX operands : a Goto style NC/KC/MC loop nest whose inner k-loop steps over k-blocks
+/// of constant shared scale, with an 8×8 register tile.
+///
+/// MXGemm computes C ← epi(op(A)·op(B)) straight from MX_Matrix operands. The element codes are decoded
+/// (not scaled) into packed panels, and the shared scales of each packed row of A and column of B are packed
+/// next to them, one per k-block. The micro-kernel accumulates the outer products of one k-block in Accum1
+/// and then adds the block into an Accum2 tile multiplied by sA(i)·sB(j). Operands are never dequantized as a
+/// whole.
+///
+/// A k-block is the largest run of k over which both scales are constant : gcd(rA, rB) when the shared
+/// exponents of op(A) run along its rows and those of op(B) along its columns (row major A / column major B
+/// for NoTrans, the OCP MX arrangement) and each ld is a multiple of r. Any other arrangement still works,
+/// but the scale varies with the element, so it is folded into the packed values (floating point formats
+/// only) and a KC panel is one block.
+///
+/// Integer element types (lo_float::i_n, BFP) have no folded path : run throws std::invalid_argument when their
+/// scales do not run along k.
+///
+/// mx_block_kernel is plain C++ (no x86 or NEON intrinsics), left to the compiler to vectorize, so the file builds
+/// on any target.
+///
+/// Defaults : Accum1 is int32_t for integral element types and the decoded type otherwise, Accum2 is float.
 
-#include <arm_neon.h>
-#include 
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include "Matrix.h"
+#include "cache_info.h"
+#include "gemm_helpers.hpp"
+#include "gemm_epilogue.hpp"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+//  one k-block for an MR×NR tile : t = Σ a⊗b over kb, then C_tile += t·(sA ⊗ sB)
+template<typename T_in, typename T_acc1, typename T_acc2, int MR, int NR>
+static void mx_block_kernel(const T_in* A, const T_in* B, const float* sA, const float* sB,
+                            T_acc2* C, std::size_t kb) noexcept
+{
+    using T_s = std::conditional_t<std::is_same_v<T_acc1, double> || std::is_same_v<T_acc2, double>, double, float>;
+
+    T_acc1 t[MR][NR] = {};
+    for (std::size_t p = 0; p < kb; ++p)
+        for (int i = 0; i < MR; ++i) {
+            const T_in a = A[p*MR + i];
+            for (int j = 0; j < NR; ++j)
+                acc_fma(t[i][j], a, B[p*NR + j]);
+        }
+
+    for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            acc_add(C[i*NR + j], lo_cast<T_s>(t[i][j]) * (static_cast<T_s>(sA[i]) * static_cast<T_s>(sB[j])));
+}
+
+
+template<typename MX_MatrixA, typename MX_MatrixB, typename MatrixC, typename Accum1 = void, typename Accum2 = void>
+class MXGemm {
+    using value_type = typename MX_MatrixA::value_type;
+    using pack_t     = pack_type_t<value_type>;
+    using acc1_t     = default_if_void_t<Accum1, mx_accum1_t<value_type>>;
+    using acc2_t     = default_if_void_t<Accum2, float>;
+
+    static_assert(Lo_Gemm::is_MX_format<MX_MatrixA>::value && Lo_Gemm::is_MX_format<MX_MatrixB>::value,
+                  "MXGemm takes MX_Matrix operands");
+    static_assert(std::is_same_v<value_type, typename MX_MatrixB::value_type>,
+                  "Matrix A and B must hold the same element type");
+
+    static constexpr std::size_t MR = 8;
+    static constexpr std::size_t NR = 8;
+
+    BlockingParams blk_ = blocking_for<pack_t, acc1_t, acc2_t>(MR, NR);
+
+    std::vector<pack_t> Ap_, Bp_;       // decoded codes
+    std::vector<float> As_, Bs_;        // one scale per packed row / column and k-block
+    std::vector<acc2_t> Cw_;
+
+    //  op(X)(i, j) in storage coordinates of X
+    template<typename MX>
+    struct OpView {
+        const MX& X;
+        Lo_Gemm::Op op;
+        value_type code(std::size_t i, std::size_t j) const
+        {
+            using idx = typename MX::index_type;
+            return op == Lo_Gemm::NoTrans ? X(static_cast<idx>(i), static_cast<idx>(j)) : X(static_cast<idx>(j), static_cast<idx>(i));
+        }
+        float scale(std::size_t i, std::size_t j) const
+        {
+            using idx = typename MX::index_type;
+            return Lo_Gemm::shared_scale<float>(op == Lo_Gemm::NoTrans ? X.get_exp(static_cast<idx>(i), static_cast<idx>(j))
+                                                                       : X.get_exp(static_cast<idx>(j), static_cast<idx>(i)));
+        }
+    };
+
+    //  true when the scales of op(X) are constant over aligned runs of r along k
+    template<typename MX>
+    static bool scales_along_k(const MX& X, Lo_Gemm::Op op, bool k_is_col)
+    {
+        const bool k_contiguous = (MX::layout == Lo_Gemm::RowMajor) == ((op == Lo_Gemm::NoTrans) == k_is_col);
+        return k_contiguous && X.r > 0 && X.ld % X.r == 0;
+    }
+
+    template<typename Src>
+    static pack_t decode(const Src& v, float s, bool fold)
+    {
+        if constexpr (std::is_integral_v<pack_t>) { (void)s; (void)fold; return static_cast<pack_t>(v); }
+        else return fold ? static_cast<pack_t>(lo_cast<pack_t>(v) * static_cast<pack_t>(s)) : lo_cast<pack_t>(v);
+    }
+
+    //  op(A)(ic:ic+mc, pc:pc+kc) into MR-row micro panels, scales as [panel][block][MR]
+    static void pack_A(const OpView<MX_MatrixA>& a, pack_t* Ap, float* As, std::size_t ic, std::size_t pc,
+                       std::size_t mc, std::size_t kc, std::size_t kb, bool fold)
+    {
+        const std::size_t nb = (kc + kb - 1) / kb;
+        for (std::size_t ir = 0; ir < mc; ir += MR) {
+            const std::size_t mr = std::min(MR, mc - ir);
+            pack_t* dst = Ap + ir*kc;
+            float* sdst = As + (ir/MR)*nb*MR;
+            for (std::size_t kk = 0; kk < kc; ++kk)
+                for (std::size_t i = 0; i < MR; ++i)
+                    dst[kk*MR + i] = i < mr ? decode(a.code(ic+ir+i, pc+kk), fold ? a.scale(ic+ir+i, pc+kk) : 1.0f, fold) : pack_t{};
+            for (std::size_t q = 0; q < nb; ++q)
+                for (std::size_t i = 0; i < MR; ++i)
+                    sdst[q*MR + i] = (i < mr && !fold) ? a.scale(ic+ir+i, pc + q*kb) : 1.0f;
+        }
+    }
+
+    //  op(B)(pc:pc+kc, jc:jc+nc) into NR-column micro panels, scales as [panel][block][NR]
+    static void pack_B(const OpView<MX_MatrixB>& b, pack_t* Bp, float* Bs, std::size_t pc, std::size_t jc,
+                       std::size_t kc, std::size_t nc, std::size_t kb, bool fold)
+    {
+        const std::size_t nb = (kc + kb - 1) / kb;
+        for (std::size_t jr = 0; jr < nc; jr += NR) {
+            const std::size_t nr = std::min(NR, nc - jr);
+            pack_t* dst = Bp + jr*kc;
+            float* sdst = Bs + (jr/NR)*nb*NR;
+            for (std::size_t kk = 0; kk < kc; ++kk)
+                for (std::size_t j = 0; j < NR; ++j)
+                    dst[kk*NR + j] = j < nr ? decode(b.code(pc+kk, jc+jr+j), fold ? b.scale(pc+kk, jc+jr+j) : 1.0f, fold) : pack_t{};
+            for (std::size_t q = 0; q < nb; ++q)
+                for (std::size_t j = 0; j < NR; ++j)
+                    sdst[q*NR + j] = (j < nr && !fold) ? b.scale(pc + q*kb, jc+jr+j) : 1.0f;
+        }
+    }
+
+    static constexpr std::size_t round_up(std::size_t x, std::size_t r) { return (x + r - 1) / r * r; }
+
+public:
+    using input_type = value_type;
+    using accum1_type = acc1_t;
+    using accum2_type = acc2_t;
+
+    MXGemm() = default;
+
+    const BlockingParams& blocking() const noexcept { return blk_; }
+    void set_blocking(const BlockingParams& b) noexcept
+    {
+        blk_ = {std::max(b.MC / MR * MR, MR), std::max<std::size_t>(b.KC, 1), std::max(b.NC / NR * NR, NR)};
+    }
+
+    void run(MatrixC& C, const MX_MatrixA& A, const MX_MatrixB& B,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        epilogue_for_t<acc2_t, typename MatrixC::value_type> epi;
+        run(C, A, B, epi, opA, opB);
+    }
+
+    template<typename Epi>
+    void run(MatrixC& C, const MX_MatrixA& A, const MX_MatrixB& B, Epi& epi,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        const std::size_t m = opA == Lo_Gemm::NoTrans ? A.rows() : A.cols();
+        const std::size_t n = opB == Lo_Gemm::NoTrans ? B.cols() : B.rows();
+        const std::size_t k = opA == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+        if (m == 0 || n == 0) return;
+
+        const OpView<MX_MatrixA> a{A, opA};
+        const OpView<MX_MatrixB> b{B, opB};
+
+        //  k-block : common run of constant scales, or one KC panel with the scales folded in
+        const bool blocked = scales_along_k(A, opA, true) && scales_along_k(B, opB, false);
+        //  an integer code times a scale is not an integer, so integer operands cannot fold their scales
+        if (!blocked && std::is_integral_v<pack_t>)
+            throw std::invalid_argument("MXGemm : integer MX operands need their scales along k (row major op(A), "
+                                        "column major op(B), ld a multiple of r)");
+        const bool fold = !blocked;
+
+        std::size_t KC = blk_.KC;
+        std::size_t kb = KC;
+        if (blocked) {
+            kb = std::gcd(static_cast<std::size_t>(A.r), static_cast<std::size_t>(B.r));
+            KC = std::max(KC / kb, std::size_t{1}) * kb;
+        }
+        const std::size_t MC = blk_.MC;
+        const std::size_t NC = blk_.NC;
+        const std::size_t kmax = std::min(KC, std::max<std::size_t>(k, 1));
+        const std::size_t kbmax = std::min(kb, kmax);
+        const std::size_t nbmax = (kmax + kbmax - 1) / kbmax;
+        const std::size_t k_panels = std::max<std::size_t>(1, (k + KC - 1) / KC);
+
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        const std::size_t ap_size = round_up(std::min(MC, m), MR) * kmax;
+        const std::size_t as_size = round_up(std::min(MC, m), MR) * nbmax;
+        Bp_.resize(round_up(std::min(NC, n), NR) * kmax);
+        Bs_.resize(round_up(std::min(NC, n), NR) * nbmax);
+        Ap_.resize(ap_size * nt);
+        As_.resize(as_size * nt);
+
+        for (std::size_t jc = 0; jc < n; jc += NC)
+        {
+            const std::size_t nc = std::min(NC, n - jc);
+            if (k_panels > 1) Cw_.assign(m*nc, acc2_t{});
+
+            for (std::size_t p = 0; p < k_panels; ++p)
+            {
+                const std::size_t pc = p*KC;
+                const std::size_t kc = std::min(KC, k - pc);
+                const std::size_t kbc = std::min(kb, std::max<std::size_t>(kc, 1));
+                const std::size_t nb = (kc + kbc - 1) / kbc;
+                const bool last = (p + 1 == k_panels);
+
+                pack_B(b, Bp_.data(), Bs_.data(), pc, jc, kc, nc, kbc, fold);
+
+                #pragma omp parallel for schedule(dynamic)
+                for (std::size_t ic = 0; ic < m; ic += MC)
+                {
+                    const std::size_t mc = std::min(MC, m - ic);
+                    const std::size_t t = static_cast<std::size_t>(thread_id());
+                    pack_t* Ap = Ap_.data() + t*ap_size;
+                    float* As = As_.data() + t*as_size;
+                    pack_A(a, Ap, As, ic, pc, mc, kc, kbc, fold);
+
+                    for (std::size_t jr = 0; jr < nc; jr += NR) {
+                        const std::size_t nr = std::min(NR, nc - jr);
+                        for (std::size_t ir = 0; ir < mc; ir += MR) {
+                            const std::size_t mr = std::min(MR, mc - ir);
+                            acc2_t* W = (k_panels > 1) ? &Cw_[(ic+ir)*nc + jr] : nullptr;
+
+                            acc2_t tile[MR*NR];
+                            for (std::size_t i = 0; i < MR; ++i)
+                                for (std::size_t j = 0; j < NR; ++j)
+                                    tile[i*NR + j] = (W && i < mr && j < nr) ? W[i*nc + j] : acc2_t{};
+
+                            for (std::size_t q = 0; q < nb; ++q) {
+                                const std::size_t k0 = q*kbc;
+                                mx_block_kernel<pack_t, acc1_t, acc2_t, MR, NR>(
+                                    &Ap[ir*kc + k0*MR], &Bp_[jr*kc + k0*NR],
+                                    &As[(ir/MR)*nb*MR + q*MR], &Bs_[(jr/NR)*nb*NR + q*NR],
+                                    tile, std::min(kbc, kc - k0));
+                            }
+
+                            if (last) {
+                                epi.apply(tile, NR, ic+ir, jc+jr, mr, nr, C);
+                            } else {
+                                for (std::size_t i = 0; i < mr; ++i)
+                                    for (std::size_t j = 0; j < nr; ++j)
+                                        W[i*nc + j] = tile[i*NR + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace LoGemm
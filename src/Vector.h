@@ -1,6 +1,7 @@
 /// @author Sudhanva Kulkarni
 /// Simple implementation of Vector and MXVector objects
 
+#pragma once
 
 #include <cassert>
 #include "layouts.h"
@@ -16,15 +17,31 @@ class Vector {
     idx stride;
 
     public:
-    Vector(T* data, idx m, idx stride = static_cast<idx>(1)) : data(data), m(m), stride(stride) {}
+    using scalar_type = T;
+    using value_type = T;
+    using index_type = idx;
 
-    constexpr inline T& operator[] const (idx i) {
+    Vector(T* data, idx m, idx stride = static_cast<idx>(1)) : m(m), data(data), stride(stride) {}
+
+    constexpr inline T& operator[](idx i) const {
         return data[i*stride];
     }
 
-    constexpr inline T& operator() const (idx i) {
+    constexpr inline T& operator()(idx i) const {
         return data[i*stride];
     }   
+
+    constexpr inline idx size() const {
+        return m;
+    }
+
+    constexpr inline idx inc() const {
+        return stride;
+    }
+
+    constexpr inline T* ptr() const {
+        return data;
+    }
     
 
 };
@@ -40,14 +57,39 @@ class MX_Vector {
     T* data;
 
     public:
-    MX_Vector(T* data, T_scal* shared_exps, idx m, idx n, idx stride = static_cast<idx>(1), idx r1 = static_cast<idx>(1)) : data(data), shared_exps(shared_exps), m(m), n(n), stride(stride), r1(r1) {}
+    using scalar_type = T;
+    using value_type = T;
+    using index_type = idx;
+    using shared_exp_type = T_scal;
 
-    constexpr inline T& operator[] const (idx i) {
+    MX_Vector(T* data, T_scal* shared_exps, idx m, idx n, idx stride = static_cast<idx>(1), idx r1 = static_cast<idx>(1)) : m(m), n(n), stride(stride), r1(r1), shared_exps(shared_exps), data(data) {}
+
+    constexpr inline T& operator[](idx i) const {
         return data[i*stride];
     }
 
-    constexpr inline T& operator() const (idx i) {
-        return data[i*stride] * shared_exps[i/r1];
+    constexpr inline float operator()(idx i) const {
+        return static_cast<float>(data[i*stride]) * shared_scale<float>(shared_exps[i/r1]);
+    }
+
+    constexpr inline idx size() const {
+        return m;
+    }
+
+    constexpr inline idx inc() const {
+        return stride;
+    }
+
+    constexpr inline T* ptr() const {
+        return data;
+    }
+
+    constexpr inline T_scal* exps() const {
+        return shared_exps;
+    }
+
+    constexpr inline idx block_size() const {
+        return r1;
     }
 
 };
@@ -0,0 +1,379 @@
+///@author Sudhanva Kulkarni
+/// Adaptive precision storage : the matrix is cut into tm×tn tiles and every tile is stored in the narrowest of a
+/// list of formats (narrowest first, e.g. float4_e2m1, float6_e3m2, float8_e4m3_fn, bfloat16) that keeps every
+/// element within
+///     |x − x̂| ≤ rtol·|x| + atol·amax_tile
+/// with one power of two exponent per tile as MX does (mx_quantize's rule, x̂ = 2^e·q). The relative part is what
+/// ties the choice to the dynamic range of the tile : a format holds it only if the smallest elements still land
+/// above its subnormals. Tiles that no format meets take the last one. Each tile has an 8 byte header (byte offset of its codes, format index, exponent) and its
+/// codes bit packed at the width of its format (two e2m1 per byte, four e3m2 per three bytes, ...), elements in
+/// the layout L of the matrix within the tile, tiles in layout L order of the tile grid. Smooth regions of a
+/// tensor so go down to 4 bits while a tile with outliers keeps 8 or 16, and bytes() is what is read back.
+/// adaptive_quantize tries the formats on a tile in a buffer (quantize_block, so the SIMD encoders of
+/// mx_quantize.hpp), packs the chosen codes per tile and lays the tiles out after a prefix sum of their sizes.
+/// adaptive_decode unpacks and decodes a tile at a time (eight lookups per AVX2 gather for the 8 bit and narrower
+/// formats) and adaptive_gemm multiplies with A decoded one row of tiles at a time into a float panel, whatever
+/// the formats of its tiles, which then goes through LoGemm::Gemm with the epilogue applied to that block of C.
+/// Tiles are spread over threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "gemm_epilogue.hpp"
+#include "gemm_helpers.hpp"
+#include "gemms.hpp"
+#include "lo_float.h"
+#include "mx_quantize.hpp"
+
+namespace LoGemm {
+
+namespace adaptive_internal {
+
+//  f(std::type_identity<F>{}) for format number fi of the list
+template<typename... Formats, typename Fn>
+inline void with_format(std::size_t fi, Fn&& f)
+{
+    std::size_t i = 0;
+    (void)((i++ == fi ? (f(std::type_identity<Formats>{}), true) : false) || ...);
+}
+
+//  code k of a tile at bits [k·b, k·b + b) of its bytes, low bits first
+inline uint32_t get_code(const uint8_t* src, std::size_t k, int b) noexcept
+{
+    const std::size_t bit = k*static_cast<std::size_t>(b);
+    uint32_t w = 0;
+    std::memcpy(&w, src + bit/8, std::min<std::size_t>(4, (bit % 8 + b + 7) / 8));
+    return (w >> (bit % 8)) & ((1u << b) - 1u);
+}
+
+inline void pack_codes(const uint16_t* codes, std::size_t n, int b, uint8_t* dst) noexcept
+{
+    if (b == 8) {
+        for (std::size_t k = 0; k < n; ++k) dst[k] = static_cast<uint8_t>(codes[k]);
+    } else if (b == 16) {
+        std::memcpy(dst, codes, 2*n);
+    } else {
+        uint64_t acc = 0;
+        int have = 0;
+        for (std::size_t k = 0; k < n; ++k) {
+            acc |= static_cast<uint64_t>(codes[k] & ((1u << b) - 1u)) << have;
+            have += b;
+            while (have >= 8) { *dst++ = static_cast<uint8_t>(acc); acc >>= 8; have -= 8; }
+        }
+        if (have > 0) *dst = static_cast<uint8_t>(acc);
+    }
+}
+
+inline void unpack_codes(const uint8_t* src, std::size_t n, int b, uint16_t* codes) noexcept
+{
+    if (b == 8) {
+        for (std::size_t k = 0; k < n; ++k) codes[k] = src[k];
+    } else if (b == 16) {
+        std::memcpy(codes, src, 2*n);
+    } else if (b == 4) {
+        for (std::size_t k = 0; k < n; ++k) codes[k] = static_cast<uint16_t>((src[k/2] >> (4*(k & 1))) & 0x0F);
+    } else {
+        uint64_t acc = 0;
+        int have = 0;
+        const uint32_t mask = (1u << b) - 1u;
+        for (std::size_t k = 0; k < n; ++k) {
+            while (have < b) { acc |= static_cast<uint64_t>(*src++) << have; have += 8; }
+            codes[k] = static_cast<uint16_t>(acc & mask);
+            acc >>= b;
+            have -= b;
+        }
+    }
+}
+
+//  out[k] ← s·value of codes[k] in F
+template<typename F>
+inline void decode_codes(const uint16_t* codes, std::size_t n, float s, float* out) noexcept
+{
+    std::size_t k = 0;
+    if constexpr (has_decode_table_v<F>) {
+        const float* lut = decode_table<F>();
+#if defined(__AVX2__)
+        const __m256 vs = _mm256_set1_ps(s);
+        for (; k + 8 <= n; k += 8) {
+            const __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + k)));
+            _mm256_storeu_ps(out + k, _mm256_mul_ps(_mm256_i32gather_ps(lut, c, 4), vs));
+        }
+#endif
+        for (; k < n; ++k) out[k] = lut[codes[k]] * s;
+    } else {
+        for (; k < n; ++k) out[k] = static_cast<float>(F::FromRep(codes[k])) * s;
+    }
+}
+
+template<typename F>
+inline uint16_t code_bits(const F& q) noexcept
+{
+    return static_cast<uint16_t>(q.rep());
+}
+
+} // namespace adaptive_internal
+
+} // namespace LoGemm
+
+
+namespace Lo_Gemm {
+
+//per tile header : byte offset of the packed codes, index of the format in the list, shared exponent
+struct TileHeader {
+    uint32_t offset;
+    uint8_t format;
+    int8_t exp;
+};
+
+template<typename idx, Layout L, typename... Formats>
+class Adaptive_Matrix {
+    static_assert(sizeof...(Formats) > 0 && sizeof...(Formats) < 256, "Adaptive_Matrix needs 1 to 255 formats");
+    static_assert(((Formats::bitwidth <= 16) && ...), "formats of at most 16 bits");
+
+    public:
+    idx m;
+    idx n;
+    idx tm;     //rows per tile
+    idx tn;     //columns per tile
+    std::vector<TileHeader> headers;
+    std::vector<uint8_t> payload;
+    static constexpr Layout layout = L;
+    using value_type = float;
+    using index_type = idx;
+
+    static constexpr std::size_t format_count = sizeof...(Formats);
+    static constexpr int format_bits[sizeof...(Formats)] = {Formats::bitwidth...};
+
+    Adaptive_Matrix(idx m, idx n, idx tm = static_cast<idx>(32), idx tn = static_cast<idx>(32))
+        : m(m), n(n), tm(tm), tn(tn), headers(tile_count()) {}
+
+    constexpr inline idx tile_rows() const { return (m + tm - 1) / tm; }
+    constexpr inline idx tile_cols() const { return (n + tn - 1) / tn; }
+    constexpr inline std::size_t tile_count() const {
+        return static_cast<std::size_t>(tile_rows()) * static_cast<std::size_t>(tile_cols());
+    }
+
+    //tile (ti, tj) of the grid
+    constexpr inline std::size_t tile_index(idx ti, idx tj) const {
+        if constexpr (L == ColMajor) return static_cast<std::size_t>(tj)*tile_rows() + ti;
+        else return static_cast<std::size_t>(ti)*tile_cols() + tj;
+    }
+
+    //rows and columns of tile (ti, tj), smaller at the bottom and right edges
+    constexpr inline idx tile_m(idx ti) const { return std::min(tm, m - ti*tm); }
+    constexpr inline idx tile_n(idx tj) const { return std::min(tn, n - tj*tn); }
+
+    //position of element (i, j) of a r×c tile in its storage order
+    static constexpr inline std::size_t tile_offset(idx i, idx j, idx r, idx c) {
+        if constexpr (L == ColMajor) return static_cast<std::size_t>(j)*r + i;
+        else return static_cast<std::size_t>(i)*c + j;
+    }
+
+    static constexpr std::size_t packed_bytes(std::size_t count, int bits) {
+        return (count*static_cast<std::size_t>(bits) + 7) / 8;
+    }
+
+    const TileHeader& header(idx row, idx col) const {
+        return headers[tile_index(row / tm, col / tn)];
+    }
+
+    //storage of the codes and headers
+    std::size_t bytes() const {
+        return payload.size() + headers.size()*sizeof(TileHeader);
+    }
+
+    //the element (i, j), decoded on its own (adaptive_decode for bulk access)
+    float operator()(idx row, idx col) const {
+        const idx ti = row / tm, tj = col / tn;
+        const TileHeader& h = headers[tile_index(ti, tj)];
+        const std::size_t k = tile_offset(row - ti*tm, col - tj*tn, tile_m(ti), tile_n(tj));
+        const uint16_t code = static_cast<uint16_t>(LoGemm::adaptive_internal::get_code(payload.data() + h.offset, k, format_bits[h.format]));
+        float v = 0.0f;
+        LoGemm::adaptive_internal::with_format<Formats...>(h.format, [&](auto tag) {
+            LoGemm::adaptive_internal::decode_codes<typename decltype(tag)::type>(&code, 1, std::ldexp(1.0f, h.exp), &v);
+        });
+        return v;
+    }
+
+    constexpr inline idx rows() const {
+        return this->m;
+    }
+
+    constexpr inline idx cols() const {
+        return this->n;
+    }
+};
+
+} //namespace Lo_Gemm
+
+
+namespace LoGemm {
+
+//---------------------------------------------------------------------
+//  A ← X, every tile in the narrowest format of the list with        //
+//  |x − x̂| ≤ rtol·|x| + atol·amax of the tile for all its elements.  //
+//  X is any Lo_Gemm::Matrix of the shape of A.                        //
+//---------------------------------------------------------------------
+template<typename MatrixX, typename idx, Lo_Gemm::Layout L, typename... Formats>
+void adaptive_quantize(const MatrixX& X, Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>& A, float rtol, float atol = 0.0f)
+{
+    using namespace adaptive_internal;
+    using AM = Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>;
+    const std::size_t tiles = A.tile_count();
+    const std::size_t tsize = static_cast<std::size_t>(A.tm) * static_cast<std::size_t>(A.tn);
+    A.headers.assign(tiles, Lo_Gemm::TileHeader{0, 0, 0});
+    std::vector<std::vector<uint8_t>> packed(tiles);
+
+    const auto* xd = X.data;
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(tsize), back(tsize);
+        std::vector<uint16_t> codes(tsize);
+
+        #pragma omp for schedule(dynamic)
+        for (std::size_t t = 0; t < tiles; ++t) {
+            const idx ti = static_cast<idx>(L == Lo_Gemm::ColMajor ? t % A.tile_rows() : t / A.tile_cols());
+            const idx tj = static_cast<idx>(L == Lo_Gemm::ColMajor ? t / A.tile_rows() : t % A.tile_cols());
+            const idx r = A.tile_m(ti), c = A.tile_n(tj);
+            const std::size_t len = static_cast<std::size_t>(r)*c;
+
+            //  the tile in its storage order
+            const auto* x0 = xd + static_cast<std::ptrdiff_t>(ti*A.tm)*xrs + static_cast<std::ptrdiff_t>(tj*A.tn)*xcs;
+            if constexpr (L == Lo_Gemm::ColMajor)
+                for (idx j = 0; j < c; ++j) decode_n(x0 + j*xcs, xrs, buf.data() + static_cast<std::size_t>(j)*r, r);
+            else
+                for (idx i = 0; i < r; ++i) decode_n(x0 + i*xrs, xcs, buf.data() + static_cast<std::size_t>(i)*c, c);
+            const float floor = atol * mx_internal::block_amax(buf.data(), len);
+
+            std::size_t fi = 0;
+            int e = 0;
+            bool done = false;
+            auto attempt = [&](auto tag) {
+                using F = typename decltype(tag)::type;
+                if (done) return;
+                std::vector<F> q(len);
+                e = mx_internal::quantize_block(buf.data(), len, q.data());
+                for (std::size_t k = 0; k < len; ++k) codes[k] = code_bits(q[k]);
+                decode_codes<F>(codes.data(), len, std::ldexp(1.0f, e), back.data());
+                bool fits = true;
+                for (std::size_t k = 0; k < len; ++k) fits &= std::abs(back[k] - buf[k]) <= rtol*std::abs(buf[k]) + floor;
+                done = fits || fi + 1 == AM::format_count;
+                if (!done) ++fi;
+            };
+            (attempt(std::type_identity<Formats>{}), ...);
+
+            packed[t].resize(AM::packed_bytes(len, AM::format_bits[fi]));
+            pack_codes(codes.data(), len, AM::format_bits[fi], packed[t].data());
+            A.headers[t].format = static_cast<uint8_t>(fi);
+            A.headers[t].exp = static_cast<int8_t>(e);
+        }
+    }
+
+    std::size_t total = 0;
+    for (std::size_t t = 0; t < tiles; ++t) {
+        A.headers[t].offset = static_cast<uint32_t>(total);
+        total += packed[t].size();
+    }
+    assert(total <= UINT32_MAX);
+    //  4 bytes of slack so get_code may read a whole word at the end
+    A.payload.assign(total + 4, 0);
+    #pragma omp parallel for schedule(static)
+    for (std::size_t t = 0; t < tiles; ++t)
+        if (!packed[t].empty()) std::memcpy(A.payload.data() + A.headers[t].offset, packed[t].data(), packed[t].size());
+}
+
+//  the decoded tile t of A into out, in the storage order of the tile
+template<typename idx, Lo_Gemm::Layout L, typename... Formats>
+void adaptive_decode_tile(const Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>& A, std::size_t t, float* out, uint16_t* codes)
+{
+    using AM = Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>;
+    const idx ti = static_cast<idx>(L == Lo_Gemm::ColMajor ? t % A.tile_rows() : t / A.tile_cols());
+    const idx tj = static_cast<idx>(L == Lo_Gemm::ColMajor ? t / A.tile_rows() : t % A.tile_cols());
+    const std::size_t len = static_cast<std::size_t>(A.tile_m(ti))*A.tile_n(tj);
+    const Lo_Gemm::TileHeader h = A.headers[t];
+    adaptive_internal::unpack_codes(A.payload.data() + h.offset, len, AM::format_bits[h.format], codes);
+    const float s = std::ldexp(1.0f, h.exp);
+    adaptive_internal::with_format<Formats...>(h.format, [&](auto tag) {
+        adaptive_internal::decode_codes<typename decltype(tag)::type>(codes, len, s, out);
+    });
+}
+
+//  X ← A, rounded into the format of X
+template<typename idx, Lo_Gemm::Layout L, typename... Formats, typename MatrixX>
+void adaptive_decode(const Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>& A, MatrixX& X)
+{
+    using T_x = typename MatrixX::value_type;
+    const std::size_t tsize = static_cast<std::size_t>(A.tm) * static_cast<std::size_t>(A.tn);
+    auto* xd = X.data;
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(tsize);
+        std::vector<uint16_t> codes(tsize);
+
+        #pragma omp for schedule(static)
+        for (std::size_t t = 0; t < A.tile_count(); ++t) {
+            adaptive_decode_tile(A, t, buf.data(), codes.data());
+            const idx ti = static_cast<idx>(L == Lo_Gemm::ColMajor ? t % A.tile_rows() : t / A.tile_cols());
+            const idx tj = static_cast<idx>(L == Lo_Gemm::ColMajor ? t / A.tile_rows() : t % A.tile_cols());
+            const idx r = A.tile_m(ti), c = A.tile_n(tj);
+            auto* x0 = xd + static_cast<std::ptrdiff_t>(ti*A.tm)*xrs + static_cast<std::ptrdiff_t>(tj*A.tn)*xcs;
+            for (idx i = 0; i < r; ++i)
+                for (idx j = 0; j < c; ++j)
+                    x0[i*xrs + j*xcs] = lo_cast<T_x>(buf[A.tile_offset(i, j, r, c)]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+//  C ← epi(A·B), A adaptive, B a float Lo_Gemm::Matrix. A is decoded  //
+//  a row of tiles at a time into a row major float panel, which is    //
+//  multiplied by B with LoGemm::Gemm into the matching rows of C.     //
+//---------------------------------------------------------------------
+template<typename MatrixC, typename idx, Lo_Gemm::Layout L, typename... Formats, typename MatrixB, typename Epi>
+void adaptive_gemm(MatrixC& C, const Lo_Gemm::Adaptive_Matrix<idx, L, Formats...>& A, const MatrixB& B, Epi& epi)
+{
+    static_assert(std::is_same_v<typename MatrixB::value_type, float>, "adaptive_gemm multiplies by a float B");
+    using Panel = Lo_Gemm::Matrix<float, idx, Lo_Gemm::RowMajor>;
+    const idx k = A.cols();
+    assert(B.rows() == k && C.rows() == A.rows() && C.cols() == B.cols());
+
+    const std::size_t tsize = static_cast<std::size_t>(A.tm) * static_cast<std::size_t>(A.tn);
+    std::vector<float> panel(static_cast<std::size_t>(A.tm) * static_cast<std::size_t>(k));
+    Gemm<Panel, MatrixB, MatrixC> gemm;
+
+    for (idx ti = 0; ti < A.tile_rows(); ++ti) {
+        const idx r = A.tile_m(ti);
+        #pragma omp parallel
+        {
+            std::vector<float> buf(tsize);
+            std::vector<uint16_t> codes(tsize);
+
+            #pragma omp for schedule(static)
+            for (idx tj = 0; tj < A.tile_cols(); ++tj) {
+                const idx c = A.tile_n(tj);
+                adaptive_decode_tile(A, A.tile_index(ti, tj), buf.data(), codes.data());
+                for (idx i = 0; i < r; ++i)
+                    for (idx j = 0; j < c; ++j)
+                        panel[static_cast<std::size_t>(i)*k + tj*A.tn + j] = buf[A.tile_offset(i, j, r, c)];
+            }
+        }
+        Panel P(panel.data(), r, k, k);
+        MatrixC Cb = C.block(ti*A.tm, 0, r, C.cols());
+        OffsetEpilogue<Epi, MatrixC> strip{epi, C, static_cast<std::size_t>(ti*A.tm), 0};
+        gemm.run(Cb, P, B, strip);
+    }
+}
+
+} // namespace LoGemm
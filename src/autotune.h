@@ -1,2 +1,130 @@
 //@author Sudhanva Kulkarni
-// file for autotuning GEMMs
\ No newline at end of file
+// file for autotuning GEMMs
+//
+// Autotuner benchmarks every registered micro-kernel (and with it every MR×NR) for one problem, then sweeps
+// KC/MC around the cache derived blocking of the fastest kernel. The winner is recorded in the tuning
+// database under (input format, accumulator policy, shape class, thread count) and the database is saved, so
+// later processes pick it up in Gemm::run without measuring again.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+struct TuneOptions {
+    int reps = 3;                   // timed runs per candidate, the fastest counts
+    bool sweep_blocking = true;     // second stage : scale KC and MC of the best kernel
+    bool save = true;               // write the database once the winner is recorded
+};
+
+template<typename MatrixA, typename MatrixB, typename MatrixC, typename Accum1 = void, typename Accum2 = void>
+class Autotuner {
+    using GemmT = Gemm<MatrixA, MatrixB, MatrixC, Accum1, Accum2>;
+    using pack_t = pack_type_t<typename GemmT::input_type>;
+    using acc1_t = typename GemmT::accum1_type;
+    using acc2_t = typename GemmT::accum2_type;
+
+    TuningDatabase& db_;
+
+    template<typename Mat>
+    static Mat make_matrix(std::vector<typename Mat::value_type>& buf, std::size_t r, std::size_t c, std::mt19937& gen)
+    {
+        using idx = typename Mat::index_type;
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        buf.resize(std::max<std::size_t>(r*c, 1));
+        for (auto& x : buf) x = lo_cast<typename Mat::value_type>(dist(gen));
+        const std::size_t ld = Mat::layout == Lo_Gemm::ColMajor ? r : c;
+        return Mat(buf.data(), static_cast<idx>(r), static_cast<idx>(c), static_cast<idx>(std::max<std::size_t>(ld, 1)));
+    }
+
+    //  best of reps, in GFLOP/s; 0 when no run gave a usable time (a clock too coarse for the problem)
+    static double measure(GemmT& gemm, MatrixC& C, const MatrixA& A, const MatrixB& B,
+                          std::size_t m, std::size_t n, std::size_t k, int reps)
+    {
+        epilogue_for_t<acc2_t, typename MatrixC::value_type> epi;
+        epi.beta = 0.0f;
+        double best = 0.0;
+        for (int r = 0; r < std::max(reps, 1); ++r) {
+            auto t0 = std::chrono::steady_clock::now();
+            gemm.run(C, A, B, epi);
+            auto t1 = std::chrono::steady_clock::now();
+            const double s = std::chrono::duration<double>(t1 - t0).count();
+            const double gflops = 2.0*m*n*k / s * 1e-9;
+            if (s > 0.0 && std::isfinite(gflops)) best = std::max(best, gflops);
+        }
+        return best;
+    }
+
+public:
+    explicit Autotuner(TuningDatabase& db = tuning_database()) : db_(db) {}
+
+    //  tunes one problem size; the result applies to its whole shape class. Only a winner with a measured
+    //  rate and complete blocking is recorded; otherwise the derived default is returned and nothing is saved.
+    GemmConfig tune(std::size_t m, std::size_t n, std::size_t k, const TuneOptions& opts = {})
+    {
+        std::mt19937 gen(1234);
+        std::vector<typename MatrixA::value_type> a;
+        std::vector<typename MatrixB::value_type> b;
+        std::vector<typename MatrixC::value_type> c;
+        MatrixA A = make_matrix<MatrixA>(a, m, k, gen);
+        MatrixB B = make_matrix<MatrixB>(b, k, n, gen);
+        MatrixC C = make_matrix<MatrixC>(c, m, n, gen);
+
+        GemmT gemm;
+        GemmConfig best;
+
+        //  stage 1 : every kernel with its derived blocking (one untimed warm up run each)
+        for (const auto& d : micro_kernels<pack_t, acc1_t>()) {
+            GemmConfig cand{d.name, d.MR, d.NR, 0, 0, 0, 0.0};
+            gemm.set_config(cand);
+            measure(gemm, C, A, B, m, n, k, 1);
+            cand = gemm.config();
+            cand.gflops = measure(gemm, C, A, B, m, n, k, opts.reps);
+            if (cand.gflops > best.gflops) best = cand;
+        }
+
+        //  stage 2 : KC × {1/2, 1, 2}, MC × {1/2, 1, 2} around the winner
+        if (opts.sweep_blocking) {
+            const GemmConfig base = best;
+            for (double ks : {0.5, 1.0, 2.0}) {
+                for (double ms : {0.5, 1.0, 2.0}) {
+                    if (ks == 1.0 && ms == 1.0) continue;
+                    GemmConfig cand = base;
+                    cand.KC = std::max<std::size_t>(static_cast<std::size_t>(base.KC*ks), 8);
+                    cand.MC = std::max<std::size_t>(static_cast<std::size_t>(base.MC*ms), base.MR);
+                    gemm.set_config(cand);
+                    cand = gemm.config();
+                    cand.gflops = measure(gemm, C, A, B, m, n, k, opts.reps);
+                    if (cand.gflops > best.gflops) best = cand;
+                }
+            }
+        }
+
+        if (!(best.gflops > 0.0) || !best.MC || !best.KC || !best.NC) return GemmT().config();
+
+        db_.insert(GemmT::tuning_key(m, n, k), best);
+        if (opts.save) db_.save();
+        return best;
+    }
+
+    //  tunes a representative problem for each of the 27 shape classes
+    void tune_shape_classes(const TuneOptions& opts = {})
+    {
+        const std::size_t rep[3] = {48, 256, 768};
+        TuneOptions o = opts;
+        o.save = false;
+        for (std::size_t m : rep)
+            for (std::size_t n : rep)
+                for (std::size_t k : rep)
+                    tune(m, n, k, o);
+        if (opts.save) db_.save();
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,235 @@
+///@author Sudhanva Kulkarni
+/// Batched GEMM for many small problems.
+///     run_strided : C_i ← epi(op(A_i)·op(B_i)), i < batch, where X_i is X shifted by i·stride_X elements
+///     run_grouped : the same over arrays of independently shaped problems
+/// Problems are spread over threads (largest first for grouped batches) and each thread keeps one Gemm, so
+/// packing buffers are allocated once and reused by every problem it runs. A problem whose decoded operands
+/// fit in half of L1 and whose K fits in one KC panel skips the panel packing altogether : native inputs are
+/// multiplied straight from the caller's storage, lo_float inputs are decoded once into plain row major
+/// copies of op(A) and op(B) in a per-thread buffer. Both paths round exactly like Gemm::run.
+/// The epilogue is shared by the whole batch and must accept concurrent apply calls, as in Gemm::run.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+template<typename MatrixA, typename MatrixB, typename MatrixC, typename Accum1 = void, typename Accum2 = void>
+class BatchedGemm {
+    using GemmT      = Gemm<MatrixA, MatrixB, MatrixC, Accum1, Accum2>;
+    using value_type = typename GemmT::input_type;
+    using pack_t     = pack_type_t<value_type>;
+    using acc1_t     = typename GemmT::accum1_type;
+    using acc2_t     = typename GemmT::accum2_type;
+
+    //  register tile of the unpacked path
+    static constexpr std::size_t DR = 4;
+    static constexpr std::size_t DC = 8;
+
+    //  one Gemm (and so one set of packing buffers) per thread, plus the buffer the unpacked path
+    //  decodes lo_float operands into
+    std::vector<GemmT> gemms_;
+    std::vector<std::vector<pack_t>> decoded_;
+    GemmConfig config_;
+    bool pinned_ = false;
+
+    void ensure_workers(std::size_t nt)
+    {
+        if (gemms_.size() >= nt) return;
+        gemms_.resize(nt);
+        decoded_.resize(nt);
+        if (pinned_)
+            for (auto& g : gemms_) g.set_config(config_);
+    }
+
+    static std::size_t op_rows(const MatrixA& A, Lo_Gemm::Op op) { return op == Lo_Gemm::NoTrans ? A.rows() : A.cols(); }
+    static std::size_t op_cols(const MatrixB& B, Lo_Gemm::Op op) { return op == Lo_Gemm::NoTrans ? B.cols() : B.rows(); }
+    static std::size_t op_inner(const MatrixA& A, Lo_Gemm::Op op) { return op == Lo_Gemm::NoTrans ? A.cols() : A.rows(); }
+
+    bool fits_l1(std::size_t m, std::size_t n, std::size_t k, std::size_t KC) const noexcept
+    {
+        return k <= KC && (m*k + k*n)*sizeof(pack_t) + m*n*sizeof(acc2_t) <= cache_info().L1/2;
+    }
+
+    //  whether a problem takes the unpacked path; every worker shares the same KC
+    bool unpacked(const MatrixA& A, const MatrixB& B, Lo_Gemm::Op opA, Lo_Gemm::Op opB) const noexcept
+    {
+        return fits_l1(op_rows(A, opA), op_cols(B, opB), op_inner(A, opA), gemms_[0].blocking().KC);
+    }
+
+    //  C ← epi(a·b) for m×k a and k×n b given by element strides, DR×DC tiles accumulated in Accum1
+    template<typename T, typename Epi>
+    static void run_unpacked(MatrixC& C, const T* a, std::size_t a_rs, std::size_t a_cs,
+                             const T* b, std::size_t b_rs, std::size_t b_cs,
+                             std::size_t m, std::size_t n, std::size_t k, Epi& epi)
+    {
+        for (std::size_t j0 = 0; j0 < n; j0 += DC) {
+            const std::size_t nr = std::min(DC, n - j0);
+            for (std::size_t i0 = 0; i0 < m; i0 += DR) {
+                const std::size_t mr = std::min(DR, m - i0);
+
+                acc1_t tile[DR*DC] = {};
+                for (std::size_t p = 0; p < k; ++p)
+                    for (std::size_t i = 0; i < mr; ++i) {
+                        const T av = a[(i0+i)*a_rs + p*a_cs];
+                        for (std::size_t j = 0; j < nr; ++j)
+                            acc_fma(tile[i*DC + j], av, b[p*b_rs + (j0+j)*b_cs]);
+                    }
+
+                acc2_t out[DR*DC];
+                for (std::size_t i = 0; i < mr; ++i)
+                    for (std::size_t j = 0; j < nr; ++j) {
+                        out[i*DC + j] = acc2_t{};
+                        acc_add(out[i*DC + j], tile[i*DC + j]);
+                    }
+                epi.apply(out, DC, i0, j0, mr, nr, C);
+            }
+        }
+    }
+
+    //  runs one problem on worker w
+    template<typename Epi>
+    void run_one(std::size_t w, MatrixC& C, const MatrixA& A, const MatrixB& B, Epi& epi,
+                 Lo_Gemm::Op opA, Lo_Gemm::Op opB)
+    {
+        const std::size_t m = op_rows(A, opA), n = op_cols(B, opB), k = op_inner(A, opA);
+        if (!fits_l1(m, n, k, gemms_[w].blocking().KC)) {
+            gemms_[w].run(C, A, B, epi, opA, opB);
+            return;
+        }
+
+        const std::size_t a_rs = opA == Lo_Gemm::NoTrans ? A.row_stride() : A.col_stride();
+        const std::size_t a_cs = opA == Lo_Gemm::NoTrans ? A.col_stride() : A.row_stride();
+        const std::size_t b_rs = opB == Lo_Gemm::NoTrans ? B.row_stride() : B.col_stride();
+        const std::size_t b_cs = opB == Lo_Gemm::NoTrans ? B.col_stride() : B.row_stride();
+
+        if constexpr (std::is_same_v<pack_t, value_type>) {
+            run_unpacked(C, A.data, a_rs, a_cs, B.data, b_rs, b_cs, m, n, k, epi);
+        } else {
+            //  each element decoded once, as packing would, but without the panel layout and padding
+            auto& buf = decoded_[w];
+            buf.resize(m*k + k*n);
+            pack_t* da = buf.data();
+            pack_t* db = da + m*k;
+            for (std::size_t i = 0; i < m; ++i)
+                for (std::size_t p = 0; p < k; ++p)
+                    da[i*k + p] = lo_cast<pack_t>(A.data[i*a_rs + p*a_cs]);
+            for (std::size_t p = 0; p < k; ++p)
+                for (std::size_t j = 0; j < n; ++j)
+                    db[p*n + j] = lo_cast<pack_t>(B.data[p*b_rs + j*b_cs]);
+            run_unpacked(C, da, k, 1, db, n, 1, m, n, k, epi);
+        }
+    }
+
+public:
+    BatchedGemm() = default;
+
+    //  pins kernel and blocking for every problem; returns false if the kernel is unknown
+    bool set_config(const GemmConfig& c)
+    {
+        GemmT probe;
+        if (!probe.set_config(c)) return false;
+        config_ = c;
+        pinned_ = true;
+        for (auto& g : gemms_) g.set_config(c);
+        return true;
+    }
+
+    //---------------------------------------------------------------------
+    //  C_i ← C_i + op(A_i)·op(B_i),  X_i = X.data + i·stride_X              //
+    //---------------------------------------------------------------------
+    void run_strided(MatrixC& C, const MatrixA& A, const MatrixB& B, std::size_t batch,
+                     std::size_t stride_a, std::size_t stride_b, std::size_t stride_c,
+                     Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        epilogue_for_t<acc2_t, typename MatrixC::value_type> epi;
+        run_strided(C, A, B, batch, stride_a, stride_b, stride_c, epi, opA, opB);
+    }
+
+    template<typename Epi>
+    void run_strided(MatrixC& C, const MatrixA& A, const MatrixB& B, std::size_t batch,
+                     std::size_t stride_a, std::size_t stride_b, std::size_t stride_c, Epi& epi,
+                     Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        using ia = typename MatrixA::index_type;
+        using ib = typename MatrixB::index_type;
+        using ic = typename MatrixC::index_type;
+        if (batch == 0) return;
+
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        ensure_workers(nt);
+
+        //  fewer problems than threads and too large for the unpacked path : run them one after the
+        //  other, each one parallel inside. Unpacked problems are serial, so they are always spread.
+        if (batch < nt && !unpacked(A, B, opA, opB)) {
+            for (std::size_t i = 0; i < batch; ++i) {
+                MatrixA Ai(A.data + i*stride_a, static_cast<ia>(A.m), static_cast<ia>(A.n), static_cast<ia>(A.ld));
+                MatrixB Bi(B.data + i*stride_b, static_cast<ib>(B.m), static_cast<ib>(B.n), static_cast<ib>(B.ld));
+                MatrixC Ci(C.data + i*stride_c, static_cast<ic>(C.m), static_cast<ic>(C.n), static_cast<ic>(C.ld));
+                run_one(0, Ci, Ai, Bi, epi, opA, opB);
+            }
+            return;
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < batch; ++i) {
+            MatrixA Ai(A.data + i*stride_a, static_cast<ia>(A.m), static_cast<ia>(A.n), static_cast<ia>(A.ld));
+            MatrixB Bi(B.data + i*stride_b, static_cast<ib>(B.m), static_cast<ib>(B.n), static_cast<ib>(B.ld));
+            MatrixC Ci(C.data + i*stride_c, static_cast<ic>(C.m), static_cast<ic>(C.n), static_cast<ic>(C.ld));
+            run_one(static_cast<std::size_t>(thread_id()), Ci, Ai, Bi, epi, opA, opB);
+        }
+    }
+
+    //---------------------------------------------------------------------
+    //  C[i] ← C[i] + op(A[i])·op(B[i]),  i < count, shapes may differ      //
+    //---------------------------------------------------------------------
+    void run_grouped(MatrixC* C, const MatrixA* A, const MatrixB* B, std::size_t count,
+                     Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        epilogue_for_t<acc2_t, typename MatrixC::value_type> epi;
+        run_grouped(C, A, B, count, epi, opA, opB);
+    }
+
+    template<typename Epi>
+    void run_grouped(MatrixC* C, const MatrixA* A, const MatrixB* B, std::size_t count, Epi& epi,
+                     Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        if (count == 0) return;
+
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        ensure_workers(nt);
+
+        //  fewer problems than threads : unpacked ones (serial each) one per thread, then the others
+        //  one after the other, each one parallel inside
+        if (count < nt) {
+            #pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < count; ++i)
+                if (unpacked(A[i], B[i], opA, opB))
+                    run_one(static_cast<std::size_t>(thread_id()), C[i], A[i], B[i], epi, opA, opB);
+            for (std::size_t i = 0; i < count; ++i)
+                if (!unpacked(A[i], B[i], opA, opB))
+                    run_one(0, C[i], A[i], B[i], epi, opA, opB);
+            return;
+        }
+
+        //  largest problems first so the dynamic schedule ends with the small ones
+        std::vector<std::size_t> order(count);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        auto flops = [&](std::size_t i) { return op_rows(A[i], opA) * op_cols(B[i], opB) * op_inner(A[i], opA); };
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) { return flops(x) > flops(y); });
+
+        #pragma omp parallel for schedule(dynamic)
+        for (std::size_t q = 0; q < count; ++q) {
+            const std::size_t i = order[q];
+            run_one(static_cast<std::size_t>(thread_id()), C[i], A[i], B[i], epi, opA, opB);
+        }
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,52 @@
+///@author Sudhanva Kulkarni
+/// Block floating point : MX_Matrix / MX_Vector with lo_float::int_n<LEN> mantissas and one shared power of two
+/// exponent per block of r elements,
+///     x ≈ 2^e_b · q,    q an LEN bit two's complement integer, |q| ≤ 2^(LEN−1) − 1
+///     e_b = clamp(floor(log2(amax_b)) − (LEN − 2), −127, 127)
+/// so the largest element of a block keeps LEN − 1 significant bits. MXINT8 is LEN = 8 with blocks of 32 and E8M0
+/// scales, BFP16 LEN = 16 with int8_t exponents; both take any r (ld % r == 0). The stored exponent is the weight
+/// of one mantissa unit : an OCP MXINT8 scale X, whose elements are 1.6 fixed point numbers, is 2^(e_b + 6).
+/// mx_quantize / mx_dequantize handle the containers directly (rounding, clamping and narrowing eight lanes at a
+/// time with AVX2), and MXGemm multiplies them in integer arithmetic : the mantissas are packed as int8_t /
+/// int16_t, a k-block of r is a plain integer dot product in int32_t (int64_t for mantissas wider than 8 bits)
+/// and the exponents are applied once per block, in float. BFPGemm names the row major A / column major B
+/// instantiation that gets the blocked k loop.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Matrix.h"
+#include "OP_gemm.hpp"
+#include "Vector.h"
+#include "lo_float.h"
+#include "lo_int.h"
+#include "mx_quantize.hpp"
+
+namespace Lo_Gemm {
+
+template<int LEN, typename idx, typename T_scal = int8_t, Layout L = ColMajor>
+using BFP_Matrix = MX_Matrix<lo_float::int_n<LEN>, idx, T_scal, L>;
+
+template<int LEN, typename idx, typename T_scal = int8_t>
+using BFP_Vector = MX_Vector<lo_float::int_n<LEN>, idx, T_scal>;
+
+template<typename idx, Layout L = ColMajor>
+using MXINT8_Matrix = BFP_Matrix<8, idx, lo_float::float8_e8m0<>, L>;
+
+template<typename idx, Layout L = ColMajor>
+using BFP16_Matrix = BFP_Matrix<16, idx, int8_t, L>;
+
+inline constexpr int mxint8_block_size = 32;
+
+} //namespace Lo_Gemm
+
+
+namespace LoGemm {
+
+//  block floating point GEMM, row major A / column major B so that every k-block is an integer dot product
+template<int LEN, typename MatrixC, typename T_scal = int8_t, typename Accum1 = void, typename Accum2 = void, typename idx = int>
+using BFPGemm = MXGemm<Lo_Gemm::BFP_Matrix<LEN, idx, T_scal, Lo_Gemm::RowMajor>,
+                       Lo_Gemm::BFP_Matrix<LEN, idx, T_scal, Lo_Gemm::ColMajor>, MatrixC, Accum1, Accum2>;
+
+} // namespace LoGemm
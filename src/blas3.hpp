@@ -0,0 +1,328 @@
+///@author Sudhanva Kulkarni
+/// Level 3 routines beyond GEMM, blocked so that all but the diagonal blocks run through LoGemm::Gemm
+/// (and so through its packing, micro-kernels, accumulator policy and threading) :
+///     Syrk : C ← alpha·op(A)·op(A)ᵀ + beta·C on one triangle of C
+///     Trmm : B ← alpha·op(A)·B  or  B ← alpha·B·op(A),  A triangular
+///     Trsm : B ← alpha·op(A)⁻¹·B  or  B ← alpha·B·op(A)⁻¹,  A triangular
+/// The lo_float formats are real, so Syrk is also HERK. Accum1 and Accum2 are passed on to Gemm, and the
+/// small triangular solves on diagonal blocks accumulate in Accum1 as well.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "Matrix.h"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+//  Forwards only the part of each tile that lies in the uplo triangle of the full matrix to the
+//  wrapped epilogue. (ro, co) is the offset of the C view Gemm writes to within that matrix.
+template<typename Epi>
+struct TriangleEpilogue {
+    Epi& inner;
+    Lo_Gemm::Uplo uplo;
+    std::ptrdiff_t ro;
+    std::ptrdiff_t co;
+
+    template<typename T_tile, typename MatrixC>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr, std::size_t nr, MatrixC& C)
+    {
+        const std::ptrdiff_t w = static_cast<std::ptrdiff_t>(nr);
+        for (std::size_t i = 0; i < mr; ++i) {
+            //  column of this tile row that sits on the diagonal
+            const std::ptrdiff_t d = static_cast<std::ptrdiff_t>(i0 + i) + ro - co - static_cast<std::ptrdiff_t>(j0);
+            if (uplo == Lo_Gemm::Lower) {
+                const std::ptrdiff_t cnt = std::clamp<std::ptrdiff_t>(d + 1, 0, w);
+                if (cnt > 0) inner.apply(tile + i*ld, ld, i0 + i, j0, 1, static_cast<std::size_t>(cnt), C);
+            } else {
+                const std::ptrdiff_t start = std::clamp<std::ptrdiff_t>(d, 0, w);
+                if (start < w) inner.apply(tile + i*ld + start, ld, i0 + i, j0 + start, 1, nr - start, C);
+            }
+        }
+    }
+};
+
+//  rows r0:r0+cnt of op(X) (k columns) as a block of X
+template<typename MatrixX>
+inline MatrixX op_rows(const MatrixX& X, Lo_Gemm::Op op, std::size_t r0, std::size_t cnt, std::size_t k)
+{
+    using idx = typename MatrixX::index_type;
+    return op == Lo_Gemm::NoTrans ? X.block(static_cast<idx>(r0), 0, static_cast<idx>(cnt), static_cast<idx>(k))
+                                  : X.block(0, static_cast<idx>(r0), static_cast<idx>(k), static_cast<idx>(cnt));
+}
+
+//  op(X)(r0:r0+r, c0:c0+c) as a block of X
+template<typename MatrixX>
+inline MatrixX op_block(const MatrixX& X, Lo_Gemm::Op op, std::size_t r0, std::size_t c0, std::size_t r, std::size_t c)
+{
+    using idx = typename MatrixX::index_type;
+    return op == Lo_Gemm::NoTrans ? X.block(static_cast<idx>(r0), static_cast<idx>(c0), static_cast<idx>(r), static_cast<idx>(c))
+                                  : X.block(static_cast<idx>(c0), static_cast<idx>(r0), static_cast<idx>(c), static_cast<idx>(r));
+}
+
+//  element (r, c) of op(A)
+template<typename MatrixX>
+inline typename MatrixX::value_type op_elem(const MatrixX& X, Lo_Gemm::Op op, std::size_t r, std::size_t c)
+{
+    using idx = typename MatrixX::index_type;
+    return op == Lo_Gemm::NoTrans ? X(static_cast<idx>(r), static_cast<idx>(c)) : X(static_cast<idx>(c), static_cast<idx>(r));
+}
+
+
+//---------------------------------------------------------------------
+//  SYRK : one GEMM per block column of C, restricted to the triangle   //
+//---------------------------------------------------------------------
+template<typename MatrixA, typename MatrixC, typename Accum1 = void, typename Accum2 = void>
+class Syrk {
+    using GemmT = Gemm<MatrixA, MatrixA, MatrixC, Accum1, Accum2>;
+    using Epi   = epilogue_for_t<typename GemmT::accum2_type, typename MatrixC::value_type>;
+
+    GemmT gemm_;
+    std::size_t nb_ = 128;
+
+public:
+    GemmT& gemm() noexcept { return gemm_; }
+    void set_block_size(std::size_t nb) noexcept { nb_ = std::max<std::size_t>(nb, 1); }
+
+    //  op(A) is n×k, C is n×n; the other triangle of C is not touched
+    void run(Lo_Gemm::Uplo uplo, MatrixC& C, const MatrixA& A, Lo_Gemm::Op op = Lo_Gemm::NoTrans,
+             double alpha = 1.0, double beta = 1.0)
+    {
+        using idx = typename MatrixC::index_type;
+        const std::size_t n = C.rows();
+        const std::size_t k = op == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+        const Lo_Gemm::Op opT = op == Lo_Gemm::NoTrans ? Lo_Gemm::Trans : Lo_Gemm::NoTrans;
+
+        Epi epi;
+        epi.alpha = static_cast<decltype(epi.alpha)>(alpha);
+        epi.beta = static_cast<decltype(epi.beta)>(beta);
+
+        for (std::size_t jb = 0; jb < n; jb += nb_) {
+            const std::size_t nbj = std::min(nb_, n - jb);
+            const std::size_t r0 = uplo == Lo_Gemm::Lower ? jb : 0;
+            const std::size_t r1 = uplo == Lo_Gemm::Lower ? n : jb + nbj;
+
+            MatrixC Cv = C.block(static_cast<idx>(r0), static_cast<idx>(jb), static_cast<idx>(r1 - r0), static_cast<idx>(nbj));
+            const MatrixA Ar = op_rows(A, op, r0, r1 - r0, k);
+            const MatrixA Aj = op_rows(A, op, jb, nbj, k);
+
+            TriangleEpilogue<Epi> tri{epi, uplo, static_cast<std::ptrdiff_t>(r0), static_cast<std::ptrdiff_t>(jb)};
+            gemm_.run(Cv, Ar, Aj, tri, op, opT);
+        }
+    }
+};
+
+
+//---------------------------------------------------------------------
+//  TRMM : each block of B is rebuilt from one GEMM whose A operand is  //
+//  the block row (or column) of op(A) up to the diagonal, copied with  //
+//  the other triangle zeroed. Blocks are visited so that the rows or   //
+//  columns of B a block reads have not been overwritten yet, and each  //
+//  element of B is rounded once.                                       //
+//---------------------------------------------------------------------
+template<typename MatrixA, typename MatrixB, typename Accum1 = void, typename Accum2 = void>
+class Trmm {
+    using value_type = typename MatrixA::value_type;
+    using idx        = typename MatrixB::index_type;
+    using Panel      = Lo_Gemm::Matrix<value_type, idx, Lo_Gemm::ColMajor>;
+    using Temp       = Lo_Gemm::Matrix<typename MatrixB::value_type, idx, Lo_Gemm::ColMajor>;
+
+    using GemmL      = Gemm<Panel, MatrixB, Temp, Accum1, Accum2>;
+    using Epi        = epilogue_for_t<typename GemmL::accum2_type, typename MatrixB::value_type>;
+
+    GemmL left_;
+    Gemm<MatrixB, Panel, Temp, Accum1, Accum2> right_;
+    std::vector<value_type> P_;
+    std::vector<typename MatrixB::value_type> T_;
+    std::size_t nb_ = 128;
+
+    //  op(A)(r, c) with the triangle and diagonal of op(A) applied
+    static value_type tri_elem(const MatrixA& A, Lo_Gemm::Op op, bool lower, Lo_Gemm::Diag diag, std::size_t r, std::size_t c)
+    {
+        if (r == c && diag == Lo_Gemm::Unit) return lo_cast<value_type>(1.0f);
+        if (lower ? r < c : r > c) return value_type{};
+        return op_elem(A, op, r, c);
+    }
+
+    Panel copy_panel(const MatrixA& A, Lo_Gemm::Op op, bool lower, Lo_Gemm::Diag diag,
+                     std::size_t r0, std::size_t c0, std::size_t r, std::size_t c)
+    {
+        P_.resize(std::max<std::size_t>(r*c, 1));
+        for (std::size_t j = 0; j < c; ++j)
+            for (std::size_t i = 0; i < r; ++i)
+                P_[i + j*r] = tri_elem(A, op, lower, diag, r0 + i, c0 + j);
+        return Panel(P_.data(), static_cast<idx>(r), static_cast<idx>(c), static_cast<idx>(std::max<std::size_t>(r, 1)));
+    }
+
+    static void copy_back(const Temp& T, MatrixB& B, std::size_t i0, std::size_t j0)
+    {
+        #pragma omp parallel for schedule(static)
+        for (idx j = 0; j < T.cols(); ++j)
+            for (idx i = 0; i < T.rows(); ++i)
+                B(static_cast<idx>(i0) + i, static_cast<idx>(j0) + j) = T(i, j);
+    }
+
+public:
+    void set_block_size(std::size_t nb) noexcept { nb_ = std::max<std::size_t>(nb, 1); }
+
+    void run(Lo_Gemm::Side side, Lo_Gemm::Uplo uplo, Lo_Gemm::Op op, Lo_Gemm::Diag diag,
+             MatrixB& B, const MatrixA& A, double alpha = 1.0)
+    {
+        const std::size_t m = B.rows();
+        const std::size_t n = B.cols();
+        const bool lower = (uplo == Lo_Gemm::Lower) != (op == Lo_Gemm::Trans);    // triangle of op(A)
+
+        Epi epi;
+        epi.alpha = static_cast<decltype(epi.alpha)>(alpha);
+        epi.beta = 0;
+
+        if (side == Lo_Gemm::Left) {
+            //  row block i of op(A)·B reads rows k0:k1 of B : bottom up when lower, top down when upper
+            const std::size_t blocks = (m + nb_ - 1) / nb_;
+            for (std::size_t q = 0; q < blocks; ++q) {
+                const std::size_t b = lower ? blocks - 1 - q : q;
+                const std::size_t i0 = b*nb_, ib = std::min(nb_, m - i0);
+                const std::size_t k0 = lower ? 0 : i0, k1 = lower ? i0 + ib : m;
+
+                const Panel P = copy_panel(A, op, lower, diag, i0, k0, ib, k1 - k0);
+                const MatrixB Bk = B.block(static_cast<idx>(k0), 0, static_cast<idx>(k1 - k0), static_cast<idx>(n));
+                T_.resize(std::max<std::size_t>(ib*n, 1));
+                Temp T(T_.data(), static_cast<idx>(ib), static_cast<idx>(n), static_cast<idx>(ib));
+                left_.run(T, P, Bk, epi);
+                copy_back(T, B, i0, 0);
+            }
+        } else {
+            //  column block j of B·op(A) reads columns k0:k1 of B : left to right when lower
+            const std::size_t blocks = (n + nb_ - 1) / nb_;
+            for (std::size_t q = 0; q < blocks; ++q) {
+                const std::size_t b = lower ? q : blocks - 1 - q;
+                const std::size_t j0 = b*nb_, jb = std::min(nb_, n - j0);
+                const std::size_t k0 = lower ? j0 : 0, k1 = lower ? n : j0 + jb;
+
+                const Panel P = copy_panel(A, op, lower, diag, k0, j0, k1 - k0, jb);
+                const MatrixB Bk = B.block(0, static_cast<idx>(k0), static_cast<idx>(m), static_cast<idx>(k1 - k0));
+                T_.resize(std::max<std::size_t>(m*jb, 1));
+                Temp T(T_.data(), static_cast<idx>(m), static_cast<idx>(jb), static_cast<idx>(std::max<std::size_t>(m, 1)));
+                right_.run(T, Bk, P, epi);
+                copy_back(T, B, 0, j0);
+            }
+        }
+    }
+};
+
+
+//---------------------------------------------------------------------
+//  TRSM : for each diagonal block, one GEMM subtracts the contribution //
+//  of the blocks already solved (B_i ← alpha·B_i − op(A)_ik·X_k, one    //
+//  rounding), then a substitution solves against the diagonal block.   //
+//---------------------------------------------------------------------
+template<typename MatrixA, typename MatrixB, typename Accum1 = void, typename Accum2 = void>
+class Trsm {
+    using value_type = typename MatrixA::value_type;
+    using T_b        = typename MatrixB::value_type;
+    using idx        = typename MatrixB::index_type;
+    using GemmL      = Gemm<MatrixA, MatrixB, MatrixB, Accum1, Accum2>;
+    using GemmR      = Gemm<MatrixB, MatrixA, MatrixB, Accum1, Accum2>;
+    using pack_t     = pack_type_t<value_type>;
+    using acc1_t     = typename GemmL::accum1_type;
+    using Epi        = epilogue_for_t<typename GemmL::accum2_type, T_b>;
+
+    GemmL left_;
+    GemmR right_;
+    std::size_t nb_ = 128;
+
+    //  x ← (b − dot) / d, rounded once into the format of B
+    static T_b solve_one(const T_b& b, const acc1_t& dot, const value_type& d, bool unit)
+    {
+        double v = static_cast<double>(b) - lo_cast<double>(dot);
+        if (!unit) v /= static_cast<double>(d);
+        return lo_cast<T_b>(v);
+    }
+
+    //  op(A)(i0:i0+ib, i0:i0+ib)·X = B(i0:i0+ib, :), one column of B per iteration
+    static void solve_diag_left(const MatrixA& A, Lo_Gemm::Op op, bool lower, bool unit,
+                                std::size_t i0, std::size_t ib, MatrixB& B)
+    {
+        #pragma omp parallel for schedule(static)
+        for (idx c = 0; c < B.cols(); ++c) {
+            for (std::size_t q = 0; q < ib; ++q) {
+                const std::size_t r = lower ? q : ib - 1 - q;
+                const std::size_t s0 = lower ? 0 : r + 1, s1 = lower ? r : ib;
+                acc1_t dot{};
+                for (std::size_t s = s0; s < s1; ++s)
+                    acc_fma(dot, lo_cast<pack_t>(op_elem(A, op, i0 + r, i0 + s)), lo_cast<pack_t>(B(static_cast<idx>(i0 + s), c)));
+                T_b& x = B(static_cast<idx>(i0 + r), c);
+                x = solve_one(x, dot, op_elem(A, op, i0 + r, i0 + r), unit);
+            }
+        }
+    }
+
+    //  X·op(A)(j0:j0+jb, j0:j0+jb) = B(:, j0:j0+jb), one row of B per iteration
+    static void solve_diag_right(const MatrixA& A, Lo_Gemm::Op op, bool lower, bool unit,
+                                 std::size_t j0, std::size_t jb, MatrixB& B)
+    {
+        #pragma omp parallel for schedule(static)
+        for (idx r = 0; r < B.rows(); ++r) {
+            for (std::size_t q = 0; q < jb; ++q) {
+                const std::size_t c = lower ? jb - 1 - q : q;
+                const std::size_t s0 = lower ? c + 1 : 0, s1 = lower ? jb : c;
+                acc1_t dot{};
+                for (std::size_t s = s0; s < s1; ++s)
+                    acc_fma(dot, lo_cast<pack_t>(B(r, static_cast<idx>(j0 + s))), lo_cast<pack_t>(op_elem(A, op, j0 + s, j0 + c)));
+                T_b& x = B(r, static_cast<idx>(j0 + c));
+                x = solve_one(x, dot, op_elem(A, op, j0 + c, j0 + c), unit);
+            }
+        }
+    }
+
+public:
+    void set_block_size(std::size_t nb) noexcept { nb_ = std::max<std::size_t>(nb, 1); }
+
+    void run(Lo_Gemm::Side side, Lo_Gemm::Uplo uplo, Lo_Gemm::Op op, Lo_Gemm::Diag diag,
+             MatrixB& B, const MatrixA& A, double alpha = 1.0)
+    {
+        const std::size_t m = B.rows();
+        const std::size_t n = B.cols();
+        const bool lower = (uplo == Lo_Gemm::Lower) != (op == Lo_Gemm::Trans);    // triangle of op(A)
+        const bool unit = diag == Lo_Gemm::Unit;
+
+        Epi epi;
+        epi.alpha = -1;
+        epi.beta = static_cast<decltype(epi.beta)>(alpha);
+
+        if (side == Lo_Gemm::Left) {
+            //  lower : forward, top down ; upper : backward, bottom up
+            const std::size_t blocks = (m + nb_ - 1) / nb_;
+            for (std::size_t q = 0; q < blocks; ++q) {
+                const std::size_t b = lower ? q : blocks - 1 - q;
+                const std::size_t i0 = b*nb_, ib = std::min(nb_, m - i0);
+                const std::size_t k0 = lower ? 0 : i0 + ib, k1 = lower ? i0 : m;
+
+                MatrixB Bi = B.block(static_cast<idx>(i0), 0, static_cast<idx>(ib), static_cast<idx>(n));
+                const MatrixA Aik = op_block(A, op, i0, k0, ib, k1 - k0);
+                const MatrixB Xk = B.block(static_cast<idx>(k0), 0, static_cast<idx>(k1 - k0), static_cast<idx>(n));
+                left_.run(Bi, Aik, Xk, epi, op, Lo_Gemm::NoTrans);
+                solve_diag_left(A, op, lower, unit, i0, ib, B);
+            }
+        } else {
+            //  lower : right to left ; upper : left to right
+            const std::size_t blocks = (n + nb_ - 1) / nb_;
+            for (std::size_t q = 0; q < blocks; ++q) {
+                const std::size_t b = lower ? blocks - 1 - q : q;
+                const std::size_t j0 = b*nb_, jb = std::min(nb_, n - j0);
+                const std::size_t k0 = lower ? j0 + jb : 0, k1 = lower ? n : j0;
+
+                MatrixB Bj = B.block(0, static_cast<idx>(j0), static_cast<idx>(m), static_cast<idx>(jb));
+                const MatrixB Xk = B.block(0, static_cast<idx>(k0), static_cast<idx>(m), static_cast<idx>(k1 - k0));
+                const MatrixA Akj = op_block(A, op, k0, j0, k1 - k0, jb);
+                right_.run(Bj, Xk, Akj, epi, Lo_Gemm::NoTrans, op);
+                solve_diag_right(A, op, lower, unit, j0, jb, B);
+            }
+        }
+    }
+};
+
+} // namespace LoGemm
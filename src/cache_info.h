@@ -1,55 +1,84 @@
+///@author Sudhanva Kulkarni
+/// Cache topology probing used to size the LoGemm blocking parameters.
+/// get_cache_size(level) returns the size in bytes of the level-`level` data (or unified) cache of cpu0,
+/// 0 if it cannot be determined. cache_info() probes once and caches the result with fallbacks filled in.
+
+#pragma once
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <cstddef>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+namespace LoGemm {
 
 #if defined(__linux__)
-size_t get_cache_size(int level) {
-    char path[128];
-    snprintf(path, sizeof(path),
-            "/sys/devices/system/cpu/cpu0/cache/index%d/size", level);
-    FILE* fp = fopen(path, "r");
-    if (!fp) return 0;
+namespace cache_internal {
 
-    char buffer[32];
-    if (!fgets(buffer, sizeof(buffer), fp)) {
-        fclose(fp);
-        return 0;
-    }
+inline bool read_sys_line(const char* path, char* buffer, size_t len) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return false;
+    bool ok = fgets(buffer, static_cast<int>(len), fp) != nullptr;
     fclose(fp);
+    return ok;
+}
 
+inline size_t parse_size(const char* buffer) {
     size_t size = 0;
-    if (strchr(buffer, 'K')) {
-        sscanf(buffer, "%zuK", &size);
-        size *= 1024;
-    } else if (strchr(buffer, 'M')) {
-        sscanf(buffer, "%zuM", &size);
-        size *= 1024 * 1024;
-    }
+    if (sscanf(buffer, "%zu", &size) != 1) return 0;
+    if (strchr(buffer, 'K')) size *= 1024;
+    else if (strchr(buffer, 'M')) size *= 1024 * 1024;
+    else if (strchr(buffer, 'G')) size *= 1024 * 1024 * 1024;
     return size;
 }
 
-size_t get_cache_line_size() {
+} // namespace cache_internal
+
+inline size_t get_cache_size(int level) {
+    char path[128];
+    char buffer[32];
+    //walk cpu0's cache indices; index numbering does not match levels (L1i and L1d are separate indices)
+    for (int index = 0; index < 16; index++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        if (!cache_internal::read_sys_line(path, buffer, sizeof(buffer))) break;
+        if (atoi(buffer) != level) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        if (!cache_internal::read_sys_line(path, buffer, sizeof(buffer))) continue;
+        if (strncmp(buffer, "Instruction", 11) == 0) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if (!cache_internal::read_sys_line(path, buffer, sizeof(buffer))) continue;
+        return cache_internal::parse_size(buffer);
+    }
+    return 0;
+}
+
+inline size_t get_cache_line_size() {
     FILE* fp = fopen("/sys/devices/system/cpu/cpu0/cache/index0/coherency_line_size", "r");
     if (!fp) return 0;
 
     size_t size = 0;
-    fscanf(fp, "%zu", &size);
+    if (fscanf(fp, "%zu", &size) != 1) size = 0;
     fclose(fp);
     return size;
 }
 
 #elif defined(__APPLE__)
-#include <sys/sysctl.h>
 
-size_t get_cache_size(int level) {
+inline size_t get_cache_size(int level) {
     int mib[2];
     size_t size = 0;
     size_t len = sizeof(size);
     switch (level) {
-        case 0: mib[0] = CTL_HW; mib[1] = HW_L1ICACHESIZE; break;
-        case 1: mib[0] = CTL_HW; mib[1] = HW_L2CACHESIZE; break;
-        case 2: mib[0] = CTL_HW; mib[1] = HW_L3CACHESIZE; break;
+        case 1: mib[0] = CTL_HW; mib[1] = HW_L1DCACHESIZE; break;
+        case 2: mib[0] = CTL_HW; mib[1] = HW_L2CACHESIZE; break;
+        case 3: mib[0] = CTL_HW; mib[1] = HW_L3CACHESIZE; break;
         default: return 0;
     }
     if (sysctl(mib, 2, &size, &len, NULL, 0) == 0)
@@ -57,7 +86,7 @@ size_t get_cache_size(int level) {
     return 0;
 }
 
-size_t get_cache_line_size() {
+inline size_t get_cache_line_size() {
     size_t line_size = 0;
     size_t size = sizeof(line_size);
     if (sysctlbyname("hw.cachelinesize", &line_size, &size, 0, 0) != 0)
@@ -65,42 +94,39 @@ size_t get_cache_line_size() {
     return line_size;
 }
 #else
-size_t get_cache_size(int level) { return 0; }
-size_t get_cache_line_size() { return 0; }
+inline size_t get_cache_size(int) { return 0; }
+inline size_t get_cache_line_size() { return 0; }
 #endif
 
 // Get the system page size (TLB line size)
-size_t get_page_size() {
+inline size_t get_page_size() {
     return sysconf(_SC_PAGESIZE);  // Usually 4096 bytes
 }
 
-// Stub for TLB size (platform-dependent)
-size_t get_TLB_size(int level) {
-#if defined(__linux__) && defined(__x86_64__)
-    unsigned int eax, ebx, ecx, edx;
-    __cpuid(2, eax, ebx, ecx, edx);
-    unsigned int descriptors[4] = {eax, ebx, ecx, edx};
-    printf("TLB descriptors (raw):\n");
-    for (int i = 0; i < 4; i++) {
-        if (descriptors[i] & (1 << 31)) continue; // invalid
-        for (int j = 0; j < 4; j++) {
-            unsigned char desc = (descriptors[i] >> (j * 8)) & 0xFF;
-            if (desc == 0) continue;
-            printf("  0x%X\n", desc);
-        }
-    }
-    return 0; // actual size must be interpreted from descriptor tables
-#else
-    return 0;
-#endif
-}
 
-int main() {
-    printf("L1 Cache: %zu bytes\n", get_cache_size(0));
-    printf("L2 Cache: %zu bytes\n", get_cache_size(1));
-    printf("L3 Cache: %zu bytes\n", get_cache_size(2));
-    printf("Cache line size: %zu bytes\n", get_cache_line_size());
-    printf("Page size (TLB line size): %zu bytes\n", get_page_size());
-    get_TLB_size(0); // Just prints descriptors for now
-    return 0;
+struct CacheInfo {
+    size_t L1;          // per core L1 data cache
+    size_t L2;
+    size_t L3;          // 0 on parts without an L3
+    size_t line_size;
+    size_t page_size;
+};
+
+//probed once per process; levels that cannot be read fall back to common x86 sizes
+inline const CacheInfo& cache_info() {
+    static const CacheInfo info = [] {
+        CacheInfo c{};
+        c.L1 = get_cache_size(1);
+        c.L2 = get_cache_size(2);
+        c.L3 = get_cache_size(3);
+        c.line_size = get_cache_line_size();
+        c.page_size = get_page_size();
+        if (c.L1 == 0) c.L1 = 32 * 1024;
+        if (c.L2 == 0) c.L2 = 256 * 1024;
+        if (c.line_size == 0) c.line_size = 64;
+        return c;
+    }();
+    return info;
 }
+
+} // namespace LoGemm
@@ -0,0 +1,196 @@
+///@author Sudhanva Kulkarni
+/// Complex GEMM on split storage (Lo_Gemm::ComplexMatrix) built from real Gemm calls :
+///     C ← alpha·op(A)·op(B) + beta·C,   op = NoTrans / Trans, each optionally conjugated, alpha and beta complex
+/// Algorithms
+///     FourM  : Re = Ar·Br − Ai·Bi,  Im = Ar·Bi + Ai·Br                      4 real products
+///     ThreeM : T1 = Ar·Br, T2 = Ai·Bi, T3 = (Ar + Ai)·(Br + Bi),
+///              Re = T1 − T2,  Im = T3 − T1 − T2                              3 real products, 3 sums
+/// ThreeM saves a quarter of the flops but its imaginary part is a difference of larger terms, so its error is
+/// relative to |A|·|B| of both parts rather than to each part. The sums Ar + Ai and Br + Bi are formed in the
+/// format Sum (by default the decoded format of the inputs, float for lo_float, where they are exact) and the
+/// third product multiplies those.
+/// Rounding
+///     Once       : the real products are accumulated in Accum2 workspaces, combined in double with alpha and
+///                  beta, and every element of C is rounded once
+///     PerProduct : every real product is rounded into the format of C before it is combined, and every
+///                  combination is rounded again, as when complex GEMM is composed of real GEMMs that write C
+/// Conjugation flips the sign of the imaginary part, which is exact, so it never adds a rounding.
+
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <vector>
+#include "Matrix.h"
+#include "gemm_epilogue.hpp"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+enum class ComplexAlgorithm { FourM, ThreeM };
+enum class ComplexRounding { Once, PerProduct };
+
+template<typename CMatrixA, typename CMatrixB, typename CMatrixC,
+         typename Accum1 = void, typename Accum2 = void, typename Sum = void>
+class ComplexGemm {
+    using RA     = typename CMatrixA::real_matrix_type;
+    using RB     = typename CMatrixB::real_matrix_type;
+    using RC     = typename CMatrixC::real_matrix_type;
+    using T_a    = typename CMatrixA::value_type;
+    using T_b    = typename CMatrixB::value_type;
+    using T_c    = typename CMatrixC::value_type;
+    using sum_t  = default_if_void_t<Sum, pack_type_t<T_a>>;
+    using SA     = Lo_Gemm::Matrix<sum_t, int, CMatrixA::layout>;
+    using SB     = Lo_Gemm::Matrix<sum_t, int, CMatrixB::layout>;
+
+    using acc2_t = typename Gemm<RA, RB, RC, Accum1, Accum2>::accum2_type;
+    using WM     = Lo_Gemm::Matrix<acc2_t, int>;
+    using GemmW  = Gemm<RA, RB, WM, Accum1, Accum2>;
+    using GemmS  = Gemm<SA, SB, WM, Accum1, Accum2>;
+
+    ComplexAlgorithm algo_ = ComplexAlgorithm::FourM;
+    ComplexRounding rounding_ = ComplexRounding::Once;
+
+    GemmW gemm_w_;
+    GemmS gemm_s_;
+    std::vector<acc2_t> T1_, T2_, T3_, T4_;
+    std::vector<double> pr_, pi_;
+    std::vector<sum_t> sa_, sb_;
+
+    //  X ← Xr + s·Xi in sum_t, in the storage layout of X
+    template<typename CMatrixX, typename SM>
+    static SM part_sum(const CMatrixX& X, double s, std::vector<sum_t>& buf)
+    {
+        using idx = typename CMatrixX::index_type;
+        const std::size_t r = X.rows(), c = X.cols();
+        const bool col = CMatrixX::layout == Lo_Gemm::ColMajor;
+        const std::size_t ld = col ? r : c;
+        buf.resize(std::max<std::size_t>(r*c, 1));
+        SM S(buf.data(), static_cast<int>(r), static_cast<int>(c), static_cast<int>(ld));
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < c; ++j)
+            for (std::size_t i = 0; i < r; ++i)
+                S(static_cast<int>(i), static_cast<int>(j)) =
+                    lo_cast<sum_t>(lo_cast<double>(X.re(static_cast<idx>(i), static_cast<idx>(j)))
+                                   + s*lo_cast<double>(X.im(static_cast<idx>(i), static_cast<idx>(j))));
+        return S;
+    }
+
+    //  W ← op(X)·op(Y) into an m×n Accum2 workspace
+    template<typename G, typename MX, typename MY>
+    static void product(G& g, std::vector<acc2_t>& W, std::size_t m, std::size_t n, const MX& X, const MY& Y,
+                        Lo_Gemm::Op opA, Lo_Gemm::Op opB)
+    {
+        W.assign(m*n, acc2_t{});
+        WM Wm(W.data(), static_cast<int>(m), static_cast<int>(n), static_cast<int>(m));
+        epilogue_for_t<acc2_t, acc2_t> overwrite;
+        overwrite.beta = 0;
+        g.run(Wm, X, Y, overwrite, opA, opB);
+    }
+
+    static double round_c(double v) { return lo_cast<double>(lo_cast<T_c>(v)); }
+
+public:
+    ComplexGemm() = default;
+    ComplexGemm(ComplexAlgorithm a, ComplexRounding r) : algo_(a), rounding_(r) {}
+
+    ComplexAlgorithm algorithm() const noexcept { return algo_; }
+    void set_algorithm(ComplexAlgorithm a) noexcept { algo_ = a; }
+
+    ComplexRounding rounding() const noexcept { return rounding_; }
+    void set_rounding(ComplexRounding r) noexcept { rounding_ = r; }
+
+    //  C ← C + op(A)·op(B)
+    void run(CMatrixC& C, const CMatrixA& A, const CMatrixB& B,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans,
+             bool conjA = false, bool conjB = false)
+    {
+        run(C, A, B, std::complex<double>(1.0), std::complex<double>(1.0), opA, opB, conjA, conjB);
+    }
+
+    void run(CMatrixC& C, const CMatrixA& A, const CMatrixB& B,
+             std::complex<double> alpha, std::complex<double> beta,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans,
+             bool conjA = false, bool conjB = false)
+    {
+        using ic = typename CMatrixC::index_type;
+        const std::size_t m = opA == Lo_Gemm::NoTrans ? A.rows() : A.cols();
+        const std::size_t n = opB == Lo_Gemm::NoTrans ? B.cols() : B.rows();
+        if (m == 0 || n == 0) return;
+
+        //  op(A) = Ar + i·sa·Ai, op(B) = Br + i·sb·Bi
+        const double sa = conjA ? -1.0 : 1.0, sb = conjB ? -1.0 : 1.0;
+        const bool per_product = rounding_ == ComplexRounding::PerProduct;
+        const double ar = alpha.real(), ai = alpha.imag(), br = beta.real(), bi = beta.imag();
+
+        //  P = op(A)·op(B) combined in double into pr_ + i·pi_
+        pr_.resize(m*n);
+        pi_.resize(m*n);
+        if (algo_ == ComplexAlgorithm::FourM) {
+            product(gemm_w_, T1_, m, n, A.re, B.re, opA, opB);
+            product(gemm_w_, T2_, m, n, A.im, B.im, opA, opB);
+            product(gemm_w_, T3_, m, n, A.re, B.im, opA, opB);
+            product(gemm_w_, T4_, m, n, A.im, B.re, opA, opB);
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t q = 0; q < m*n; ++q) {
+                double p1 = lo_cast<double>(T1_[q]), p2 = lo_cast<double>(T2_[q]);
+                double p3 = lo_cast<double>(T3_[q]), p4 = lo_cast<double>(T4_[q]);
+                if (per_product) { p1 = round_c(p1); p2 = round_c(p2); p3 = round_c(p3); p4 = round_c(p4); }
+                double re = p1 - sa*sb*p2, im = sb*p3 + sa*p4;
+                if (per_product) { re = round_c(re); im = round_c(im); }
+                pr_[q] = re;
+                pi_[q] = im;
+            }
+        } else {
+            product(gemm_w_, T1_, m, n, A.re, B.re, opA, opB);
+            product(gemm_w_, T2_, m, n, A.im, B.im, opA, opB);
+            const SA Sa = part_sum<CMatrixA, SA>(A, sa, sa_);
+            const SB Sb = part_sum<CMatrixB, SB>(B, sb, sb_);
+            product(gemm_s_, T3_, m, n, Sa, Sb, opA, opB);
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t q = 0; q < m*n; ++q) {
+                double t1 = lo_cast<double>(T1_[q]), t2 = sa*sb*lo_cast<double>(T2_[q]), t3 = lo_cast<double>(T3_[q]);
+                if (per_product) { t1 = round_c(t1); t2 = round_c(t2); t3 = round_c(t3); }
+                double re = t1 - t2;
+                double im = per_product ? round_c(round_c(t3 - t1) - t2) : t3 - t1 - t2;
+                if (per_product) re = round_c(re);
+                pr_[q] = re;
+                pi_[q] = im;
+            }
+        }
+
+        //  C ← alpha·P + beta·C, each part rounded once (PerProduct : after each term)
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < n; ++j)
+            for (std::size_t i = 0; i < m; ++i) {
+                const std::size_t q = i + j*m;
+                const double pr = pr_[q], pi = pi_[q];
+                double re, im;
+                if (per_product) {
+                    re = (ar == 1.0 && ai == 0.0) ? pr : round_c(round_c(ar*pr) - round_c(ai*pi));
+                    im = (ar == 1.0 && ai == 0.0) ? pi : round_c(round_c(ar*pi) + round_c(ai*pr));
+                } else {
+                    re = ar*pr - ai*pi;
+                    im = ar*pi + ai*pr;
+                }
+                if (br != 0.0 || bi != 0.0) {
+                    const double cr = lo_cast<double>(C.re(static_cast<ic>(i), static_cast<ic>(j)));
+                    const double ci = lo_cast<double>(C.im(static_cast<ic>(i), static_cast<ic>(j)));
+                    if (per_product) {
+                        re = round_c(re + round_c(round_c(br*cr) - round_c(bi*ci)));
+                        im = round_c(im + round_c(round_c(br*ci) + round_c(bi*cr)));
+                    } else {
+                        re += br*cr - bi*ci;
+                        im += br*ci + bi*cr;
+                    }
+                }
+                C.re(static_cast<ic>(i), static_cast<ic>(j)) = lo_cast<T_c>(re);
+                C.im(static_cast<ic>(i), static_cast<ic>(j)) = lo_cast<T_c>(im);
+            }
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,213 @@
+///@author Sudhanva Kulkarni
+/// Power of two scaling by E8M0 codes (lo_float::float8_e8m0, OCP MX shared scales) without a multiply :
+///     x · 2^(c − 127)
+/// is an integer add of c − 127 into the exponent field of x, for float lanes and for bf16 lanes (raw uint16_t
+/// bit patterns, the upper half of a float, as there is no bf16 type here). Eight float or sixteen bf16 lanes
+/// per AVX2 instruction. The edge cases behave like the exact product rounded to nearest even, except that
+/// overflow saturates :
+///     zero, inf and NaN lanes are returned unchanged, the NaN code 0xFF gives NaN
+///     a result exponent above the format range  →  ±largest finite value
+///     subnormal inputs or results                →  the exact product through ldexp (these lanes only)
+/// Code 0 is 2^−127 as in the OCP spec.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "lo_float.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace LoGemm {
+
+using e8m0_t = lo_float::float8_e8m0<>;
+
+inline constexpr uint8_t e8m0_nan_code = 0xFF;
+inline constexpr int e8m0_bias = 127;
+
+//  E8M0 code of 2^e, e clamped to the representable exponents [−127, 127]
+inline uint8_t e8m0_from_exponent(int e) noexcept
+{
+    return static_cast<uint8_t>((e < -e8m0_bias ? -e8m0_bias : (e > e8m0_bias ? e8m0_bias : e)) + e8m0_bias);
+}
+
+//  code of the largest power of two not above |s| (the scale of an MX block with amax s)
+inline uint8_t e8m0_from_float(float s) noexcept
+{
+    if (std::isnan(s)) return e8m0_nan_code;
+    if (s == 0.0f) return 0;
+    return e8m0_from_exponent(std::ilogb(s));
+}
+
+namespace e8m0_internal {
+
+//  x·2^d for a float that the integer add cannot handle (subnormal in or out, overflow)
+inline float scale_slow(float x, int d) noexcept
+{
+    const float r = std::ldexp(x, d);
+    if (std::isinf(r) && !std::isinf(x)) return std::copysign(std::numeric_limits<float>::max(), x);
+    return r;
+}
+
+inline float float_from_bf16(uint16_t h) noexcept
+{
+    const uint32_t b = static_cast<uint32_t>(h) << 16;
+    float f;
+    std::memcpy(&f, &b, 4);
+    return f;
+}
+
+//  the same for bf16 bits, rounded once : in the subnormal range the product is rounded to a multiple of 2^−133
+//  (the bf16 subnormal step) in double, above it the 8 bit product is exact in float
+inline uint16_t scale_slow_bf16(uint16_t h, int d) noexcept
+{
+    double r = std::ldexp(static_cast<double>(float_from_bf16(h)), d);
+    if (std::abs(r) < 0x1p-126) r = std::ldexp(std::nearbyint(std::ldexp(r, 133)), -133);
+    const float f = scale_slow(static_cast<float>(r), 0);
+    uint32_t b;
+    std::memcpy(&b, &f, 4);
+    if (std::abs(r) > std::numeric_limits<float>::max()) b = (b & 0x80000000u) | 0x7F7F0000u;
+    return static_cast<uint16_t>(b >> 16);
+}
+
+} // namespace e8m0_internal
+
+//  x·2^(code − 127)
+inline float e8m0_scale(float x, uint8_t code) noexcept
+{
+    if (code == e8m0_nan_code) return std::numeric_limits<float>::quiet_NaN();
+    const int d = static_cast<int>(code) - e8m0_bias;
+    uint32_t b;
+    std::memcpy(&b, &x, 4);
+    const int E = static_cast<int>((b >> 23) & 0xFF);
+    if (E == 0xFF || (b & 0x7FFFFFFFu) == 0) return x;
+    if (E == 0 || E + d <= 0 || E + d >= 0xFF) return e8m0_internal::scale_slow(x, d);
+    b += static_cast<uint32_t>(d) << 23;
+    std::memcpy(&x, &b, 4);
+    return x;
+}
+
+//  bf16 bits h·2^(code − 127)
+inline uint16_t e8m0_scale_bf16(uint16_t h, uint8_t code) noexcept
+{
+    if (code == e8m0_nan_code) return 0x7FC0;
+    const int d = static_cast<int>(code) - e8m0_bias;
+    const int E = (h >> 7) & 0xFF;
+    if (E == 0xFF || (h & 0x7FFF) == 0) return h;
+    if (E == 0 || E + d <= 0 || E + d >= 0xFF) return e8m0_internal::scale_slow_bf16(h, d);
+    return static_cast<uint16_t>(h + (d << 7));
+}
+
+//  x[i] ← x[i]·2^(code − 127) for i < n
+inline void e8m0_scale_n(float* x, std::size_t n, uint8_t code) noexcept
+{
+    if (code == e8m0_nan_code) {
+        for (std::size_t i = 0; i < n; ++i) x[i] = std::numeric_limits<float>::quiet_NaN();
+        return;
+    }
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const int d = static_cast<int>(code) - e8m0_bias;
+    const __m256i vd = _mm256_set1_epi32(d);
+    const __m256i add = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(d) << 23));
+    const __m256i emask = _mm256_set1_epi32(0xFF);
+    const __m256i absmask = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i top = _mm256_set1_epi32(0xFF);
+    const __m256i maxf = _mm256_set1_epi32(0x7F7FFFFF);
+    for (; i + 8 <= n; i += 8) {
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        const __m256i E = _mm256_and_si256(_mm256_srli_epi32(b, 23), emask);
+        const __m256i Ed = _mm256_add_epi32(E, vd);
+        //  zero, inf and NaN are kept, subnormal inputs or results go the slow way, overflow saturates
+        const __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi32(E, top),
+                                             _mm256_cmpeq_epi32(_mm256_and_si256(b, absmask), zero));
+        const __m256i slow = _mm256_andnot_si256(keep, _mm256_or_si256(_mm256_cmpeq_epi32(E, zero),
+                                                                       _mm256_cmpgt_epi32(_mm256_set1_epi32(1), Ed)));
+        const __m256i sat = _mm256_andnot_si256(_mm256_or_si256(keep, slow), _mm256_cmpgt_epi32(Ed, _mm256_set1_epi32(0xFE)));
+
+        __m256i r = _mm256_blendv_epi8(_mm256_add_epi32(b, add), b, keep);
+        r = _mm256_blendv_epi8(r, _mm256_or_si256(_mm256_andnot_si256(absmask, b), maxf), sat);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), r);
+
+        int m = _mm256_movemask_ps(_mm256_castsi256_ps(slow));
+        while (m) {
+            const int l = __builtin_ctz(static_cast<unsigned>(m));
+            float v;
+            std::memcpy(&v, reinterpret_cast<const char*>(&b) + 4*l, 4);
+            x[i + l] = e8m0_internal::scale_slow(v, d);
+            m &= m - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) x[i] = e8m0_scale(x[i], code);
+}
+
+//  bf16 lanes : h[i] ← h[i]·2^(code − 127) for i < n
+inline void e8m0_scale_n(uint16_t* h, std::size_t n, uint8_t code) noexcept
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    if (code != e8m0_nan_code) {
+        const int d = static_cast<int>(code) - e8m0_bias;
+        const __m256i vd = _mm256_set1_epi16(static_cast<int16_t>(d));
+        const __m256i add = _mm256_set1_epi16(static_cast<int16_t>(d * 128));
+        const __m256i emask = _mm256_set1_epi16(0xFF);
+        const __m256i absmask = _mm256_set1_epi16(0x7FFF);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i top = _mm256_set1_epi16(0xFF);
+        const __m256i maxb = _mm256_set1_epi16(0x7F7F);
+        for (; i + 16 <= n; i += 16) {
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+            const __m256i E = _mm256_and_si256(_mm256_srli_epi16(b, 7), emask);
+            const __m256i Ed = _mm256_add_epi16(E, vd);
+            const __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi16(E, top),
+                                                 _mm256_cmpeq_epi16(_mm256_and_si256(b, absmask), zero));
+            const __m256i slow = _mm256_andnot_si256(keep, _mm256_or_si256(_mm256_cmpeq_epi16(E, zero),
+                                                                           _mm256_cmpgt_epi16(_mm256_set1_epi16(1), Ed)));
+            const __m256i sat = _mm256_andnot_si256(_mm256_or_si256(keep, slow), _mm256_cmpgt_epi16(Ed, _mm256_set1_epi16(0xFE)));
+
+            __m256i r = _mm256_blendv_epi8(_mm256_add_epi16(b, add), b, keep);
+            r = _mm256_blendv_epi8(r, _mm256_or_si256(_mm256_andnot_si256(absmask, b), maxb), sat);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(h + i), r);
+
+            //  two mask bits per 16-bit lane
+            unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(slow)) & 0x55555555u;
+            while (m) {
+                const int l = __builtin_ctz(m) / 2;
+                uint16_t v;
+                std::memcpy(&v, reinterpret_cast<const char*>(&b) + 2*l, 2);
+                h[i + l] = e8m0_scale_bf16(v, code);
+                m &= m - 1;
+            }
+        }
+    }
+#endif
+    for (; i < n; ++i) h[i] = e8m0_scale_bf16(h[i], code);
+}
+
+//  blocked form, the MX dequantization step : x[i] ← x[i]·2^(codes[i / block] − 127)
+template<typename Lane>
+inline void e8m0_scale_blocks(Lane* x, std::size_t n, const uint8_t* codes, std::size_t block) noexcept
+{
+    #pragma omp parallel for schedule(static)
+    for (std::size_t b = 0; b < (n + block - 1) / block; ++b) {
+        const std::size_t i0 = b*block;
+        e8m0_scale_n(x + i0, std::min(block, n - i0), codes[b]);
+    }
+}
+
+template<typename Lane>
+inline void e8m0_scale_blocks(Lane* x, std::size_t n, const e8m0_t* scales, std::size_t block) noexcept
+{
+    static_assert(sizeof(e8m0_t) == 1, "E8M0 scales are one byte codes");
+    e8m0_scale_blocks(x, n, reinterpret_cast<const uint8_t*>(scales), block);
+}
+
+} // namespace LoGemm
@@ -0,0 +1,348 @@
+///@author Sudhanva Kulkarni
+/// Blocked right-looking factorizations of lo_float matrices, in place :
+///     getrf : P·A = L·U with partial pivoting        getrs : solve with the factors
+///     potrf : A = L·Lᵀ (lower triangle)              potrs : solve with the factor
+///     geqrf : A = Q·R, Householder with compact WY
+/// Panels (and the diagonal blocks of Cholesky) are copied into the working format Work, factored there with
+/// every intermediate kept in Work, and rounded once back into the storage format. Trailing updates go
+/// through Gemm / Trsm / Syrk from blas3.hpp with the Accum1 / Accum2 policy, so almost all flops run in the
+/// multithreaded GEMM kernel. Return values follow LAPACK : 0 on success, j+1 if column j failed.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "Matrix.h"
+#include "blas3.hpp"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+namespace factor_internal {
+
+template<typename MatrixT>
+using index_of = typename MatrixT::index_type;
+
+//  P(r, c) ← A(r0 + r, c0 + c) for an r×c block, P column major with leading dimension r
+template<typename Work, typename MatrixT>
+inline void load(const MatrixT& A, std::size_t r0, std::size_t c0, std::size_t r, std::size_t c, std::vector<Work>& P)
+{
+    using idx = index_of<MatrixT>;
+    P.resize(std::max<std::size_t>(r*c, 1));
+    #pragma omp parallel for schedule(static)
+    for (std::size_t j = 0; j < c; ++j)
+        for (std::size_t i = 0; i < r; ++i)
+            P[i + j*r] = lo_cast<Work>(A(static_cast<idx>(r0 + i), static_cast<idx>(c0 + j)));
+}
+
+template<typename Work, typename MatrixT>
+inline void store(MatrixT& A, std::size_t r0, std::size_t c0, std::size_t r, std::size_t c, const std::vector<Work>& P)
+{
+    using idx = index_of<MatrixT>;
+    using T = typename MatrixT::value_type;
+    #pragma omp parallel for schedule(static)
+    for (std::size_t j = 0; j < c; ++j)
+        for (std::size_t i = 0; i < r; ++i)
+            A(static_cast<idx>(r0 + i), static_cast<idx>(c0 + j)) = lo_cast<T>(P[i + j*r]);
+}
+
+//  swaps rows r1 and r2 of A in columns [c0, c1)
+template<typename MatrixT>
+inline void swap_rows(MatrixT& A, std::size_t r1, std::size_t r2, std::size_t c0, std::size_t c1)
+{
+    using idx = index_of<MatrixT>;
+    if (r1 == r2) return;
+    for (std::size_t j = c0; j < c1; ++j)
+        std::swap(A(static_cast<idx>(r1), static_cast<idx>(j)), A(static_cast<idx>(r2), static_cast<idx>(j)));
+}
+
+} // namespace factor_internal
+
+
+//---------------------------------------------------------------------
+//  LU with partial pivoting. ipiv[j] is the row swapped with row j.    //
+//---------------------------------------------------------------------
+template<typename Work = float, typename Accum1 = void, typename Accum2 = void, typename MatrixT>
+int getrf(MatrixT& A, std::vector<std::size_t>& ipiv, std::size_t nb = 64)
+{
+    using namespace factor_internal;
+    using idx = index_of<MatrixT>;
+    using GemmT = Gemm<MatrixT, MatrixT, MatrixT, Accum1, Accum2>;
+    using Epi = epilogue_for_t<typename GemmT::accum2_type, typename MatrixT::value_type>;
+
+    const std::size_t m = A.rows(), n = A.cols(), mn = std::min(m, n);
+    nb = std::max<std::size_t>(nb, 1);
+    ipiv.assign(mn, 0);
+
+    GemmT gemm;
+    Trsm<MatrixT, MatrixT, Accum1, Accum2> trsm;
+    trsm.set_block_size(nb);
+    Epi update;
+    update.alpha = -1;
+    update.beta = 1;
+    std::vector<Work> P;
+    int info = 0;
+
+    for (std::size_t j0 = 0; j0 < mn; j0 += nb)
+    {
+        const std::size_t jb = std::min(nb, mn - j0);
+        const std::size_t pm = m - j0;
+
+        //  panel A(j0:m, j0:j0+jb), unblocked in Work
+        load(A, j0, j0, pm, jb, P);
+        for (std::size_t c = 0; c < jb; ++c)
+        {
+            std::size_t piv = c;
+            for (std::size_t r = c + 1; r < pm; ++r)
+                if (std::abs(P[r + c*pm]) > std::abs(P[piv + c*pm])) piv = r;
+            ipiv[j0 + c] = j0 + piv;
+
+            if (piv != c)
+                for (std::size_t j = 0; j < jb; ++j) std::swap(P[c + j*pm], P[piv + j*pm]);
+
+            const Work d = P[c + c*pm];
+            if (d == Work(0)) {
+                if (!info) info = static_cast<int>(j0 + c + 1);
+                continue;
+            }
+            for (std::size_t r = c + 1; r < pm; ++r) P[r + c*pm] /= d;
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t j = c + 1; j < jb; ++j) {
+                const Work u = P[c + j*pm];
+                for (std::size_t r = c + 1; r < pm; ++r)
+                    P[r + j*pm] -= P[r + c*pm] * u;
+            }
+        }
+        store(A, j0, j0, pm, jb, P);
+
+        //  the panel's row swaps on the columns left and right of it
+        #pragma omp parallel sections
+        {
+            #pragma omp section
+            for (std::size_t c = 0; c < jb; ++c) swap_rows(A, j0 + c, ipiv[j0 + c], 0, j0);
+            #pragma omp section
+            for (std::size_t c = 0; c < jb; ++c) swap_rows(A, j0 + c, ipiv[j0 + c], j0 + jb, n);
+        }
+
+        if (j0 + jb >= n) continue;
+        const std::size_t nr = n - j0 - jb;
+
+        //  U12 ← L11⁻¹·A12
+        const MatrixT L11 = A.block(static_cast<idx>(j0), static_cast<idx>(j0), static_cast<idx>(jb), static_cast<idx>(jb));
+        MatrixT A12 = A.block(static_cast<idx>(j0), static_cast<idx>(j0 + jb), static_cast<idx>(jb), static_cast<idx>(nr));
+        trsm.run(Lo_Gemm::Left, Lo_Gemm::Lower, Lo_Gemm::NoTrans, Lo_Gemm::Unit, A12, L11);
+
+        //  A22 ← A22 − L21·U12
+        if (j0 + jb >= m) continue;
+        const MatrixT L21 = A.block(static_cast<idx>(j0 + jb), static_cast<idx>(j0), static_cast<idx>(m - j0 - jb), static_cast<idx>(jb));
+        MatrixT A22 = A.block(static_cast<idx>(j0 + jb), static_cast<idx>(j0 + jb), static_cast<idx>(m - j0 - jb), static_cast<idx>(nr));
+        gemm.run(A22, L21, A12, update);
+    }
+    return info;
+}
+
+//  B ← A⁻¹·B from the factors of getrf (A square, B in the format of the factors)
+template<typename Accum1 = void, typename Accum2 = void, typename MatrixT, typename MatrixB>
+void getrs(const MatrixT& LU, const std::vector<std::size_t>& ipiv, MatrixB& B, std::size_t nb = 64)
+{
+    using factor_internal::swap_rows;
+    for (std::size_t j = 0; j < ipiv.size(); ++j) swap_rows(B, j, ipiv[j], 0, B.cols());
+
+    Trsm<MatrixT, MatrixB, Accum1, Accum2> trsm;
+    trsm.set_block_size(nb);
+    trsm.run(Lo_Gemm::Left, Lo_Gemm::Lower, Lo_Gemm::NoTrans, Lo_Gemm::Unit, B, LU);
+    trsm.run(Lo_Gemm::Left, Lo_Gemm::Upper, Lo_Gemm::NoTrans, Lo_Gemm::NonUnit, B, LU);
+}
+
+
+//---------------------------------------------------------------------
+//  Cholesky, lower : only the lower triangle of A is read or written   //
+//---------------------------------------------------------------------
+template<typename Work = float, typename Accum1 = void, typename Accum2 = void, typename MatrixT>
+int potrf(MatrixT& A, std::size_t nb = 64)
+{
+    using namespace factor_internal;
+    using idx = index_of<MatrixT>;
+
+    const std::size_t n = A.rows();
+    nb = std::max<std::size_t>(nb, 1);
+
+    Trsm<MatrixT, MatrixT, Accum1, Accum2> trsm;
+    Syrk<MatrixT, MatrixT, Accum1, Accum2> syrk;
+    trsm.set_block_size(nb);
+    syrk.set_block_size(nb);
+    std::vector<Work> D;
+
+    for (std::size_t j0 = 0; j0 < n; j0 += nb)
+    {
+        const std::size_t jb = std::min(nb, n - j0);
+
+        //  L11 from A11, unblocked in Work
+        load(A, j0, j0, jb, jb, D);
+        for (std::size_t c = 0; c < jb; ++c) {
+            Work d = D[c + c*jb];
+            for (std::size_t s = 0; s < c; ++s) d -= D[c + s*jb] * D[c + s*jb];
+            if (!(d > Work(0))) return static_cast<int>(j0 + c + 1);
+            d = std::sqrt(d);
+            D[c + c*jb] = d;
+            for (std::size_t r = c + 1; r < jb; ++r) {
+                Work v = D[r + c*jb];
+                for (std::size_t s = 0; s < c; ++s) v -= D[r + s*jb] * D[c + s*jb];
+                D[r + c*jb] = v / d;
+            }
+        }
+        for (std::size_t c = 0; c < jb; ++c)
+            for (std::size_t r = c; r < jb; ++r)
+                A(static_cast<idx>(j0 + r), static_cast<idx>(j0 + c)) = lo_cast<typename MatrixT::value_type>(D[r + c*jb]);
+
+        if (j0 + jb >= n) break;
+        const std::size_t nr = n - j0 - jb;
+
+        //  L21 ← A21·L11⁻ᵀ,  A22 ← A22 − L21·L21ᵀ
+        const MatrixT L11 = A.block(static_cast<idx>(j0), static_cast<idx>(j0), static_cast<idx>(jb), static_cast<idx>(jb));
+        MatrixT L21 = A.block(static_cast<idx>(j0 + jb), static_cast<idx>(j0), static_cast<idx>(nr), static_cast<idx>(jb));
+        trsm.run(Lo_Gemm::Right, Lo_Gemm::Lower, Lo_Gemm::Trans, Lo_Gemm::NonUnit, L21, L11);
+
+        MatrixT A22 = A.block(static_cast<idx>(j0 + jb), static_cast<idx>(j0 + jb), static_cast<idx>(nr), static_cast<idx>(nr));
+        syrk.run(Lo_Gemm::Lower, A22, L21, Lo_Gemm::NoTrans, -1.0, 1.0);
+    }
+    return 0;
+}
+
+//  B ← A⁻¹·B from the factor of potrf (B in the format of the factor)
+template<typename Accum1 = void, typename Accum2 = void, typename MatrixT, typename MatrixB>
+void potrs(const MatrixT& L, MatrixB& B, std::size_t nb = 64)
+{
+    Trsm<MatrixT, MatrixB, Accum1, Accum2> trsm;
+    trsm.set_block_size(nb);
+    trsm.run(Lo_Gemm::Left, Lo_Gemm::Lower, Lo_Gemm::NoTrans, Lo_Gemm::NonUnit, B, L);
+    trsm.run(Lo_Gemm::Left, Lo_Gemm::Lower, Lo_Gemm::Trans, Lo_Gemm::NonUnit, B, L);
+}
+
+
+//---------------------------------------------------------------------
+//  Householder QR. On return R is on and above the diagonal of A and   //
+//  the Householder vectors (unit leading entry implied) below it, with  //
+//  H_j = I − tau[j]·v_j·v_jᵀ and Q = H_0·H_1···.                         //
+//  Each panel's reflectors are applied to the trailing matrix as        //
+//  I − V·Tᵀ·Vᵀ : W = Vᵀ·C and C ← C − V·(Tᵀ·W), two GEMMs. V is used as  //
+//  stored (rounded), so Q is exactly the one the vectors in A describe. //
+//---------------------------------------------------------------------
+template<typename Work = float, typename Accum1 = void, typename Accum2 = void, typename MatrixT>
+void geqrf(MatrixT& A, std::vector<Work>& tau, std::size_t nb = 32)
+{
+    using namespace factor_internal;
+    using idx = index_of<MatrixT>;
+    using T = typename MatrixT::value_type;
+    using PanelT = Lo_Gemm::Matrix<T, idx, Lo_Gemm::ColMajor>;
+    using PanelW = Lo_Gemm::Matrix<Work, idx, Lo_Gemm::ColMajor>;
+    using Gemm2 = Gemm<PanelW, PanelW, MatrixT, Accum1, Accum2>;
+    using Epi = epilogue_for_t<typename Gemm2::accum2_type, T>;
+
+    const std::size_t m = A.rows(), n = A.cols(), mn = std::min(m, n);
+    nb = std::max<std::size_t>(nb, 1);
+    tau.assign(mn, Work(0));
+
+    Gemm<PanelT, MatrixT, PanelW, Accum1, Accum2> vtc;     // W = Vᵀ·C
+    Gemm2 update;                                           // C ← C − V·W
+    Epi minus;
+    minus.alpha = -1;
+    minus.beta = 1;
+    epilogue_for_t<typename Gemm2::accum2_type, Work> overwrite;
+    overwrite.beta = 0;
+
+    std::vector<Work> P, Vw, Tf, W;
+    std::vector<T> Vt;
+
+    for (std::size_t j0 = 0; j0 < mn; j0 += nb)
+    {
+        const std::size_t jb = std::min(nb, mn - j0);
+        const std::size_t pm = m - j0;
+
+        //  panel, unblocked in Work
+        load(A, j0, j0, pm, jb, P);
+        for (std::size_t c = 0; c < jb; ++c)
+        {
+            Work* x = &P[c + c*pm];
+            const std::size_t len = pm - c;
+            Work sigma = 0;
+            for (std::size_t r = 1; r < len; ++r) sigma += x[r]*x[r];
+
+            Work t = 0;
+            if (sigma != Work(0)) {
+                const Work alpha = x[0];
+                const Work beta = -std::copysign(std::sqrt(alpha*alpha + sigma), alpha);
+                t = (beta - alpha) / beta;
+                const Work s = Work(1) / (alpha - beta);
+                for (std::size_t r = 1; r < len; ++r) x[r] *= s;
+                x[0] = beta;
+            }
+            tau[j0 + c] = t;
+            if (t == Work(0)) continue;
+
+            #pragma omp parallel for schedule(static)
+            for (std::size_t j = c + 1; j < jb; ++j) {
+                Work* y = &P[c + j*pm];
+                Work w = y[0];
+                for (std::size_t r = 1; r < len; ++r) w += x[r]*y[r];
+                w *= t;
+                y[0] -= w;
+                for (std::size_t r = 1; r < len; ++r) y[r] -= w*x[r];
+            }
+        }
+        store(A, j0, j0, pm, jb, P);
+
+        if (j0 + jb >= n) continue;
+        const std::size_t nr = n - j0 - jb;
+
+        //  V as stored : unit diagonal, zeros above, in the storage format and exactly in Work
+        Vt.resize(pm*jb);
+        Vw.resize(pm*jb);
+        for (std::size_t c = 0; c < jb; ++c)
+            for (std::size_t r = 0; r < pm; ++r) {
+                const T v = r < c ? T{} : (r == c ? lo_cast<T>(1.0f) : A(static_cast<idx>(j0 + r), static_cast<idx>(j0 + c)));
+                Vt[r + c*pm] = v;
+                Vw[r + c*pm] = lo_cast<Work>(v);
+            }
+
+        //  T upper triangular, forward column-wise : T(0:c, c) = −tau_c·T(0:c, 0:c)·V(:, 0:c)ᵀ·v_c
+        Tf.assign(jb*jb, Work(0));
+        for (std::size_t c = 0; c < jb; ++c) {
+            const Work t = tau[j0 + c];
+            Tf[c + c*jb] = t;
+            std::vector<Work> z(c, Work(0));
+            for (std::size_t s = 0; s < c; ++s)
+                for (std::size_t r = c; r < pm; ++r) z[s] += Vw[r + s*pm] * Vw[r + c*pm];
+            for (std::size_t i = 0; i < c; ++i) {
+                Work v = 0;
+                for (std::size_t s = i; s < c; ++s) v += Tf[i + s*jb] * z[s];
+                Tf[i + c*jb] = -t * v;
+            }
+        }
+
+        //  W = Vᵀ·C,  W ← Tᵀ·W,  C ← C − V·W
+        MatrixT C = A.block(static_cast<idx>(j0), static_cast<idx>(j0 + jb), static_cast<idx>(pm), static_cast<idx>(nr));
+        W.assign(jb*nr, Work(0));
+        PanelW Wm(W.data(), static_cast<idx>(jb), static_cast<idx>(nr), static_cast<idx>(jb));
+        const PanelT Vtm(Vt.data(), static_cast<idx>(pm), static_cast<idx>(jb), static_cast<idx>(pm));
+        vtc.run(Wm, Vtm, C, overwrite, Lo_Gemm::Trans, Lo_Gemm::NoTrans);
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < nr; ++j) {
+            Work* w = &W[j*jb];
+            for (std::size_t i = jb; i-- > 0;) {
+                Work v = 0;
+                for (std::size_t s = 0; s <= i; ++s) v += Tf[s + i*jb] * w[s];
+                w[i] = v;
+            }
+        }
+
+        const PanelW Vwm(Vw.data(), static_cast<idx>(pm), static_cast<idx>(jb), static_cast<idx>(pm));
+        update.run(C, Vwm, Wm, minus);
+    }
+}
+
+} // namespace LoGemm
@@ -0,0 +1,158 @@
+///@author Sudhanva Kulkarni
+/// Epilogues for LoGemm::Gemm. An epilogue is handed every finished MR×NR accumulator tile while it is still
+/// in registers and is responsible for writing it to C, so scaling, bias, activation and output quantization
+/// all happen in the same pass as the multiply.
+///
+/// Any type with a member
+///     template<typename T_tile, typename MatrixC>
+///     void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+///                std::size_t mr, std::size_t nr, MatrixC& C);
+/// can be passed to Gemm::run. tile is row major with leading dimension ld and holds A·B for the block of C
+/// whose top left element is (i0, j0).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "gemm_helpers.hpp"
+
+namespace LoGemm {
+
+enum class Activation : uint8_t {
+    Identity = 0,
+    ReLU = 1,
+    GELU = 2
+};
+
+enum class BiasMode : uint8_t {
+    None = 0,
+    PerRow = 1,     // bias[i] is added to row i of C
+    PerCol = 2      // bias[j] is added to column j of C
+};
+
+//  atomic max for floats - used to merge amax across threads
+template<typename T>
+inline void atomic_max(std::atomic<T>& a, T v) noexcept
+{
+    T cur = a.load(std::memory_order_relaxed);
+    while (cur < v && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+template<typename T>
+__attribute__((always_inline)) inline T activate(T x, Activation act) noexcept
+{
+    switch (act) {
+        case Activation::ReLU :
+            return x > T(0) ? x : T(0);
+        case Activation::GELU :
+            return T(0.5) * x * (T(1) + std::erf(x * T(0.70710678118654752440)));
+        default :
+            return x;
+    }
+}
+
+//  rounds v into the element format of C. Lo_float outputs can be given a rounding mode (including the
+//  stochastic ones) that differs from the one baked into the type.
+template<typename T_c, typename T>
+__attribute__((always_inline)) inline T_c round_to(T v, bool override_rounding, lo_float::Rounding_Mode mode)
+{
+    if constexpr (is_lo_float_v<T_c>) {
+        if (override_rounding) {
+            return lo_float::lo_float_internal::ConvertImpl<T, T_c>::run(v, mode);
+        }
+    }
+    return lo_cast<T_c>(v);
+}
+
+
+// -------------------------------------------------------------
+//  Built-in epilogue :                                          //
+//    C ← round( out_scale * act(alpha*A·B + beta*C + bias) )    //
+//  T is the type the epilogue arithmetic is carried out in.    //
+//  Defaults reproduce the plain C ← C + A·B update.            //
+// -------------------------------------------------------------
+template<typename T = float>
+struct Epilogue {
+    T alpha = T(1);
+    T beta  = T(1);
+
+    const T* bias = nullptr;
+    BiasMode bias_mode = BiasMode::None;
+
+    Activation act = Activation::Identity;
+
+    //  multiplier applied after the activation, e.g. the fp8 quantization scale
+    T out_scale = T(1);
+
+    //  round into C with round_mode instead of C's own rounding mode
+    bool override_rounding = false;
+    lo_float::Rounding_Mode round_mode = lo_float::Rounding_Mode::RoundToNearestEven;
+
+    //  track max |value| written (before out_scale and rounding)
+    bool track_amax = false;
+
+    Epilogue() = default;
+    Epilogue(const Epilogue& o)
+        : alpha(o.alpha), beta(o.beta), bias(o.bias), bias_mode(o.bias_mode), act(o.act),
+          out_scale(o.out_scale), override_rounding(o.override_rounding), round_mode(o.round_mode),
+          track_amax(o.track_amax), amax_(o.amax_.load()) {}
+
+    T amax() const noexcept { return amax_.load(); }
+    void reset_amax() noexcept { amax_.store(T(0)); }
+
+    template<typename T_tile, typename MatrixC>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr, std::size_t nr, MatrixC& C)
+    {
+        using T_c = typename MatrixC::value_type;
+        T local_max = T(0);
+
+        for (std::size_t i = 0; i < mr; ++i) {
+            for (std::size_t j = 0; j < nr; ++j) {
+                T v = alpha * lo_cast<T>(tile[i*ld + j]);
+                if (beta != T(0))
+                    v += beta * lo_cast<T>(C(i0 + i, j0 + j));
+                if (bias_mode == BiasMode::PerRow)
+                    v += bias[i0 + i];
+                else if (bias_mode == BiasMode::PerCol)
+                    v += bias[j0 + j];
+                v = activate(v, act);
+                if (track_amax)
+                    local_max = std::max(local_max, static_cast<T>(std::abs(v)));
+                C(i0 + i, j0 + j) = round_to<T_c>(v * out_scale, override_rounding, round_mode);
+            }
+        }
+
+        if (track_amax) atomic_max(amax_, local_max);
+    }
+
+private:
+    std::atomic<T> amax_{T(0)};
+};
+
+//  epilogue for a GEMM on the block of C whose top left element is (row0, col0) : hands every tile to
+//  inner in the coordinates of the whole C, so per row / per column state (bias, ...) lines up
+template<typename Epi, typename MatrixC>
+struct OffsetEpilogue {
+    Epi& inner;
+    MatrixC& C;
+    std::size_t row0;
+    std::size_t col0;
+
+    template<typename T_tile, typename MatrixV>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr, std::size_t nr, MatrixV&)
+    {
+        inner.apply(tile, ld, row0 + i0, col0 + j0, mr, nr, C);
+    }
+};
+
+//  Epilogue a routine uses when the caller passes none : double arithmetic when the accumulator
+//  or the output is double, float otherwise
+template<typename T_acc, typename T_c>
+using epilogue_for_t = Epilogue<std::conditional_t<std::is_same_v<T_acc, double> || std::is_same_v<T_c, double>, double, float>>;
+
+} // namespace LoGemm
@@ -0,0 +1,241 @@
+///@author Sudhanva Kulkarni
+/// Type helpers shared by the LoGemm kernels : detecting lo_float types, picking the native type panels are
+/// decoded into and moving values between formats without going through the generic std:: paths.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "lo_float.h"
+#include "lo_int.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace LoGemm {
+
+// -------------------------------------------------------------
+//  is_lo_float : true for Templated_Float instantiations        //
+// -------------------------------------------------------------
+template<typename T, typename = void>
+struct is_lo_float : std::false_type {};
+
+template<typename T>
+struct is_lo_float<T, std::void_t<decltype(T::mantissa_bits), decltype(std::declval<const T&>().rep())>>
+    : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_lo_float_v = is_lo_float<T>::value;
+
+
+// -------------------------------------------------------------
+//  pack_type : native type a lo_float code is decoded into when //
+//  it is packed. Chosen so that the product of two decoded      //
+//  values is exact (2*mantissa_bits + 1 bits of significand).   //
+// -------------------------------------------------------------
+template<typename T, bool = is_lo_float_v<T>>
+struct pack_type {
+    using type = T;
+};
+
+template<typename T>
+struct pack_type<T, true> {
+    using type = lo_float::lo_float_internal::AOpType<T::mantissa_bits>;
+};
+
+//  lo_float::i_n : the native integer of the same width, so packing is a copy and the integer kernels
+//  see plain int8_t / int16_t / ...
+template<int LEN, lo_float::Signedness S>
+struct pack_type<lo_float::i_n<LEN, S>, false> {
+    using type = std::conditional_t<S == lo_float::Signedness::Signed,
+                                    std::make_signed_t<lo_float::get_unsigned_type_t<LEN>>,
+                                    lo_float::get_unsigned_type_t<LEN>>;
+};
+
+template<typename T>
+using pack_type_t = typename pack_type<T>::type;
+
+
+// -------------------------------------------------------------
+//  is_lo_int : true for lo_float::i_n instantiations            //
+// -------------------------------------------------------------
+template<typename T>
+struct is_lo_int : std::false_type {};
+
+template<int LEN, lo_float::Signedness S>
+struct is_lo_int<lo_float::i_n<LEN, S>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_lo_int_v = is_lo_int<T>::value;
+
+
+//  default accumulator of the products within one MX block : integer elements sum them in int32_t, lo_int
+//  mantissas wider than 8 bits (BFP16) in int64_t, lo_floats in their pack type
+template<typename T>
+using mx_accum1_t = std::conditional_t<std::is_integral_v<T>, int32_t,
+                    std::conditional_t<is_lo_int_v<T>, std::conditional_t<(sizeof(pack_type_t<T>) > 1), int64_t, int32_t>,
+                                       pack_type_t<T>>>;
+
+
+//  void means "use the default" for the optional accumulator parameters of Gemm
+template<typename T, typename Default>
+using default_if_void_t = std::conditional_t<std::is_void_v<T>, Default, T>;
+
+
+// -------------------------------------------------------------
+//  lo_cast : conversion between any two of {native, lo_float}.  //
+//  lo_float -> lo_float goes through double, which is exact.    //
+// -------------------------------------------------------------
+template<typename To, typename From>
+__attribute__((always_inline)) inline To lo_cast(const From& x)
+{
+    if constexpr (std::is_same_v<To, From>) {
+        return x;
+    } else if constexpr (is_lo_float_v<From> && is_lo_float_v<To>) {
+        return To(static_cast<double>(x));
+    } else {
+        return static_cast<To>(x);
+    }
+}
+
+
+// -------------------------------------------------------------
+//  acc_fma / acc_add : c ← c + a*b and c ← c + v with a single  //
+//  rounding into the accumulator format of c.                   //
+// -------------------------------------------------------------
+template<typename T_acc, typename T_in>
+__attribute__((always_inline)) inline void acc_fma(T_acc& c, const T_in& a, const T_in& b)
+{
+    if constexpr (is_lo_float_v<T_acc>) {
+        c = T_acc(static_cast<double>(c) + static_cast<double>(a) * static_cast<double>(b));
+    } else {
+        c += static_cast<T_acc>(a) * static_cast<T_acc>(b);
+    }
+}
+
+template<typename T_acc, typename T_v>
+__attribute__((always_inline)) inline void acc_add(T_acc& c, const T_v& v)
+{
+    if constexpr (is_lo_float_v<T_acc>) {
+        c = T_acc(static_cast<double>(c) + static_cast<double>(v));
+    } else {
+        c += lo_cast<T_acc>(v);
+    }
+}
+
+
+// -------------------------------------------------------------
+//  decode_table : float value of each of the 256 byte codes of  //
+//  a lo_float of at most 8 bits. Bits above bitwidth are        //
+//  ignored, so padded sub-byte codes decode correctly.          //
+// -------------------------------------------------------------
+template<typename T>
+inline constexpr bool has_decode_table_v = [] {
+    if constexpr (is_lo_float_v<T>) return sizeof(T) == 1 && T::bitwidth <= 8;
+    else return false;
+}();
+
+template<typename T>
+inline const float* decode_table()
+{
+    static_assert(has_decode_table_v<T>, "decode_table needs a lo_float of at most 8 bits");
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t{};
+        constexpr unsigned mask = (1u << T::bitwidth) - 1u;
+        for (unsigned c = 0; c < 256; ++c)
+            t[c] = static_cast<float>(T::FromRep(static_cast<uint8_t>(c & mask)));
+        return t;
+    }();
+    return table.data();
+}
+
+//  byte code of an 8-bit-or-narrower lo_float as stored in memory
+template<typename T>
+__attribute__((always_inline)) inline uint8_t code_of(const T& x)
+{
+    uint8_t c;
+    std::memcpy(&c, &x, 1);
+    return c;
+}
+
+
+// -------------------------------------------------------------
+//  decode_n : dst[i] ← src[i*inc] for i < n, in the type of     //
+//  dst. Narrow lo_floats go through decode_table, eight codes   //
+//  per AVX2 gather when src is contiguous and dst is float;     //
+//  8 and 16 bit lo_ints are sign extended eight at a time.      //
+// -------------------------------------------------------------
+template<typename T, typename D>
+inline void decode_n(const T* src, std::ptrdiff_t inc, D* dst, std::size_t n)
+{
+    if constexpr (has_decode_table_v<T>) {
+        const float* lut = decode_table<T>();
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<D, float>) {
+            if (inc == 1) {
+                const uint8_t* codes = reinterpret_cast<const uint8_t*>(src);
+                for (; i + 8 <= n; i += 8) {
+                    const __m128i c8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + i));
+                    _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(lut, _mm256_cvtepu8_epi32(c8), 4));
+                }
+            }
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = static_cast<D>(lut[code_of(src[static_cast<std::ptrdiff_t>(i)*inc])]);
+    } else if constexpr (is_lo_int_v<T>) {
+        //  an i_n of 8 or 16 bits holds its two's complement in memory, widened eight at a time
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<D, float> && T::is_signed && (T::bits == 8 || T::bits == 16) && sizeof(T) == T::bits/8) {
+            if (inc == 1) {
+                for (; i + 8 <= n; i += 8) {
+                    __m256i v;
+                    if constexpr (T::bits == 8) v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+                    else v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                    _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(v));
+                }
+            }
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = static_cast<D>(src[static_cast<std::ptrdiff_t>(i)*inc]);
+    } else {
+        for (std::size_t i = 0; i < n; ++i)
+            dst[i] = lo_cast<D>(src[static_cast<std::ptrdiff_t>(i)*inc]);
+    }
+}
+
+
+//  number of threads a parallel region would get - 1 without OpenMP, and 1 when called
+//  from a region nested deeper than OpenMP will activate (e.g. one problem of a batch)
+inline int max_threads()
+{
+#ifdef _OPENMP
+    if (omp_get_active_level() >= omp_get_max_active_levels()) return 1;
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int thread_id()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+} // namespace LoGemm
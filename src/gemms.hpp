@@ -1,7 +1,15 @@
 #pragma  once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include "Matrix.h"
 #include "Vector.h"
 #include "cache_info.h"
+#include "gemm_helpers.hpp"
+#include "gemm_epilogue.hpp"
+#include "tuning_db.hpp"
 
 namespace LoGemm {
 
@@ -17,120 +25,700 @@ using GemmMicroKernel =
              std::size_t k_stride /* = KC */);
 
 //  Default reference micro-kernel (naïve – replace for speed).
-template<typename T, int MR, int NR>
-static void ref_kernel(const T* A, const T* B, T* C,
+//  A is packed as K columns of MR, B as K rows of NR.
+template<typename T_in, typename T_out, int MR, int NR>
+static void ref_kernel(const T_in* A, const T_in* B, T_out* C,
                        std::size_t rs_c, std::size_t cs_c,
                        std::size_t K) noexcept
 {
     for (std::size_t k = 0; k < K; ++k)           // kc loop
         for (int j = 0; j < NR; ++j)
             for (int i = 0; i < MR; ++i)
-                C[i*rs_c + j*cs_c] += A[i + k*MR] * B[k*NR + j];
+                acc_fma(C[i*rs_c + j*cs_c], A[i + k*MR], B[k*NR + j]);
+}
+
+//  Register blocked micro-kernel : the C tile lives in locals for the whole
+//  K loop and each element of A is broadcast against a row of B.
+template<typename T_in, typename T_out, int MR, int NR>
+static void reg_kernel(const T_in* A, const T_in* B, T_out* C,
+                       std::size_t rs_c, std::size_t cs_c,
+                       std::size_t K) noexcept
+{
+    T_out c[MR][NR];
+    for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            c[i][j] = C[i*rs_c + j*cs_c];
+
+    for (std::size_t k = 0; k < K; ++k)
+        for (int i = 0; i < MR; ++i) {
+            const T_in a = A[i + k*MR];
+            for (int j = 0; j < NR; ++j)
+                acc_fma(c[i][j], a, B[k*NR + j]);
+        }
+
+    for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            C[i*rs_c + j*cs_c] = c[i][j];
+}
+
+//  largest register tile any micro-kernel may use
+inline constexpr std::size_t MAX_MR = 16;
+inline constexpr std::size_t MAX_NR = 16;
+
+template<typename T_in, typename T_out>
+struct MicroKernelDesc {
+    const char* name;
+    std::size_t MR;
+    std::size_t NR;
+    GemmMicroKernel<T_in, T_out> fn;
+};
+
+//  micro-kernels available for a (packed input, accumulator) pair - the autotuner's candidates
+template<typename T_in, typename T_out>
+inline const std::vector<MicroKernelDesc<T_in, T_out>>& micro_kernels()
+{
+    static const std::vector<MicroKernelDesc<T_in, T_out>> list = {
+        {"ref", 4, 4,  &ref_kernel<T_in, T_out, 4, 4>},
+        {"reg", 4, 4,  &reg_kernel<T_in, T_out, 4, 4>},
+        {"reg", 4, 8,  &reg_kernel<T_in, T_out, 4, 8>},
+        {"reg", 8, 4,  &reg_kernel<T_in, T_out, 8, 4>},
+        {"reg", 8, 8,  &reg_kernel<T_in, T_out, 8, 8>},
+        {"reg", 6, 16, &reg_kernel<T_in, T_out, 6, 16>},
+    };
+    return list;
+}
+
+template<typename T_in, typename T_out>
+inline const MicroKernelDesc<T_in, T_out>* find_micro_kernel(const std::string& name, std::size_t MR, std::size_t NR)
+{
+    for (const auto& d : micro_kernels<T_in, T_out>())
+        if (name == d.name && d.MR == MR && d.NR == NR) return &d;
+    return nullptr;
 }
 
 
-template<typename MatrixA, typename MatrixB, typename MatrixC, typename MatrixAccum1 = void, typename MatrixAccum2 = void>
+// -------------------------------------------------------------
+//  Cache blocking (analytical BLIS model) :                     //
+//    KC : an MR×KC micro panel of A and a KC×NR micro panel     //
+//         of B share half of L1 next to the C tile              //
+//    MC : the packed MC×KC block of A fills half of L2          //
+//    NC : the packed KC×NC panel of B fills half of L3          //
+//  Sizes are in elements of the packed (decoded) type.          //
+// -------------------------------------------------------------
+struct BlockingParams {
+    std::size_t MC;
+    std::size_t KC;
+    std::size_t NC;
+};
+
+inline BlockingParams derive_blocking(const CacheInfo& cache, std::size_t MR, std::size_t NR,
+                                      std::size_t in_bytes, std::size_t acc1_bytes, std::size_t acc2_bytes)
+{
+    BlockingParams b{};
+
+    const std::size_t c_tile = MR*NR*(acc1_bytes + acc2_bytes);
+    const std::size_t l1_budget = cache.L1/2 > c_tile ? cache.L1/2 - c_tile : cache.L1/4;
+    b.KC = l1_budget / ((MR + NR)*in_bytes);
+    b.KC = std::clamp<std::size_t>(b.KC / 8 * 8, 16, 4096);
+
+    b.MC = (cache.L2/2) / (b.KC*in_bytes);
+    b.MC = std::max<std::size_t>(b.MC / MR * MR, MR);
+
+    const std::size_t l3 = cache.L3 ? cache.L3 : cache.L2;
+    b.NC = (l3/2) / (b.KC*in_bytes);
+    b.NC = std::clamp<std::size_t>(b.NC / NR * NR, NR, 16384 / NR * NR);
+
+    return b;
+}
+
+template<typename T_in, typename T_acc1, typename T_acc2 = T_acc1>
+inline BlockingParams blocking_for(std::size_t MR, std::size_t NR)
+{
+    return derive_blocking(cache_info(), MR, NR, sizeof(T_in), sizeof(T_acc1), sizeof(T_acc2));
+}
+
+
+//  Accum1 is the format the micro-kernel accumulates an MR×NR tile in over one KC panel,
+//  Accum2 the format partial tiles are summed in across KC panels. void picks the decoded
+//  input type for Accum1 and Accum1 for Accum2.
+template<typename MatrixA, typename MatrixB, typename MatrixC, typename Accum1 = void, typename Accum2 = void>
 class Gemm {
     using value_type = typename MatrixA::value_type;
+    using pack_t     = pack_type_t<value_type>;
+    using acc1_t     = default_if_void_t<Accum1, pack_t>;
+    using acc2_t     = default_if_void_t<Accum2, acc1_t>;
+
+    static_assert(std::is_same_v<value_type, typename MatrixB::value_type>,
+                  "Matrix A and B must hold the same element type");
+
+    //  Register tile and micro-kernel. Cache blocking is derived from the machine at
+    //  construction; both are replaced per call by a tuned configuration from the
+    //  tuning database unless they were set explicitly.
+    std::size_t MR_ = 4;
+    std::size_t NR_ = 4;
+    std::string kname_ = "ref";
+    GemmMicroKernel<pack_t, acc1_t> ukr_ = &ref_kernel<pack_t, acc1_t, 4, 4>;
+
+    BlockingParams blk_ = blocking_for<pack_t, acc1_t, acc2_t>(4, 4);
+
+    bool pinned_ = false;
+    bool use_tuned_ = true;
+
+    //  last tuned lookup : valid while shape class, thread count and database generation match
+    struct TunedCache {
+        std::string shape;
+        int threads = 0;
+        std::uint64_t generation = 0;
+        bool valid = false;
+    };
+
+    //  number of K slices, 1 = no split-K, split_k_auto = chosen from the shape
+    std::size_t split_k_ = 1;
+    static constexpr std::size_t max_split_k = 64;
 
-    static_assert(MatrixA::layout == MatrixB::layout,
-                  "Matrix A and B must have the same layout");
-    static_assert(MatrixA::layout == MatrixC::layout,
-                  "Matrix A and C must have the same layout");
-    static_assert(MatrixA::layout == MatrixAccum1::layout,   
-                  "Matrix A and Accum1 must have the same layout");
-    static_assert(MatrixA::layout == MatrixAccum2::layout,
-                  "Matrix A and Accum2 must have the same layout");
-    
-    // Tile sizes – query cache or use sensible defaults
-    static constexpr std::size_t NC = 512;
-    static constexpr std::size_t KC = 128;
-    static constexpr std::size_t MC = 256;
-    static constexpr std::size_t MR =  4;
-    static constexpr std::size_t NR =  4;
-
-    MicroKernel<value_type> ukr_ = &ref_kernel<value_type,MR,NR>;
+    bool pipelined_ = false;
+
+    //  packed panels, kept between calls so repeated runs do not reallocate
+    std::vector<pack_t> Ap_;
+    std::vector<pack_t> Bp_;
+    std::vector<acc2_t> Cw_;
+    std::vector<acc2_t> Ws_;       // split-K slice accumulators
+
+    //  configuration actually used by one call
+    struct RunConfig {
+        GemmMicroKernel<pack_t, acc1_t> ukr;
+        std::size_t MR, NR;
+        BlockingParams blk;
+    };
+
+    mutable TunedCache tuned_cache_;
+    mutable RunConfig tuned_rc_{};
+
+    //  op(X) seen as a strided view : element (i, j) of op(X) is at data[i*rs + j*cs].
+    //  Transposition only swaps the strides, so any mix of layouts and ops packs
+    //  straight from the caller's storage.
+    template<typename MatrixX>
+    struct OpView {
+        const value_type* data;
+        std::size_t rs;
+        std::size_t cs;
+
+        OpView(const MatrixX& X, Lo_Gemm::Op op)
+            : data(X.data),
+              rs(op == Lo_Gemm::NoTrans ? X.row_stride() : X.col_stride()),
+              cs(op == Lo_Gemm::NoTrans ? X.col_stride() : X.row_stride()) {}
+    };
+
+    // pack op(A)(ic:ic+mc, pc:pc+kc) into MR-row micro panels, zero padding the last one.
+    // The loop order follows whichever of the two directions is contiguous in memory.
+    static void pack_A(const value_type* a, std::size_t rs, std::size_t cs, pack_t* Ap,
+                       std::size_t ic, std::size_t pc, std::size_t mc, std::size_t kc, std::size_t MR)
+    {
+        for (std::size_t ir = 0; ir < mc; ir += MR)
+        {
+            const std::size_t mr = std::min<std::size_t>(MR, mc - ir);
+            const value_type* src = a + (ic+ir)*rs + pc*cs;
+            pack_t* dst = Ap + ir*kc;
+
+            if (rs <= cs) {         // columns of op(A) are contiguous
+                for (std::size_t kk = 0; kk < kc; ++kk)
+                    for (std::size_t i = 0; i < mr; ++i)
+                        dst[kk*MR + i] = lo_cast<pack_t>(src[i*rs + kk*cs]);
+            } else {                // rows of op(A) are contiguous
+                for (std::size_t i = 0; i < mr; ++i)
+                    for (std::size_t kk = 0; kk < kc; ++kk)
+                        dst[kk*MR + i] = lo_cast<pack_t>(src[i*rs + kk*cs]);
+            }
+
+            for (std::size_t kk = 0; kk < kc; ++kk)
+                for (std::size_t i = mr; i < MR; ++i)
+                    dst[kk*MR + i] = pack_t{};
+        }
+    }
+
+    // pack op(B)(pc:pc+kc, jc:jc+nc) into NR-column micro panels, zero padding the last one
+    static void pack_B(const value_type* b, std::size_t rs, std::size_t cs, pack_t* Bp,
+                       std::size_t pc, std::size_t jc, std::size_t kc, std::size_t nc, std::size_t NR)
+    {
+        for (std::size_t jr = 0; jr < nc; jr += NR)
+        {
+            const std::size_t nr = std::min<std::size_t>(NR, nc - jr);
+            const value_type* src = b + pc*rs + (jc+jr)*cs;
+            pack_t* dst = Bp + jr*kc;
+
+            if (cs <= rs) {         // rows of op(B) are contiguous
+                for (std::size_t kk = 0; kk < kc; ++kk)
+                    for (std::size_t j = 0; j < nr; ++j)
+                        dst[kk*NR + j] = lo_cast<pack_t>(src[kk*rs + j*cs]);
+            } else {                // columns of op(B) are contiguous
+                for (std::size_t j = 0; j < nr; ++j)
+                    for (std::size_t kk = 0; kk < kc; ++kk)
+                        dst[kk*NR + j] = lo_cast<pack_t>(src[kk*rs + j*cs]);
+            }
+
+            for (std::size_t kk = 0; kk < kc; ++kk)
+                for (std::size_t j = nr; j < NR; ++j)
+                    dst[kk*NR + j] = pack_t{};
+        }
+    }
+
+    static constexpr std::size_t round_up(std::size_t x, std::size_t r) { return (x + r - 1) / r * r; }
+
+    static BlockingParams fit_blocking(const BlockingParams& b, std::size_t MR, std::size_t NR) noexcept
+    {
+        return {std::max<std::size_t>(b.MC / MR * MR, MR),
+                std::max<std::size_t>(b.KC, 1),
+                std::max<std::size_t>(b.NC / NR * NR, NR)};
+    }
+
+    RunConfig config_for(std::size_t m, std::size_t n, std::size_t k) const
+    {
+        RunConfig rc{ukr_, MR_, NR_, blk_};
+        if (pinned_ || !use_tuned_) return rc;
+
+        //  repeated calls in one shape class skip the key string and the database lock
+        const TuningDatabase& db = tuning_database();
+        const std::string shape = shape_class(m, n, k);
+        const int threads = max_threads();
+        const std::uint64_t gen = db.generation();
+        if (tuned_cache_.valid && tuned_cache_.shape == shape && tuned_cache_.threads == threads
+            && tuned_cache_.generation == gen)
+            return tuned_rc_;
+
+        tuned_cache_ = {shape, threads, gen, true};
+        tuned_rc_ = rc;
+
+        auto tuned = db.find(tuning_key(m, n, k));
+        if (!tuned) return rc;
+        auto desc = find_micro_kernel<pack_t, acc1_t>(tuned->kernel, tuned->MR, tuned->NR);
+        if (!desc) return rc;
+
+        rc.ukr = desc->fn;
+        rc.MR = desc->MR;
+        rc.NR = desc->NR;
+        rc.blk = (tuned->MC && tuned->KC && tuned->NC)
+                     ? fit_blocking({tuned->MC, tuned->KC, tuned->NC}, rc.MR, rc.NR)
+                     : blocking_for<pack_t, acc1_t, acc2_t>(rc.MR, rc.NR);
+        tuned_rc_ = rc;
+        return rc;
+    }
 
 public:
-    Gemm() = default; 
-    explicit Gemm(MicroKernel<value_type> user_kernel) : ukr_(user_kernel) {}
+    using micro_kernel_type = GemmMicroKernel<pack_t, acc1_t>;
+    using input_type = value_type;
+    using accum1_type = acc1_t;
+    using accum2_type = acc2_t;
+
+    Gemm() = default;
+    explicit Gemm(micro_kernel_type user_kernel) { set_micro_kernel(user_kernel); }
 
-    void set_micro_kernel(MicroKernel<value_type> k) noexcept { ukr_ = k; }
+    //  a user kernel keeps the current MR×NR unless told otherwise
+    void set_micro_kernel(micro_kernel_type k) noexcept { set_micro_kernel(k, MR_, NR_); }
+
+    void set_micro_kernel(micro_kernel_type k, std::size_t MR, std::size_t NR) noexcept
+    {
+        ukr_ = k;
+        MR_ = std::clamp<std::size_t>(MR, 1, MAX_MR);
+        NR_ = std::clamp<std::size_t>(NR, 1, MAX_NR);
+        kname_ = "user";
+        blk_ = fit_blocking(blk_, MR_, NR_);
+        pinned_ = true;
+    }
+
+    const BlockingParams& blocking() const noexcept { return blk_; }
+
+    //  MC and NC are rounded down to multiples of MR and NR
+    void set_blocking(const BlockingParams& b) noexcept
+    {
+        blk_ = fit_blocking(b, MR_, NR_);
+        pinned_ = true;
+    }
+
+    //  pins a registered kernel and blocking; returns false if the kernel is unknown
+    bool set_config(const GemmConfig& c)
+    {
+        auto desc = find_micro_kernel<pack_t, acc1_t>(c.kernel, c.MR, c.NR);
+        if (!desc) return false;
+        ukr_ = desc->fn;
+        MR_ = desc->MR;
+        NR_ = desc->NR;
+        kname_ = desc->name;
+        blk_ = (c.MC && c.KC && c.NC) ? fit_blocking({c.MC, c.KC, c.NC}, MR_, NR_)
+                                      : blocking_for<pack_t, acc1_t, acc2_t>(MR_, NR_);
+        pinned_ = true;
+        return true;
+    }
+
+    GemmConfig config() const
+    {
+        return {kname_, MR_, NR_, blk_.MC, blk_.KC, blk_.NC, 0.0};
+    }
+
+    //  Split-K : K is cut into `slices` ranges of whole KC panels that threads accumulate
+    //  independently (in Accum1 per panel, Accum2 per slice) and that are then reduced in a
+    //  fixed tree. The result is bitwise identical for any thread count. Meant for small m·n
+    //  with long K, where the IC loop alone leaves threads idle.
+    static constexpr std::size_t split_k_auto = 0;
+
+    void set_split_k(std::size_t slices) noexcept { split_k_ = std::min(slices, max_split_k); }
+    std::size_t split_k() const noexcept { return split_k_; }
+
+    //  Pipelined mode : one thread of the team packs the next A block / B panel into a second
+    //  buffer while the others (and then it) run the micro-kernels on the current ones. Worth it
+    //  when decoding dominates packing, e.g. fp4/fp6 inputs. Needs OpenMP to overlap anything.
+    void set_pipelined(bool on) noexcept { pipelined_ = on; }
+    bool pipelined() const noexcept { return pipelined_; }
+
+    //  consult the tuning database for calls whose configuration was not pinned (default on)
+    void use_tuning(bool on) noexcept { use_tuned_ = on; }
+
+    //  drops pinned settings and returns to the derived defaults
+    void reset_config()
+    {
+        MR_ = NR_ = 4;
+        kname_ = "ref";
+        ukr_ = &ref_kernel<pack_t, acc1_t, 4, 4>;
+        blk_ = blocking_for<pack_t, acc1_t, acc2_t>(4, 4);
+        pinned_ = false;
+        tuned_cache_.valid = false;
+    }
+
+    static std::string tuning_key(std::size_t m, std::size_t n, std::size_t k)
+    {
+        return TuningDatabase::make_key(format_tag<value_type>(),
+                                        format_tag<acc1_t>() + "/" + format_tag<acc2_t>(),
+                                        shape_class(m, n, k), max_threads());
+    }
+
+    //---------------------------------------------------------------------
+    //  C ← C + op(A)·op(B)          op(X) ∈ {X, Xᵀ}                        //
+    //---------------------------------------------------------------------
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        epilogue_for_t<acc2_t, typename MatrixC::value_type> epi;
+        run(C, A, B, epi, opA, opB);
+    }
 
     //---------------------------------------------------------------------
-    //  C ← C + A·B            ( no transposition for brevity )            //
+    //  C ← epi(op(A)·op(B))  - epi is applied to each MR×NR tile once its  //
+    //  K reduction is complete, before the tile leaves registers.         //
+    //  With OpenMP the IC loop runs in parallel, so epi.apply is called   //
+    //  concurrently on disjoint tiles.                                    //
     //---------------------------------------------------------------------
-    void run(MatrixC& C, const MatrixA& A, const MatrixB& B)
+    template<typename Epi>
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B, Epi& epi,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
     {
-        const std::size_t m = A.rows();
-        const std::size_t n = B.cols();
-        const std::size_t k = A.cols();
-        
-        Layout layout = A::layout;
+        const std::size_t m = opA == Lo_Gemm::NoTrans ? A.rows() : A.cols();
+        const std::size_t n = opB == Lo_Gemm::NoTrans ? B.cols() : B.rows();
+        const std::size_t k = opA == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+
+        const OpView<MatrixA> a(A, opA);
+        const OpView<MatrixB> b(B, opB);
+
+        if (m == 0 || n == 0) return;
+
+        //  split-K ignores the tuning database : tuned blocking depends on the thread
+        //  count, and the slice boundaries must not
+        if (split_k_ != 1) {
+            const RunConfig rc{ukr_, MR_, NR_, blk_};
+            const std::size_t slices = split_k_slices(m, n, k, rc.blk.KC);
+            if (slices > 1) {
+                run_split_k(C, a, b, m, n, k, rc, slices, epi);
+                return;
+            }
+        }
 
+        const RunConfig rc = config_for(m, n, k);
+        if (pipelined_) {
+            run_pipelined(C, a, b, m, n, k, rc, epi);
+            return;
+        }
 
-        //change loops based on layout
+        const std::size_t NC = rc.blk.NC;
+        const std::size_t KC = rc.blk.KC;
+        const std::size_t MR = rc.MR;
+        const std::size_t NR = rc.NR;
 
+        //  shrink MC so every thread gets at least one IC block
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        const std::size_t MC = std::min(rc.blk.MC, round_up((m + nt - 1) / nt, MR));
+        const std::size_t ic_blocks = (m + MC - 1) / MC;
 
+        //  k == 0 still runs one (empty) panel so the epilogue sees every tile
+        const std::size_t k_panels = std::max<std::size_t>(1, (k + KC - 1) / KC);
 
+        const std::size_t kmax = std::min(KC, std::max<std::size_t>(k, 1));
+        const std::size_t ap_size = round_up(std::min(MC, m), MR) * kmax;
+        Bp_.resize(round_up(std::min(NC, n), NR) * kmax);
+        Ap_.resize(ap_size * nt);
 
         //  ───────── outer‐most JC loop  (N dimension, B panels) ─────────
         for (std::size_t jc = 0; jc < n; jc += NC)
         {
             const std::size_t nc = std::min<std::size_t>(NC, n - jc);
+            const std::size_t jr_panels = (nc + NR - 1) / NR;
+
+            // partial sums of C(:, jc:jc+nc) across KC panels, in Accum2
+            if (k_panels > 1) Cw_.assign(m*nc, acc2_t{});
 
             //  ─────── PC loop  (K dimension, shared by A & B panels) ────
-            for (std::size_t pc = 0; pc < k; pc += KC)
+            for (std::size_t p = 0; p < k_panels; ++p)
             {
+                const std::size_t pc = p*KC;
                 const std::size_t kc = std::min<std::size_t>(KC, k - pc);
+                const bool last = (p + 1 == k_panels);
 
-                // ---- pack B_panel (KC×nc) into contiguous buffer ----
-                std::vector<value_type> Bp(kc*nc);
-                for (std::size_t kk = 0; kk < kc; ++kk)
-                    for (std::size_t jj = 0; jj < nc; ++jj)
-                        Bp[kk*nc + jj] = B(pc+kk, jc+jj);
+                // ---- pack B_panel (KC×nc), one NR micro panel per iteration ----
+                #pragma omp parallel for schedule(static)
+                for (std::size_t q = 0; q < jr_panels; ++q)
+                    pack_B(b.data, b.rs, b.cs, Bp_.data() + q*NR*kc, pc, jc + q*NR, kc,
+                           std::min<std::size_t>(NR, nc - q*NR), NR);
 
-                //  ───── IC loop  (M dimension, A panels) ─────
-                for (std::size_t ic = 0; ic < m; ic += MC)
+                //  ───── IC loop  (M dimension, A panels, one per thread) ─────
+                #pragma omp parallel for schedule(dynamic)
+                for (std::size_t ib = 0; ib < ic_blocks; ++ib)
                 {
+                    const std::size_t ic = ib*MC;
                     const std::size_t mc = std::min<std::size_t>(MC, m - ic);
+                    pack_t* Ap = Ap_.data() + static_cast<std::size_t>(thread_id())*ap_size;
+
+                    // pack A_panel (mc×KC) into this thread's buffer
+                    pack_A(a.data, a.rs, a.cs, Ap, ic, pc, mc, kc, MR);
+
+                    macro_kernel(rc, Ap, Bp_.data(), mc, nc, kc,
+                        [&](std::size_t ir, std::size_t jr, std::size_t mr, std::size_t nr, const acc1_t* tile)
+                        {
+                            acc2_t* W = (k_panels > 1) ? &Cw_[(ic+ir)*nc + jr] : nullptr;
+                            finish_tile(tile, NR, W, nc, last, ic+ir, jc+jr, mr, nr, epi, C);
+                        });
+                }         // ic
+            }             // pc
+        }                 // jc
+    }
+
+private:
+    //  ─── jr / ir loops at micro-kernel granularity ───
+    //  runs the micro-kernel on every MR×NR tile of a packed mc×kc block of A times a packed
+    //  kc×nc panel of B and hands the tile to sink(ir, jr, mr, nr, tile). Panels are zero
+    //  padded, so edge tiles run the full kernel and only the mr×nr corner is meaningful.
+    template<typename Sink>
+    static void macro_kernel(const RunConfig& rc, const pack_t* Ap, const pack_t* Bp,
+                             std::size_t mc, std::size_t nc, std::size_t kc, Sink&& sink)
+    {
+        for (std::size_t jr = 0; jr < nc; jr += rc.NR)
+        {
+            const std::size_t nr = std::min<std::size_t>(rc.NR, nc - jr);
+
+            for (std::size_t ir = 0; ir < mc; ir += rc.MR)
+            {
+                const std::size_t mr = std::min<std::size_t>(rc.MR, mc - ir);
+
+                acc1_t tile[MAX_MR*MAX_NR];
+                std::fill_n(tile, rc.MR*rc.NR, acc1_t{});
+                rc.ukr(&Ap[ir*kc], &Bp[jr*kc], tile, rc.NR, 1, kc);
+                sink(ir, jr, mr, nr, static_cast<const acc1_t*>(tile));
+            }
+        }
+    }
+
+    //  A finished MR×NR tile of one KC panel : added into the Accum2 workspace W (ld ldw) unless
+    //  it is the last panel, in which case W + tile goes through the epilogue into C.
+    template<typename Epi>
+    static void finish_tile(const acc1_t* tile, std::size_t NR, acc2_t* W, std::size_t ldw, bool last,
+                            std::size_t i0, std::size_t j0, std::size_t mr, std::size_t nr, Epi& epi, MatrixC& C)
+    {
+        if (!last) {
+            for (std::size_t i = 0; i < mr; ++i)
+                for (std::size_t j = 0; j < nr; ++j)
+                    acc_add(W[i*ldw + j], tile[i*NR + j]);
+            return;
+        }
+
+        acc2_t out[MAX_MR*MAX_NR];
+        for (std::size_t i = 0; i < mr; ++i)
+            for (std::size_t j = 0; j < nr; ++j) {
+                out[i*NR + j] = W ? W[i*ldw + j] : acc2_t{};
+                acc_add(out[i*NR + j], tile[i*NR + j]);
+            }
+
+        epi.apply(out, NR, i0, j0, mr, nr, C);
+    }
+
+    //  Pipelined : the (pc, ic) blocks of one JC panel are visited as a sequence of steps. While
+    //  the team runs the micro-kernels of step s on one pair of buffers, one thread packs the A
+    //  block of step s+1 (and the B panel, when s+1 starts a new pc) into the other pair, then
+    //  joins the compute loop. B buffers alternate with pc and A buffers with the step, so a
+    //  buffer is only overwritten once the step that read it has passed the barrier.
+    //  Tiles see the same operations in the same order as in the regular path.
+    template<typename Epi>
+    void run_pipelined(MatrixC& C, const OpView<MatrixA>& a, const OpView<MatrixB>& b,
+                       std::size_t m, std::size_t n, std::size_t k, const RunConfig& rc, Epi& epi)
+    {
+        const std::size_t NC = rc.blk.NC;
+        const std::size_t KC = rc.blk.KC;
+        const std::size_t MC = rc.blk.MC;
+        const std::size_t MR = rc.MR;
+        const std::size_t NR = rc.NR;
 
-                    // pack A_panel (mc×KC) into contiguous buffer
-                    std::vector<value_type> Ap(mc*kc);
-                    for (std::size_t ii = 0; ii < mc; ++ii)
-                        for (std::size_t kk = 0; kk < kc; ++kk)
-                            Ap[ii*kc + kk] = A(ic+ii, pc+kk);
+        const std::size_t k_panels = std::max<std::size_t>(1, (k + KC - 1) / KC);
+        const std::size_t ic_blocks = (m + MC - 1) / MC;
+        const std::size_t steps = k_panels * ic_blocks;
 
-                    //  ─── jr / ir loops at micro-kernel granularity ───
-                    for (std::size_t jr = 0; jr < nc; jr += NR)
+        const std::size_t kmax = std::min(KC, std::max<std::size_t>(k, 1));
+        const std::size_t ap_size = round_up(std::min(MC, m), MR) * kmax;
+        const std::size_t bp_size = round_up(std::min(NC, n), NR) * kmax;
+        Ap_.resize(2*ap_size);
+        Bp_.resize(2*bp_size);
+
+        for (std::size_t jc = 0; jc < n; jc += NC)
+        {
+            const std::size_t nc = std::min<std::size_t>(NC, n - jc);
+            const std::size_t jr_panels = (nc + NR - 1) / NR;
+            if (k_panels > 1) Cw_.assign(m*nc, acc2_t{});
+
+            //  packs what step s reads; B only on the first step of a panel
+            auto pack_step = [&](std::size_t s) {
+                const std::size_t p = s / ic_blocks, ib = s % ic_blocks;
+                const std::size_t pc = p*KC, kc = std::min<std::size_t>(KC, k - pc);
+                const std::size_t ic = ib*MC, mc = std::min<std::size_t>(MC, m - ic);
+                if (ib == 0)
+                    pack_B(b.data, b.rs, b.cs, Bp_.data() + (p & 1)*bp_size, pc, jc, kc, nc, NR);
+                pack_A(a.data, a.rs, a.cs, Ap_.data() + (s & 1)*ap_size, ic, pc, mc, kc, MR);
+            };
+
+            pack_step(0);
+
+            for (std::size_t s = 0; s < steps; ++s)
+            {
+                const std::size_t p = s / ic_blocks, ib = s % ic_blocks;
+                const std::size_t pc = p*KC, kc = std::min<std::size_t>(KC, k - pc);
+                const std::size_t ic = ib*MC, mc = std::min<std::size_t>(MC, m - ic);
+                const bool last = (p + 1 == k_panels);
+                const pack_t* Ap = Ap_.data() + (s & 1)*ap_size;
+                const pack_t* Bp = Bp_.data() + (p & 1)*bp_size;
+
+                #pragma omp parallel
+                {
+                    #pragma omp single nowait
                     {
-                        const std::size_t nr = std::min<std::size_t>(NR, nc - jr);
+                        if (s + 1 < steps) pack_step(s + 1);
+                    }
+
+                    #pragma omp for schedule(dynamic) nowait
+                    for (std::size_t q = 0; q < jr_panels; ++q)
+                    {
+                        const std::size_t jr = q*NR;
+                        macro_kernel(rc, Ap, Bp + jr*kc, mc, std::min<std::size_t>(NR, nc - jr), kc,
+                            [&](std::size_t ir, std::size_t, std::size_t mr, std::size_t nr, const acc1_t* tile)
+                            {
+                                acc2_t* W = (k_panels > 1) ? &Cw_[(ic+ir)*nc + jr] : nullptr;
+                                finish_tile(tile, NR, W, nc, last, ic+ir, jc+jr, mr, nr, epi, C);
+                            });
+                    }
+                }
+            }
+        }
+    }
+
+    //  Slice count for split-K. Only the shape and KC enter, never the thread count. Auto mode
+    //  splits when K dominates (m·n ≤ k and at least 4 KC panels) into a power of two number of
+    //  slices of at least 2 panels each.
+    std::size_t split_k_slices(std::size_t m, std::size_t n, std::size_t k, std::size_t KC) const noexcept
+    {
+        const std::size_t k_panels = (k + KC - 1) / KC;
+        if (k_panels < 2) return 1;
+        if (split_k_ != split_k_auto) return std::min(split_k_, k_panels);
+        if (k_panels < 4 || m*n > k) return 1;
+
+        std::size_t s = 1;
+        while (2*s <= std::min(k_panels / 2, max_split_k)) s *= 2;
+        return s;
+    }
 
-                        for (std::size_t ir = 0; ir < mc; ir += MR)
+    //  W(m×n, row major) += op(A)(:, k0:k1)·op(B)(k0:k1, :), serially with the given buffers
+    static void slice_product(const OpView<MatrixA>& a, const OpView<MatrixB>& b, const RunConfig& rc,
+                              std::size_t m, std::size_t n, std::size_t k0, std::size_t k1,
+                              acc2_t* W, pack_t* Ap, pack_t* Bp)
+    {
+        const std::size_t NR = rc.NR;
+
+        for (std::size_t jc = 0; jc < n; jc += rc.blk.NC)
+        {
+            const std::size_t nc = std::min<std::size_t>(rc.blk.NC, n - jc);
+
+            for (std::size_t pc = k0; pc < k1; pc += rc.blk.KC)
+            {
+                const std::size_t kc = std::min<std::size_t>(rc.blk.KC, k1 - pc);
+                pack_B(b.data, b.rs, b.cs, Bp, pc, jc, kc, nc, NR);
+
+                for (std::size_t ic = 0; ic < m; ic += rc.blk.MC)
+                {
+                    const std::size_t mc = std::min<std::size_t>(rc.blk.MC, m - ic);
+                    pack_A(a.data, a.rs, a.cs, Ap, ic, pc, mc, kc, rc.MR);
+
+                    macro_kernel(rc, Ap, Bp, mc, nc, kc,
+                        [&](std::size_t ir, std::size_t jr, std::size_t mr, std::size_t nr, const acc1_t* tile)
                         {
-                            const std::size_t mr = std::min<std::size_t>(MR, mc - ir);
+                            acc2_t* w = W + (ic+ir)*n + jc + jr;
+                            for (std::size_t i = 0; i < mr; ++i)
+                                for (std::size_t j = 0; j < nr; ++j)
+                                    acc_add(w[i*n + j], tile[i*NR + j]);
+                        });
+                }
+            }
+        }
+    }
+
+    //  Split-K : slice s covers KC panels [s·P/S, (s+1)·P/S) and is accumulated into its own m×n
+    //  Accum2 buffer by whichever thread picks it up. The slices are then summed pairwise,
+    //  level by level (s absorbs s + stride for stride = 1, 2, 4, ...), so every element of C
+    //  sees the same sequence of roundings for any number of threads.
+    template<typename Epi>
+    void run_split_k(MatrixC& C, const OpView<MatrixA>& a, const OpView<MatrixB>& b,
+                     std::size_t m, std::size_t n, std::size_t k,
+                     const RunConfig& rc, std::size_t slices, Epi& epi)
+    {
+        const std::size_t KC = rc.blk.KC;
+        const std::size_t k_panels = (k + KC - 1) / KC;
+        const std::size_t mn = m*n;
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
 
-                            //  _Pointers into packed A, B and into C_
-                            const value_type* A_block = &Ap[ir*kc];
-                            const value_type* B_block = &Bp[jr];
-                            value_type*       C_block = &C(ic+ir, jc+jr);
+        const std::size_t ap_size = round_up(std::min(rc.blk.MC, m), rc.MR) * KC;
+        const std::size_t bp_size = round_up(std::min(rc.blk.NC, n), rc.NR) * KC;
+        Ap_.resize(ap_size * nt);
+        Bp_.resize(bp_size * nt);
+        Ws_.assign(slices * mn, acc2_t{});
 
-                            //  Because edge tiles may be smaller than MR×NR,
-                            //  fall back to scalar update in those cases.
-                            if (mr == MR && nr == NR)
-                            {
-                                ukr_(A_block, B_block, C_block,
-                                     C.row_stride(), C.col_stride(), kc);
-                            }
-                            else {
-                                ref_kernel<value_type,1,1>(A_block,B_block,C_block,
-                                    C.row_stride(), C.col_stride(), kc);
-                            }
-                        } // ir
-                    }     // jr
-                }         // ic
-            }             // pc
-        }                 // jc
+        #pragma omp parallel for schedule(dynamic)
+        for (std::size_t s = 0; s < slices; ++s)
+        {
+            const std::size_t t = static_cast<std::size_t>(thread_id());
+            const std::size_t k0 = std::min(k, (s*k_panels / slices) * KC);
+            const std::size_t k1 = std::min(k, ((s+1)*k_panels / slices) * KC);
+            slice_product(a, b, rc, m, n, k0, k1, &Ws_[s*mn], Ap_.data() + t*ap_size, Bp_.data() + t*bp_size);
+        }
+
+        for (std::size_t stride = 1; stride < slices; stride *= 2)
+        {
+            const std::size_t pairs = (slices + stride - 1) / (2*stride);
+            #pragma omp parallel for collapse(2) schedule(static)
+            for (std::size_t q = 0; q < pairs; ++q)
+                for (std::size_t e = 0; e < mn; ++e)
+                    acc_add(Ws_[2*q*stride*mn + e], Ws_[(2*q + 1)*stride*mn + e]);
+        }
+
+        //  the summed slice goes to the epilogue in MR×NR tiles, as every other path hands it
+        const std::size_t row_blocks = (m + rc.MR - 1) / rc.MR;
+        const std::size_t col_blocks = (n + rc.NR - 1) / rc.NR;
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (std::size_t rb = 0; rb < row_blocks; ++rb)
+            for (std::size_t cb = 0; cb < col_blocks; ++cb)
+            {
+                const std::size_t i0 = rb*rc.MR, j0 = cb*rc.NR;
+                epi.apply(&Ws_[i0*n + j0], n, i0, j0, std::min(rc.MR, m - i0), std::min(rc.NR, n - j0), C);
+            }
     }
 };
 
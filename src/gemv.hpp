@@ -0,0 +1,181 @@
+///@author Sudhanva Kulkarni
+/// Level 2 kernels for Lo_Gemm::Matrix and Lo_Gemm::Vector :
+///     Gemv : y ← alpha·op(A)·x + beta·y
+///     Ger  : A ← A + alpha·x·yᵀ
+/// These are bandwidth bound, so nothing is packed. A is streamed once, a KC long segment at a time, and
+/// decoded into a small per-thread buffer (decode_n, AVX2 gathers for contiguous 8 bit codes). Rows are split
+/// over threads. When the rows of op(A) are contiguous every row is a dot product, otherwise each column
+/// segment is an axpy into a block of rows; both visit k in the same order.
+/// The accumulator policy is the one of Gemm : each KC segment of a dot product is accumulated in Accum1
+/// and the segments are summed in Accum2, with the same KC Gemm derives for a 4×4 tile. Gemv therefore
+/// rounds exactly like Gemm with n = 1.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "Vector.h"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+template<typename MatrixA, typename VectorX, typename VectorY, typename Accum1 = void, typename Accum2 = void>
+class Gemv {
+    using value_type = typename MatrixA::value_type;
+    using pack_t     = pack_type_t<value_type>;
+    using acc1_t     = default_if_void_t<Accum1, pack_t>;
+    using acc2_t     = default_if_void_t<Accum2, acc1_t>;
+
+    static_assert(std::is_same_v<value_type, typename VectorX::value_type>,
+                  "Matrix A and vector x must hold the same element type");
+
+    //  rows per task
+    static constexpr std::size_t RB = 64;
+
+    std::size_t KC_ = blocking_for<pack_t, acc1_t, acc2_t>(4, 4).KC;
+
+    std::vector<pack_t> xp_;        // decoded x
+    std::vector<pack_t> buf_;       // per-thread decoded segment of A
+
+public:
+    using input_type = value_type;
+    using accum1_type = acc1_t;
+    using accum2_type = acc2_t;
+
+    Gemv() = default;
+
+    std::size_t kc() const noexcept { return KC_; }
+    void set_kc(std::size_t kc) noexcept { KC_ = std::max<std::size_t>(kc, 1); }
+
+    void run(VectorY& y, const MatrixA& A, const VectorX& x, Lo_Gemm::Op op = Lo_Gemm::NoTrans,
+             double alpha = 1.0, double beta = 1.0)
+    {
+        using T_y = typename VectorY::value_type;
+        //  the final update is carried out in double when the accumulator or y is double, as epilogue_for_t does
+        using T_s = std::conditional_t<std::is_same_v<acc2_t, double> || std::is_same_v<T_y, double>, double, float>;
+        using iy = typename VectorY::index_type;
+
+        const std::size_t m = op == Lo_Gemm::NoTrans ? A.rows() : A.cols();
+        const std::size_t k = op == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+        const std::size_t rs = op == Lo_Gemm::NoTrans ? A.row_stride() : A.col_stride();
+        const std::size_t cs = op == Lo_Gemm::NoTrans ? A.col_stride() : A.row_stride();
+        const bool dot_form = cs <= rs;
+        if (m == 0) return;
+
+        const std::size_t KC = KC_;
+        const std::size_t blen = dot_form ? std::min(KC, std::max<std::size_t>(k, 1)) : RB;
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        xp_.resize(std::max<std::size_t>(k, 1));
+        buf_.resize(blen * nt);
+
+        decode_n(x.ptr(), static_cast<std::ptrdiff_t>(x.inc()), xp_.data(), k);
+
+        const value_type* a = A.data;
+        const pack_t* xp = xp_.data();
+        const std::size_t row_blocks = (m + RB - 1) / RB;
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t rb = 0; rb < row_blocks; ++rb)
+        {
+            const std::size_t i0 = rb*RB;
+            const std::size_t mb = std::min(RB, m - i0);
+            pack_t* buf = buf_.data() + static_cast<std::size_t>(thread_id())*blen;
+
+            acc2_t sum[RB];
+            std::fill_n(sum, mb, acc2_t{});
+
+            for (std::size_t pc = 0; pc < k; pc += KC)
+            {
+                const std::size_t kc = std::min(KC, k - pc);
+                acc1_t part[RB];
+                std::fill_n(part, mb, acc1_t{});
+
+                if (dot_form) {
+                    for (std::size_t i = 0; i < mb; ++i) {
+                        decode_n(a + (i0+i)*rs + pc*cs, static_cast<std::ptrdiff_t>(cs), buf, kc);
+                        acc1_t acc = part[i];
+                        for (std::size_t p = 0; p < kc; ++p)
+                            acc_fma(acc, buf[p], xp[pc+p]);
+                        part[i] = acc;
+                    }
+                } else {
+                    for (std::size_t p = 0; p < kc; ++p) {
+                        decode_n(a + i0*rs + (pc+p)*cs, static_cast<std::ptrdiff_t>(rs), buf, mb);
+                        const pack_t xv = xp[pc+p];
+                        for (std::size_t i = 0; i < mb; ++i)
+                            acc_fma(part[i], buf[i], xv);
+                    }
+                }
+
+                for (std::size_t i = 0; i < mb; ++i)
+                    acc_add(sum[i], part[i]);
+            }
+
+            for (std::size_t i = 0; i < mb; ++i) {
+                T_y& yi = y[static_cast<iy>(i0 + i)];
+                T_s v = static_cast<T_s>(alpha) * lo_cast<T_s>(sum[i]);
+                if (beta != 0.0) v += static_cast<T_s>(beta) * lo_cast<T_s>(yi);
+                yi = lo_cast<T_y>(v);
+            }
+        }
+    }
+};
+
+
+//---------------------------------------------------------------------
+//  A ← A + alpha·x·yᵀ. Each element is updated with one rounding into  //
+//  the format of A. Threads split the non contiguous dimension of A so //
+//  every thread streams whole contiguous lines.                        //
+//---------------------------------------------------------------------
+template<typename MatrixA, typename VectorX, typename VectorY>
+class Ger {
+    using value_type = typename MatrixA::value_type;
+    using pack_t     = pack_type_t<value_type>;
+
+    std::vector<pack_t> xp_;
+    std::vector<pack_t> yp_;
+    std::vector<pack_t> buf_;
+
+public:
+    void run(MatrixA& A, const VectorX& x, const VectorY& y, float alpha = 1.0f)
+    {
+        const std::size_t m = A.rows();
+        const std::size_t n = A.cols();
+        if (m == 0 || n == 0) return;
+
+        xp_.resize(m);
+        yp_.resize(n);
+        decode_n(x.ptr(), static_cast<std::ptrdiff_t>(x.inc()), xp_.data(), m);
+        decode_n(y.ptr(), static_cast<std::ptrdiff_t>(y.inc()), yp_.data(), n);
+
+        //  lines run along the contiguous direction of A
+        const bool col_lines = A.row_stride() <= A.col_stride();
+        const std::size_t lines = col_lines ? n : m;
+        const std::size_t len = col_lines ? m : n;
+        const std::size_t step = col_lines ? A.col_stride() : A.row_stride();
+        const std::size_t inc = col_lines ? A.row_stride() : A.col_stride();
+        const pack_t* u = col_lines ? xp_.data() : yp_.data();      // varies along a line
+        const pack_t* w = col_lines ? yp_.data() : xp_.data();      // fixed per line
+
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        buf_.resize(len * nt);
+        value_type* a = A.data;
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t l = 0; l < lines; ++l)
+        {
+            pack_t* buf = buf_.data() + static_cast<std::size_t>(thread_id())*len;
+            value_type* line = a + l*step;
+            decode_n(line, static_cast<std::ptrdiff_t>(inc), buf, len);
+
+            const double s = static_cast<double>(alpha) * static_cast<double>(w[l]);
+            for (std::size_t i = 0; i < len; ++i)
+                line[i*inc] = lo_cast<value_type>(static_cast<double>(buf[i]) + s * static_cast<double>(u[i]));
+        }
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,524 @@
+///@author Sudhanva Kulkarni
+/// Integer GEMM for lo_float::i_n operands (and native integers) with int32 accumulation
+///     C ← requantize( Σ_k (a_ik − z_A)(b_kj − z_B) )
+/// A and B are Lo_Gemm::Matrix of int_n / uint_n / int8_t / ... or Packed_Matrix views of a bit packed
+/// lo_float::packed_i_n stream (int4 two per byte, int2 four per byte, ...). op(A) and op(B) are unpacked into
+/// int8 or int16 panels grouped along k, so that one 32 bit broadcast of A and one 256 bit load of B feed a whole
+/// MR×NR step of the micro-kernel :
+///   - int8 panels (A as uint8_t, B as int8_t, 4 values of k per lane) when A has at most 8 bits and B fits int8_t.
+///     AVX-512 VNNI / AVX-VNNI builds use vpdpbusd. Plain AVX2 uses vpmaddubsw + vpmaddwd, whose int16 pair sums
+///     saturate, so there the int8 path is only taken when 2·max a·max |b| < 2^15 (int4 × int4, uint4 × int8, ...).
+///   - int16 panels (2 values of k per lane) otherwise, with vpmaddwd (vpdpwssd under VNNI).
+/// A signed A in an int8 panel is stored offset by o = 2^(bits−1) to make it unsigned. The offset and the zero
+/// points come out of the int32 tile of each KC panel with the row sums of A and column sums of B taken while packing,
+///     Σ(a − z_A)(b − z_B) = Σ(a + o)b − (o + z_A)Σb − z_B Σa + kc·z_A·z_B
+/// The sums are exact until int32 overflows, as on hardware. Finished tiles go to the epilogue : Requantize scales
+/// them (per tensor, row or column), adds an int32 bias, rounds, adds the output zero point and saturates into the
+/// element type of C. Floating point outputs can take a LoGemm::Epilogue (alpha = s_A·s_B dequantizes).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "gemm_epilogue.hpp"
+#include "gemm_helpers.hpp"
+#include "gemms.hpp"
+#include "layouts.h"
+#include "lo_int.h"
+#include "lo_int_packed.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Lo_Gemm {
+
+//  matrix view of a bit packed stream : element (row, col) is element get_idx(row, col) of *data
+template<int LEN, typename idx, lo_float::Signedness Sign = lo_float::Signedness::Signed, Layout L = ColMajor>
+class Packed_Matrix {
+    public:
+    idx m;
+    idx n;
+    idx ld;
+    lo_float::packed_i_n<LEN, Sign>* data;
+    static constexpr Layout layout = L;
+    using scalar_type = lo_float::i_n<LEN, Sign>;
+    using value_type = lo_float::i_n<LEN, Sign>;
+    using index_type = idx;
+
+    Packed_Matrix(lo_float::packed_i_n<LEN, Sign>* data, idx m, idx n, idx ld) : m(m), n(n), ld(ld), data(data) {}
+
+    constexpr inline idx get_idx(idx row, idx col) const {
+        if constexpr (L == ColMajor) return col*ld + row;
+        else return row*ld + col;
+    }
+
+    inline value_type operator()(idx row, idx col) const {
+        return data->get(static_cast<std::size_t>(get_idx(row, col)));
+    }
+
+    inline void set(idx row, idx col, value_type v) const {
+        data->set(static_cast<std::size_t>(get_idx(row, col)), v);
+    }
+
+    constexpr inline idx row_stride() const {
+        return L == ColMajor ? static_cast<idx>(1) : ld;
+    }
+
+    constexpr inline idx col_stride() const {
+        return L == ColMajor ? ld : static_cast<idx>(1);
+    }
+
+    constexpr inline idx rows() const {
+        return this->m;
+    }
+
+    constexpr inline idx cols() const {
+        return this->n;
+    }
+};
+
+template<typename idx, Layout L = ColMajor>
+using Int4_Matrix = Packed_Matrix<4, idx, lo_float::Signedness::Signed, L>;
+
+} //namespace Lo_Gemm
+
+
+namespace LoGemm {
+
+namespace int_gemm_internal {
+
+//  width and range of an integer element type
+template<typename T>
+struct int_traits {
+    static_assert(std::is_integral_v<T>, "integer GEMM takes lo_float::i_n or native integer elements");
+    static constexpr int bits = 8*sizeof(T);
+    static constexpr bool is_signed = std::is_signed_v<T>;
+};
+
+template<int LEN, lo_float::Signedness S>
+struct int_traits<lo_float::i_n<LEN, S>> {
+    static constexpr int bits = LEN;
+    static constexpr bool is_signed = S == lo_float::Signedness::Signed;
+};
+
+template<typename T>
+inline constexpr int64_t lowest_v = int_traits<T>::is_signed ? -(int64_t(1) << (int_traits<T>::bits - 1)) : 0;
+
+template<typename T>
+inline constexpr int64_t highest_v = int_traits<T>::is_signed ? (int64_t(1) << (int_traits<T>::bits - 1)) - 1
+                                                               : static_cast<int64_t>((uint64_t(1) << int_traits<T>::bits) - 1);
+
+template<typename T>
+inline constexpr int64_t max_abs_v = std::max(-lowest_v<T>, highest_v<T>);
+
+template<typename T>
+inline constexpr bool fits_v = lowest_v<T> >= std::numeric_limits<int16_t>::min() && highest_v<T> <= std::numeric_limits<int16_t>::max();
+
+template<typename X>
+struct is_packed_matrix : std::false_type {};
+
+template<int LEN, typename idx, lo_float::Signedness S, Lo_Gemm::Layout L>
+struct is_packed_matrix<Lo_Gemm::Packed_Matrix<LEN, idx, S, L>> : std::true_type {};
+
+inline constexpr bool has_avx2 =
+#if defined(__AVX2__)
+    true;
+#else
+    false;
+#endif
+
+inline constexpr bool has_vnni =
+#if defined(__AVX2__) && ((defined(__AVX512VNNI__) && defined(__AVX512VL__)) || defined(__AVXVNNI__))
+    true;
+#else
+    false;
+#endif
+
+//  len elements of X from storage (i, j) on, down its column (along_rows) or along its row, as int16_t
+template<typename X>
+void read_run(const X& x, std::size_t i, std::size_t j, bool along_rows, std::size_t len, int16_t* out)
+{
+    using idx = typename X::index_type;
+    const std::size_t first = static_cast<std::size_t>(x.get_idx(static_cast<idx>(i), static_cast<idx>(j)));
+    const std::size_t step = static_cast<std::size_t>(along_rows ? x.row_stride() : x.col_stride());
+
+    if constexpr (is_packed_matrix<X>::value) {
+        using T = typename X::value_type;
+        constexpr int LEN = T::bits;
+        using Code = std::conditional_t<(LEN <= 8), uint8_t, uint16_t>;
+        std::size_t t = 0;
+        if (step == 1 && first % 8 == 0) {
+            alignas(32) Code codes[lo_float::packed_internal::chunk]{};
+            for (; t < len; t += lo_float::packed_internal::chunk) {
+                const std::size_t c = std::min(lo_float::packed_internal::chunk, len - t);
+                lo_float::packed_internal::unpack_codes<LEN>(x.data->data() + (first + t)*LEN/8, c, codes);
+                lo_float::packed_internal::codes_to_lanes<LEN, T::is_signed>(codes, c, out + t);
+            }
+        }
+        for (; t < len; ++t) out[t] = static_cast<int16_t>(x.data->get(first + t*step));
+    } else {
+        const auto* p = x.data + first;
+        for (std::size_t t = 0; t < len; ++t) out[t] = static_cast<int16_t>(p[t*step]);
+    }
+}
+
+//  acc += Σ over each group of 4 (uint8 a × int8 b) or 2 (int16 a × int16 b) products, per int32 lane
+#if defined(__AVX2__)
+__attribute__((always_inline)) inline __m256i dot_u8s8(__m256i acc, __m256i a, __m256i b) noexcept
+{
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpbusd_epi32(acc, a, b);
+#elif defined(__AVXVNNI__)
+    return _mm256_dpbusd_avx_epi32(acc, a, b);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), _mm256_set1_epi16(1)));
+#endif
+}
+
+__attribute__((always_inline)) inline __m256i dot_s16(__m256i acc, __m256i a, __m256i b) noexcept
+{
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, a, b);
+#elif defined(__AVXVNNI__)
+    return _mm256_dpwssd_avx_epi32(acc, a, b);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+#endif
+}
+#endif
+
+//  t ← A·B for one MR×NR tile over kq groups of G values of k. A holds MR rows of G values per group, B NR
+//  columns of G values per group, both of 32 bits
+template<typename T_a, typename T_b, int MR, int NR>
+static void int_kernel(const T_a* A, const T_b* B, int32_t* t, std::size_t kq) noexcept
+{
+    constexpr int G = 4 / sizeof(T_a);
+#if defined(__AVX2__)
+    static_assert(NR == 8, "one int32 lane per column");
+    __m256i acc[MR];
+    for (int i = 0; i < MR; ++i) acc[i] = _mm256_setzero_si256();
+    for (std::size_t q = 0; q < kq; ++q) {
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B + q*NR*G));
+        const T_a* a = A + q*MR*G;
+        for (int i = 0; i < MR; ++i) {
+            int32_t w;
+            std::memcpy(&w, a + i*G, 4);
+            if constexpr (G == 4) acc[i] = dot_u8s8(acc[i], _mm256_set1_epi32(w), b);
+            else                  acc[i] = dot_s16(acc[i], _mm256_set1_epi32(w), b);
+        }
+    }
+    for (int i = 0; i < MR; ++i) _mm256_storeu_si256(reinterpret_cast<__m256i*>(t + i*NR), acc[i]);
+#else
+    std::fill_n(t, MR*NR, 0);
+    for (std::size_t q = 0; q < kq; ++q)
+        for (int i = 0; i < MR; ++i)
+            for (int j = 0; j < NR; ++j) {
+                int32_t s = 0;
+                for (int g = 0; g < G; ++g)
+                    s += static_cast<int32_t>(A[(q*MR + i)*G + g]) * static_cast<int32_t>(B[(q*NR + j)*G + g]);
+                t[i*NR + j] += s;
+            }
+#endif
+}
+
+//  v rounded to an integer with mode
+template<typename T>
+inline int64_t round_int(T v, lo_float::Rounding_Mode mode)
+{
+    v = std::clamp(v, T(-0x1p62), T(0x1p62));
+    const T f = std::floor(v);
+    const T d = v - f;
+    const int64_t r = static_cast<int64_t>(f);
+    switch (mode) {
+        case lo_float::RoundTowardsZero :
+            return static_cast<int64_t>(std::trunc(v));
+        case lo_float::RoundAwayFromZero :
+            return d == T(0) ? r : (v < T(0) ? r : r + 1);
+        case lo_float::RoundDown :
+            return r;
+        case lo_float::RoundUp :
+            return d == T(0) ? r : r + 1;
+        case lo_float::RoundTiesToAway :
+            return static_cast<int64_t>(std::round(v));
+        case lo_float::RoundToNearestOdd :
+            return d > T(0.5) ? r + 1 : (d < T(0.5) ? r : r + ((r & 1) == 0));
+        case lo_float::StochasticRoundingA :
+        case lo_float::StochasticRoundingB :
+        case lo_float::StochasticRoundingC :
+        case lo_float::True_StochasticRounding :
+        case lo_float::ProbabilisticRounding : {
+            thread_local std::mt19937 gen(std::random_device{}());
+            return d > std::uniform_real_distribution<T>(T(0), T(1))(gen) ? r + 1 : r;
+        }
+        default :
+            return d > T(0.5) ? r + 1 : (d < T(0.5) ? r : r + (r & 1));
+    }
+}
+
+} // namespace int_gemm_internal
+
+
+// -------------------------------------------------------------
+//  Requantization epilogue for int32 tiles :                   //
+//    C ← sat( round( s·relu?(acc + bias) ) + zero_point )      //
+//  s is scale, or scales[i] / scales[j] for per row / per      //
+//  column multipliers (s_A·s_B / s_C of each output channel). //
+//  sat clamps to the range of C's element type.                //
+// -------------------------------------------------------------
+template<typename T = float>
+struct Requantize {
+    T scale = T(1);
+
+    const T* scales = nullptr;
+    Lo_Gemm::Scale_Granularity granularity = Lo_Gemm::perTensor;
+
+    //  int32 bias in accumulator units, added before scaling
+    const int32_t* bias = nullptr;
+    BiasMode bias_mode = BiasMode::None;
+
+    int32_t zero_point = 0;
+
+    //  clamp below at zero_point, the quantized ReLU
+    bool relu = false;
+
+    lo_float::Rounding_Mode round_mode = lo_float::Rounding_Mode::RoundToNearestEven;
+
+    template<typename T_tile, typename MatrixC>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr, std::size_t nr, MatrixC& C)
+    {
+        using T_c = typename MatrixC::value_type;
+        using idx = typename MatrixC::index_type;
+        constexpr int64_t hi = int_gemm_internal::highest_v<T_c>;
+        const int64_t lo = relu ? std::max<int64_t>(int_gemm_internal::lowest_v<T_c>, zero_point)
+                                : int_gemm_internal::lowest_v<T_c>;
+
+        for (std::size_t i = 0; i < mr; ++i) {
+            for (std::size_t j = 0; j < nr; ++j) {
+                int64_t acc = static_cast<int64_t>(tile[i*ld + j]);
+                if (bias_mode == BiasMode::PerRow)
+                    acc += bias[i0 + i];
+                else if (bias_mode == BiasMode::PerCol)
+                    acc += bias[j0 + j];
+                const T s = scales && granularity != Lo_Gemm::perTensor
+                          ? scales[granularity == Lo_Gemm::perRow ? i0 + i : j0 + j] : scale;
+                //  unit scales stay in integers, exact beyond the float significand
+                const int64_t q = (s == T(1) ? acc : int_gemm_internal::round_int(static_cast<T>(acc) * s, round_mode)) + zero_point;
+                C(static_cast<idx>(i0 + i), static_cast<idx>(j0 + j)) = T_c(std::clamp(q, lo, hi));
+            }
+        }
+    }
+};
+
+
+//  C ← epi(op(A)·op(B)) for integer A and B, int32 accumulation
+template<typename MatrixA, typename MatrixB, typename MatrixC>
+class IntGemm {
+    using a_type = typename MatrixA::value_type;
+    using b_type = typename MatrixB::value_type;
+    using TA = int_gemm_internal::int_traits<a_type>;
+    using TB = int_gemm_internal::int_traits<b_type>;
+
+    static_assert(int_gemm_internal::fits_v<a_type> && int_gemm_internal::fits_v<b_type>,
+                  "integer GEMM operands must fit int16_t");
+
+    //  largest A once offset to unsigned, largest |B|
+    static constexpr int64_t a_range = (int64_t(1) << TA::bits) - 1;
+    static constexpr int64_t b_range = int_gemm_internal::max_abs_v<b_type>;
+
+    static constexpr bool narrow = TA::bits <= 8 && int_gemm_internal::lowest_v<b_type> >= -128 && int_gemm_internal::highest_v<b_type> <= 127
+                                && (int_gemm_internal::has_vnni || !int_gemm_internal::has_avx2 || 2*a_range*b_range <= 32767);
+
+    using a_pack_t = std::conditional_t<narrow, uint8_t, int16_t>;
+    using b_pack_t = std::conditional_t<narrow, int8_t, int16_t>;
+    static constexpr std::size_t G = narrow ? 4 : 2;
+    static constexpr int32_t a_off = narrow && TA::is_signed ? int32_t(1) << (TA::bits - 1) : 0;
+
+    static constexpr std::size_t MR = 8;
+    static constexpr std::size_t NR = 8;
+
+    BlockingParams blk_ = blocking_for<b_pack_t, int32_t, int32_t>(MR, NR);
+    int32_t za_ = 0, zb_ = 0;
+
+    std::vector<a_pack_t> Ap_;
+    std::vector<b_pack_t> Bp_;
+    std::vector<int32_t> Asum_, Bsum_;      // Σ_k a of every packed row, Σ_k b of every packed column
+    std::vector<int32_t> Cw_;
+    std::vector<int16_t> run_;              // one unpacked run of k per thread
+
+    static constexpr std::size_t round_up(std::size_t x, std::size_t r) { return (x + r - 1) / r * r; }
+
+    //  op(A)(ic:ic+mc, pc:pc+kc) into MR-row micro panels of kcp = round_up(kc, G) values, a + a_off
+    static void pack_A(const MatrixA& A, Lo_Gemm::Op op, a_pack_t* Ap, int32_t* As, int16_t* run,
+                       std::size_t ic, std::size_t pc, std::size_t mc, std::size_t kc)
+    {
+        const std::size_t kcp = round_up(kc, G);
+        for (std::size_t ir = 0; ir < mc; ir += MR) {
+            const std::size_t mr = std::min(MR, mc - ir);
+            a_pack_t* dst = Ap + ir*kcp;
+            for (std::size_t i = 0; i < MR; ++i) {
+                int32_t s = 0;
+                if (i < mr) {
+                    if (op == Lo_Gemm::NoTrans) int_gemm_internal::read_run(A, ic+ir+i, pc, false, kc, run);
+                    else                        int_gemm_internal::read_run(A, pc, ic+ir+i, true, kc, run);
+                    for (std::size_t kk = 0; kk < kc; ++kk) {
+                        s += run[kk];
+                        dst[(kk/G)*MR*G + i*G + kk%G] = static_cast<a_pack_t>(run[kk] + a_off);
+                    }
+                    for (std::size_t kk = kc; kk < kcp; ++kk) dst[(kk/G)*MR*G + i*G + kk%G] = a_pack_t{};
+                } else {
+                    for (std::size_t kk = 0; kk < kcp; ++kk) dst[(kk/G)*MR*G + i*G + kk%G] = a_pack_t{};
+                }
+                As[ir + i] = s;
+            }
+        }
+    }
+
+    //  op(B)(pc:pc+kc, j0:j0+nr) into one NR-column micro panel, zero padded
+    static void pack_B(const MatrixB& B, Lo_Gemm::Op op, b_pack_t* Bp, int32_t* Bs, int16_t* run,
+                       std::size_t pc, std::size_t j0, std::size_t kc, std::size_t nr)
+    {
+        const std::size_t kcp = round_up(kc, G);
+        for (std::size_t j = 0; j < NR; ++j) {
+            int32_t s = 0;
+            if (j < nr) {
+                if (op == Lo_Gemm::NoTrans) int_gemm_internal::read_run(B, pc, j0+j, true, kc, run);
+                else                        int_gemm_internal::read_run(B, j0+j, pc, false, kc, run);
+                for (std::size_t kk = 0; kk < kc; ++kk) {
+                    s += run[kk];
+                    Bp[(kk/G)*NR*G + j*G + kk%G] = static_cast<b_pack_t>(run[kk]);
+                }
+                for (std::size_t kk = kc; kk < kcp; ++kk) Bp[(kk/G)*NR*G + j*G + kk%G] = b_pack_t{};
+            } else {
+                for (std::size_t kk = 0; kk < kcp; ++kk) Bp[(kk/G)*NR*G + j*G + kk%G] = b_pack_t{};
+            }
+            Bs[j] = s;
+        }
+    }
+
+public:
+    using accum_type = int32_t;
+    static constexpr bool int8_panels = narrow;
+
+    IntGemm() = default;
+
+    const BlockingParams& blocking() const noexcept { return blk_; }
+    void set_blocking(const BlockingParams& b) noexcept
+    {
+        blk_ = {std::max(b.MC / MR * MR, MR), std::max<std::size_t>(b.KC / G * G, G), std::max(b.NC / NR * NR, NR)};
+    }
+
+    //  zero points z_A, z_B subtracted from every element of A and B
+    void set_zero_points(int32_t za, int32_t zb) noexcept { za_ = za; zb_ = zb; }
+    int32_t zero_point_a() const noexcept { return za_; }
+    int32_t zero_point_b() const noexcept { return zb_; }
+
+    //  integer C : Requantize with unit scale (saturating A·B), floating point C : the default Epilogue
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        using T_c = typename MatrixC::value_type;
+        if constexpr (std::is_floating_point_v<T_c> || is_lo_float_v<T_c>) {
+            epilogue_for_t<float, T_c> epi;
+            run(C, A, B, epi, opA, opB);
+        } else {
+            Requantize<> epi;
+            run(C, A, B, epi, opA, opB);
+        }
+    }
+
+    template<typename Epi>
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B, Epi& epi,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        const std::size_t m = static_cast<std::size_t>(opA == Lo_Gemm::NoTrans ? A.rows() : A.cols());
+        const std::size_t n = static_cast<std::size_t>(opB == Lo_Gemm::NoTrans ? B.cols() : B.rows());
+        const std::size_t k = static_cast<std::size_t>(opA == Lo_Gemm::NoTrans ? A.cols() : A.rows());
+        if (m == 0 || n == 0) return;
+
+        const std::size_t KC = blk_.KC;
+        const std::size_t NC = blk_.NC;
+        const std::size_t nt = static_cast<std::size_t>(max_threads());
+        const std::size_t MC = std::min(blk_.MC, round_up((m + nt - 1) / nt, MR));
+        const std::size_t ic_blocks = (m + MC - 1) / MC;
+        const std::size_t k_panels = std::max<std::size_t>(1, (k + KC - 1) / KC);
+
+        const std::size_t kmax = std::min(KC, round_up(std::max<std::size_t>(k, 1), G));
+        const std::size_t ap_size = round_up(std::min(MC, m), MR) * kmax;
+        const std::size_t as_size = round_up(std::min(MC, m), MR);
+        Ap_.resize(ap_size * nt);
+        Asum_.resize(as_size * nt);
+        Bp_.resize(round_up(std::min(NC, n), NR) * kmax);
+        Bsum_.resize(round_up(std::min(NC, n), NR));
+        run_.resize(kmax * nt);
+
+        for (std::size_t jc = 0; jc < n; jc += NC)
+        {
+            const std::size_t nc = std::min(NC, n - jc);
+            const std::size_t jr_panels = (nc + NR - 1) / NR;
+            if (k_panels > 1) Cw_.assign(m*nc, 0);
+
+            for (std::size_t p = 0; p < k_panels; ++p)
+            {
+                const std::size_t pc = p*KC;
+                const std::size_t kc = std::min(KC, k - pc);
+                const std::size_t kq = (kc + G - 1) / G;
+                const std::size_t kcp = kq*G;
+                const bool last = (p + 1 == k_panels);
+                const int32_t kz = static_cast<int32_t>(kc) * za_ * zb_;
+
+                #pragma omp parallel for schedule(static)
+                for (std::size_t q = 0; q < jr_panels; ++q)
+                    pack_B(B, opB, Bp_.data() + q*NR*kcp, Bsum_.data() + q*NR,
+                           run_.data() + static_cast<std::size_t>(thread_id())*kmax,
+                           pc, jc + q*NR, kc, std::min(NR, nc - q*NR));
+
+                #pragma omp parallel for schedule(dynamic)
+                for (std::size_t ib = 0; ib < ic_blocks; ++ib)
+                {
+                    const std::size_t ic = ib*MC;
+                    const std::size_t mc = std::min(MC, m - ic);
+                    const std::size_t t = static_cast<std::size_t>(thread_id());
+                    a_pack_t* Ap = Ap_.data() + t*ap_size;
+                    int32_t* As = Asum_.data() + t*as_size;
+                    pack_A(A, opA, Ap, As, run_.data() + t*kmax, ic, pc, mc, kc);
+
+                    for (std::size_t jr = 0; jr < nc; jr += NR) {
+                        const std::size_t nr = std::min(NR, nc - jr);
+                        for (std::size_t ir = 0; ir < mc; ir += MR) {
+                            const std::size_t mr = std::min(MR, mc - ir);
+                            int32_t* W = (k_panels > 1) ? &Cw_[(ic+ir)*nc + jr] : nullptr;
+
+                            alignas(32) int32_t tile[MR*NR];
+                            int_gemm_internal::int_kernel<a_pack_t, b_pack_t, MR, NR>(&Ap[ir*kcp], &Bp_[jr*kcp], tile, kq);
+
+                            //  undo the offset of A and subtract the zero points
+                            for (std::size_t i = 0; i < mr; ++i)
+                                for (std::size_t j = 0; j < nr; ++j)
+                                    tile[i*NR + j] += kz - (a_off + za_)*Bsum_[jr + j] - zb_*As[ir + i]
+                                                    + (W ? W[i*nc + j] : 0);
+
+                            if (last) {
+                                epi.apply(static_cast<const int32_t*>(tile), NR, ic+ir, jc+jr, mr, nr, C);
+                            } else {
+                                for (std::size_t i = 0; i < mr; ++i)
+                                    for (std::size_t j = 0; j < nr; ++j)
+                                        W[i*nc + j] = tile[i*NR + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,364 @@
+///@author Sudhanva Kulkarni
+/// Mixed precision iterative refinement for A·x = b, A square :
+///     the LU factors are computed and stored in a low precision lo_float format Factor (getrf, panels in Work),
+///     residuals r = b − A·x are accumulated in a wider format Residual, usually double,
+///     corrections come from the low precision factors, either directly (LU-IR) or as the preconditioner
+///     of GMRES on the corrected system (GMRES-IR, left preconditioned, restarted).
+/// A is scaled by a power of two before it is rounded into Factor so its largest entry sits at theta·max of
+/// that format, and every right hand side handed to the factors is scaled to unit max norm before it is
+/// rounded into Work, so narrow formats neither overflow nor flush small entries. Both scalings are exact.
+/// The factors are decoded into Work once, and the triangular solves run through Trsm (and so Gemm). The
+/// residual product is split over threads by row blocks.
+/// A is referenced, not copied : it has to outlive the solver. Buffers are kept between calls so one solver
+/// can be reused across many systems of the same or different size.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Matrix.h"
+#include "Vector.h"
+#include "blas3.hpp"
+#include "factorizations.hpp"
+#include "gemms.hpp"
+
+namespace LoGemm {
+
+enum class Refinement { LU, GMRES };
+
+struct IROptions {
+    Refinement method = Refinement::LU;
+    int max_iter = 30;              // refinement steps
+    double tol = 0.0;               // normwise backward error to reach, 0 : √n·ε of Residual, as in dsgesv
+    int gmres_restart = 30;         // Krylov dimension per GMRES cycle
+    int gmres_max_iter = 200;       // GMRES iterations per refinement step
+    double gmres_tol = 1e-8;        // relative residual of the preconditioned correction system
+    double theta = 0.1;             // fraction of the largest Factor value the scaled A may reach
+    std::size_t nb = 64;            // block size of getrf and of the triangular solves
+};
+
+struct IRStats {
+    int info = 0;                   // getrf : 0, or j+1 if a pivot of column j was zero
+    bool converged = false;
+    int iterations = 0;             // refinement steps taken
+    int inner_iterations = 0;       // GMRES iterations summed over all steps
+    double backward_error = 0.0;    // ‖b − A·x‖∞ / (‖A‖∞·‖x‖∞ + ‖b‖∞) of the returned x
+    double factor_seconds = 0.0;    // scaling, rounding, getrf and decoding the factors
+    double residual_seconds = 0.0;  // b − A·x of the refinement loop
+    double correction_seconds = 0.0;// triangular solves and GMRES, including its products with A
+    double total_seconds = 0.0;
+};
+
+template<typename Factor, typename Work = float, typename Residual = double,
+         typename Accum1 = void, typename Accum2 = void>
+class IterativeRefinement {
+    using FactorMatrix = Lo_Gemm::Matrix<Factor, int>;
+    using WorkMatrix   = Lo_Gemm::Matrix<Work, int>;
+    using clock        = std::chrono::steady_clock;
+
+    static constexpr std::size_t RB = 64;     // rows per task of the residual product
+
+    IROptions opt_;
+    std::size_t n_ = 0;
+    int info_ = -1;                 // −1 : not factorized
+    double factor_seconds_ = 0.0;
+
+    //  A as given, read through a type erased row block product
+    const void* A_ = nullptr;
+    void (*matvec_)(const void*, std::size_t, std::size_t, const Residual*, Residual*) = nullptr;
+    Residual normA_ = 0;
+    int scale_exp_ = 0;             // the factors are those of 2^scale_exp_·A
+
+    std::vector<Factor> F_;
+    std::vector<Work> LUw_;
+    std::vector<std::size_t> ipiv_;
+    std::vector<Work> y_;
+    Trsm<WorkMatrix, WorkMatrix, Accum1, Accum2> trsm_;
+
+    std::vector<Residual> b_, x_, r_, d_, w_, V_, H_, cs_, sn_, g_;
+
+    static double seconds(clock::time_point t0) { return std::chrono::duration<double>(clock::now() - t0).count(); }
+
+    static Residual norm_inf(const Residual* v, std::size_t n)
+    {
+        Residual s = 0;
+        for (std::size_t i = 0; i < n; ++i) s = std::max<Residual>(s, std::abs(v[i]));
+        return s;
+    }
+
+    static Residual norm_2(const Residual* v, std::size_t n)
+    {
+        Residual s = 0;
+        #pragma omp parallel for reduction(+:s) schedule(static)
+        for (std::size_t i = 0; i < n; ++i) s += v[i]*v[i];
+        return std::sqrt(s);
+    }
+
+    //  y(i0:i0+mb) ← A(i0:i0+mb, :)·x in Residual
+    template<typename MatrixA>
+    static void rows_times(const void* Ap, std::size_t i0, std::size_t mb, const Residual* x, Residual* y)
+    {
+        const MatrixA& A = *static_cast<const MatrixA*>(Ap);
+        const auto* a = A.data;
+        const std::size_t n = A.cols();
+        const std::size_t rs = A.row_stride(), cs = A.col_stride();
+
+        std::fill_n(y, mb, Residual{});
+        if (cs <= rs) {
+            for (std::size_t i = 0; i < mb; ++i) {
+                Residual s = 0;
+                for (std::size_t j = 0; j < n; ++j) s += lo_cast<Residual>(a[(i0+i)*rs + j*cs]) * x[j];
+                y[i] = s;
+            }
+        } else {
+            for (std::size_t j = 0; j < n; ++j) {
+                const Residual xj = x[j];
+                for (std::size_t i = 0; i < mb; ++i) y[i] += lo_cast<Residual>(a[(i0+i)*rs + j*cs]) * xj;
+            }
+        }
+    }
+
+    //  out ← b − A·x, or out ← A·x when b is null
+    void residual(const Residual* b, const Residual* x, Residual* out) const
+    {
+        const std::size_t blocks = (n_ + RB - 1) / RB;
+        #pragma omp parallel for schedule(static)
+        for (std::size_t q = 0; q < blocks; ++q) {
+            const std::size_t i0 = q*RB, mb = std::min(RB, n_ - i0);
+            Residual ax[RB];
+            matvec_(A_, i0, mb, x, ax);
+            for (std::size_t i = 0; i < mb; ++i) out[i0+i] = b ? b[i0+i] - ax[i] : ax[i];
+        }
+    }
+
+    //  z ← A⁻¹·v through the low precision factors (z may alias v)
+    void apply_factors(const Residual* v, Residual* z)
+    {
+        const Residual vmax = norm_inf(v, n_);
+        if (vmax == 0 || !std::isfinite(static_cast<double>(vmax))) {
+            std::copy_n(v, n_, z);
+            return;
+        }
+        const int e = std::ilogb(vmax);
+        for (std::size_t i = 0; i < n_; ++i) y_[i] = lo_cast<Work>(std::ldexp(v[i], -e));
+
+        const int n = static_cast<int>(n_);
+        WorkMatrix LU(LUw_.data(), n, n, n);
+        WorkMatrix Y(y_.data(), n, 1, n);
+        for (std::size_t j = 0; j < n_; ++j) factor_internal::swap_rows(Y, j, ipiv_[j], 0, 1);
+        trsm_.run(Lo_Gemm::Left, Lo_Gemm::Lower, Lo_Gemm::NoTrans, Lo_Gemm::Unit, Y, LU);
+        trsm_.run(Lo_Gemm::Left, Lo_Gemm::Upper, Lo_Gemm::NoTrans, Lo_Gemm::NonUnit, Y, LU);
+
+        //  A⁻¹ = 2^s·(2^s·A)⁻¹
+        for (std::size_t i = 0; i < n_; ++i) z[i] = std::ldexp(lo_cast<Residual>(y_[i]), e + scale_exp_);
+    }
+
+    //  d ← approximate solution of A·d = r by GMRES on M·A·d = M·r, M the factors; returns iterations
+    int gmres(const Residual* r, Residual* d)
+    {
+        const std::size_t n = n_;
+        const std::size_t m = static_cast<std::size_t>(std::clamp(opt_.gmres_restart, 1, static_cast<int>(n)));
+        V_.resize((m + 1)*n);
+        H_.resize((m + 1)*m);
+        cs_.resize(m); sn_.resize(m); g_.resize(m + 1);
+        w_.resize(n);
+
+        std::fill_n(d, n, Residual{});
+        apply_factors(r, w_.data());
+        const Residual beta0 = norm_2(w_.data(), n);
+        if (beta0 == 0) return 0;
+        const Residual target = static_cast<Residual>(opt_.gmres_tol) * beta0;
+
+        int total = 0;
+        Residual beta = beta0;
+        while (total < opt_.gmres_max_iter) {
+            //  w holds the preconditioned residual M·(r − A·d), beta its norm
+            for (std::size_t i = 0; i < n; ++i) V_[i] = w_[i] / beta;
+            std::fill(g_.begin(), g_.end(), Residual{});
+            g_[0] = beta;
+
+            std::size_t k = 0;
+            while (k < m && total < opt_.gmres_max_iter) {
+                Residual* v = V_.data() + k*n;
+                Residual* vn = V_.data() + (k + 1)*n;
+                Residual* h = H_.data() + k*(m + 1);
+
+                //  vn ← M·A·v, then modified Gram-Schmidt against the basis
+                residual(nullptr, v, vn);
+                apply_factors(vn, vn);
+                for (std::size_t q = 0; q <= k; ++q) {
+                    const Residual* vq = V_.data() + q*n;
+                    Residual s = 0;
+                    #pragma omp parallel for reduction(+:s) schedule(static)
+                    for (std::size_t i = 0; i < n; ++i) s += vq[i]*vn[i];
+                    h[q] = s;
+                    #pragma omp parallel for schedule(static)
+                    for (std::size_t i = 0; i < n; ++i) vn[i] -= s*vq[i];
+                }
+                h[k + 1] = norm_2(vn, n);
+                if (h[k + 1] != 0)
+                    for (std::size_t i = 0; i < n; ++i) vn[i] /= h[k + 1];
+
+                //  previous rotations, then the one that zeroes h[k+1]
+                for (std::size_t q = 0; q < k; ++q) {
+                    const Residual t = cs_[q]*h[q] + sn_[q]*h[q + 1];
+                    h[q + 1] = -sn_[q]*h[q] + cs_[q]*h[q + 1];
+                    h[q] = t;
+                }
+                const Residual rho = std::hypot(h[k], h[k + 1]);
+                cs_[k] = rho == 0 ? Residual{1} : h[k] / rho;
+                sn_[k] = rho == 0 ? Residual{0} : h[k + 1] / rho;
+                h[k] = rho;
+                h[k + 1] = 0;
+                g_[k + 1] = -sn_[k]*g_[k];
+                g_[k] = cs_[k]*g_[k];
+
+                ++k;
+                ++total;
+                if (std::abs(g_[k]) <= target || rho == 0) break;
+            }
+
+            //  d ← d + V·y, H(0:k, 0:k)·y = g(0:k)
+            for (std::size_t q = k; q-- > 0;) {
+                Residual s = g_[q];
+                for (std::size_t p = q + 1; p < k; ++p) s -= H_[p*(m + 1) + q] * g_[p];
+                g_[q] = s / H_[q*(m + 1) + q];
+            }
+            for (std::size_t q = 0; q < k; ++q) {
+                const Residual* vq = V_.data() + q*n;
+                const Residual yq = g_[q];
+                for (std::size_t i = 0; i < n; ++i) d[i] += yq*vq[i];
+            }
+
+            if (total >= opt_.gmres_max_iter) break;
+            //  restart from the true preconditioned residual
+            residual(r, d, w_.data());
+            apply_factors(w_.data(), w_.data());
+            beta = norm_2(w_.data(), n);
+            if (beta <= target) break;
+        }
+        return total;
+    }
+
+public:
+    IterativeRefinement() = default;
+    explicit IterativeRefinement(const IROptions& opt) : opt_(opt) {}
+
+    const IROptions& options() const noexcept { return opt_; }
+    void set_options(const IROptions& opt) noexcept { opt_ = opt; }
+
+    //  rounds the scaled A into Factor and computes its LU factors; returns the getrf info
+    template<typename MatrixA>
+    int factorize(const MatrixA& A)
+    {
+        using idx = typename MatrixA::index_type;
+        const auto t0 = clock::now();
+        n_ = A.rows();
+        A_ = &A;
+        matvec_ = &rows_times<MatrixA>;
+        const int n = static_cast<int>(n_);
+
+        //  ‖A‖∞ and the largest entry
+        Residual amax = 0;
+        normA_ = 0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            Residual s = 0;
+            for (std::size_t j = 0; j < n_; ++j) {
+                const Residual a = std::abs(lo_cast<Residual>(A(static_cast<idx>(i), static_cast<idx>(j))));
+                s += a;
+                amax = std::max(amax, a);
+            }
+            normA_ = std::max(normA_, s);
+        }
+        const double fmax = static_cast<double>(std::numeric_limits<Factor>::max());
+        scale_exp_ = amax == 0 ? 0 : static_cast<int>(std::floor(std::log2(opt_.theta * fmax / static_cast<double>(amax))));
+
+        F_.resize(n_*n_);
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < n_; ++j)
+            for (std::size_t i = 0; i < n_; ++i)
+                F_[i + j*n_] = lo_cast<Factor>(std::ldexp(lo_cast<Residual>(A(static_cast<idx>(i), static_cast<idx>(j))), scale_exp_));
+
+        FactorMatrix F(F_.data(), n, n, n);
+        info_ = getrf<Work, Accum1, Accum2>(F, ipiv_, opt_.nb);
+
+        LUw_.resize(n_*n_);
+        decode_n(F_.data(), 1, LUw_.data(), n_*n_);
+        y_.resize(n_);
+        trsm_.set_block_size(opt_.nb);
+
+        factor_seconds_ = seconds(t0);
+        return info_;
+    }
+
+    //  x ← solution of A·x = b for the A last factorized
+    template<typename VectorB, typename VectorX>
+    IRStats solve(const VectorB& b, VectorX& x)
+    {
+        using ib = typename VectorB::index_type;
+        using ix = typename VectorX::index_type;
+        const auto t0 = clock::now();
+        IRStats st;
+        st.info = info_;
+        st.factor_seconds = factor_seconds_;
+        if (info_ != 0 || n_ == 0) return st;
+
+        const std::size_t n = n_;
+        b_.resize(n);
+        x_.resize(n);
+        Residual* bv = b_.data();
+        Residual* xv = x_.data();
+        for (std::size_t i = 0; i < n; ++i) bv[i] = lo_cast<Residual>(b[static_cast<ib>(i)]);
+        r_.resize(n);
+        d_.resize(n);
+
+        const double tol = opt_.tol > 0 ? opt_.tol
+                         : std::sqrt(static_cast<double>(n)) * static_cast<double>(std::numeric_limits<Residual>::epsilon());
+        const Residual normb = norm_inf(bv, n);
+
+        auto t = clock::now();
+        apply_factors(bv, xv);
+        st.correction_seconds += seconds(t);
+
+        double prev = std::numeric_limits<double>::infinity();
+        for (;;) {
+            t = clock::now();
+            residual(bv, xv, r_.data());
+            st.residual_seconds += seconds(t);
+
+            const double denom = static_cast<double>(normA_ * norm_inf(xv, n) + normb);
+            st.backward_error = denom == 0 ? 0.0 : static_cast<double>(norm_inf(r_.data(), n)) / denom;
+            if (st.backward_error <= tol) { st.converged = true; break; }
+            //  stop once a step no longer halves the backward error
+            if (st.iterations >= opt_.max_iter || !(st.backward_error < prev / 2)) break;
+            prev = st.backward_error;
+
+            t = clock::now();
+            if (opt_.method == Refinement::GMRES)
+                st.inner_iterations += gmres(r_.data(), d_.data());
+            else
+                apply_factors(r_.data(), d_.data());
+            for (std::size_t i = 0; i < n; ++i) xv[i] += d_[i];
+            st.correction_seconds += seconds(t);
+            ++st.iterations;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) x[static_cast<ix>(i)] = lo_cast<typename VectorX::value_type>(xv[i]);
+        st.total_seconds = st.factor_seconds + seconds(t0);
+        return st;
+    }
+
+    //  factorize(A) then solve(b, x)
+    template<typename MatrixA, typename VectorB, typename VectorX>
+    IRStats run(const MatrixA& A, const VectorB& b, VectorX& x)
+    {
+        factorize(A);
+        return solve(b, x);
+    }
+};
+
+} // namespace LoGemm
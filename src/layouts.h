@@ -1,4 +1,9 @@
+#pragma once
+
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
 
 namespace Lo_Gemm { 
 enum Layout : uint8_t {
@@ -6,12 +11,41 @@ enum Layout : uint8_t {
     RowMajor = 1
 };
 
+//op(X) applied to a GEMM operand
+enum Op : uint8_t {
+    NoTrans = 0,
+    Trans = 1
+};
+
+//triangle, side and diagonal arguments of the level 3 routines
+enum Uplo : uint8_t {
+    Lower = 0,
+    Upper = 1
+};
+
+enum Side : uint8_t {
+    Left = 0,
+    Right = 1
+};
+
+enum Diag : uint8_t {
+    NonUnit = 0,
+    Unit = 1
+};
+
 enum MX_Layout : uint8_t {
     byColumn = 0,
     byRow = 1,
     byBlock = 2
 };
 
+//granularity of the float scales of scaled (fp8) quantization : one per tensor, per row or per column
+enum Scale_Granularity : uint8_t {
+    perTensor = 0,
+    perRow = 1,
+    perColumn = 2
+};
+
 struct MX_tuple {
     MX_Layout layout;
     int m;
@@ -20,6 +54,41 @@ struct MX_tuple {
     MX_tuple(MX_Layout layout, int m, int n = 1) : layout(layout), m(m), n(n) {}
 };
 
+//exponent only scale formats (lo_float::float8_e8m0) : code c is 2^(c - bias), the all ones code NaN
+template<typename T_scal>
+inline constexpr bool is_exponent_format_v = [] {
+    if constexpr (requires { T_scal::mantissa_bits; T_scal::bias; }) return T_scal::mantissa_bits == 0;
+    else return false;
+}();
+
+//power of two exponent of an integral or exponent only shared scale
+template<typename T_scal>
+inline int scale_exponent(T_scal s) {
+    if constexpr (is_exponent_format_v<T_scal>) return static_cast<int>(s.rep()) - T_scal::bias;
+    else return static_cast<int>(s);
+}
+
+//shared scale holding 2^e : the exponent for an integral T_scal, the biased code for an exponent only format,
+//the power of two itself for any other type
+template<typename T_scal>
+inline T_scal store_scale(int e) {
+    if constexpr (std::is_integral_v<T_scal>) return static_cast<T_scal>(e);
+    else if constexpr (is_exponent_format_v<T_scal>) return T_scal::FromRep(static_cast<uint8_t>(e + T_scal::bias));
+    else return static_cast<T_scal>(std::ldexp(1.0, e));
+}
+
+//value of an MX shared scale : an integral T_scal stores the power of two exponent, an exponent only format its
+//biased exponent (the NaN code gives NaN), any other type the scale itself
+template<typename V = float, typename T_scal>
+inline V shared_scale(T_scal s) {
+    if constexpr (std::is_integral_v<T_scal>) return std::ldexp(static_cast<V>(1), static_cast<int>(s));
+    else if constexpr (is_exponent_format_v<T_scal>) {
+        if (s.rep() == (1u << T_scal::bitwidth) - 1u) return std::numeric_limits<V>::quiet_NaN();
+        return std::ldexp(static_cast<V>(1), scale_exponent(s));
+    }
+    else return static_cast<V>(s);
+}
+
 enum Arch_extensions : uint8_t {
     NONE = 0,
     AVX256 = 1,
@@ -6,11 +6,11 @@
 //#define ENABLE_EXCEPT
 //#define STOCHASTIC_ROUND
 //#define STOCHASTIC_ARITH
-#define LEN 13  
 #include <random> 
 #include <ctime>
 #include <algorithm>
 #include <cstdlib>
+#include <climits>
 #include <cmath>
 #include <cstdint>
 #include <limits>
@@ -716,6 +716,82 @@ namespace lo_float_internal {
     );
    
 
+    //NaNChecker for float8e8m0 : the all ones code is the only NaN
+    struct OCP_E8M0_NaNChecker {
+        bool operator()(uint32_t bits) const {
+            return bits == 0x000000FF;
+        }
+
+        uint32_t qNanBitPattern() const {
+            return 0x000000FF;
+        }
+
+        uint32_t sNanBitPattern() const {
+            return 0x000000FF;
+        }
+    };
+
+    // FloatingPointParams for float8_e8m0 (OCP MX shared scale) -> exponent only, 2^(code - 127), 0xFF is NaN
+    // code 0 decodes to 0 here (no mantissa for a subnormal), the MX kernels read it as 2^-127
+    template<Rounding_Mode round_mode, int stoch_len = 0>
+    constexpr FloatingPointParams param_float8_e8m0(
+        8, //totoal bitwidth
+        0, // mantissa bits
+        127,  //bias
+        round_mode,  // rounding mode
+        Inf_Behaviors::Saturating,  //No infinity
+        NaN_Behaviors::QuietNaN,    //NaN behavior
+        Signedness::Unsigned,       //It is unsigned
+        OCP_F8E4M3_InfChecker(),    //Inf Functor
+        OCP_E8M0_NaNChecker()       //NaN Functor
+        , stoch_len
+    );
+
+
+    //IEEE style specials of bfloat16 (the upper half of a float) : exponent all ones, zero mantissa is ±inf
+    struct BF16_InfChecker {
+        bool operator()(uint32_t bits) const {
+            return (bits & 0x7FFF) == 0x7F80;
+        }
+
+        uint32_t minNegInf() const {
+            return 0xFF80;
+        }
+
+        uint32_t minPosInf() const {
+            return 0x7F80;
+        }
+    };
+
+    struct BF16_NaNChecker {
+        bool operator()(uint32_t bits) const {
+            return (bits & 0x7FFF) > 0x7F80;
+        }
+
+        uint32_t qNanBitPattern() const {
+            return 0x7FC0;
+        }
+
+        uint32_t sNanBitPattern() const {
+            return 0x7FA0;
+        }
+    };
+
+    // FloatingPointParams for bfloat16 -> 8 exponent bits as float, 7 mantissa bits, infinities and NaNs
+    template<Rounding_Mode round_mode, int stoch_len = 0>
+    constexpr FloatingPointParams param_bfloat16(
+        16, //totoal bitwidth
+        7, // mantissa bits
+        127,  //bias
+        round_mode,  // rounding mode
+        Inf_Behaviors::Extended,    //IEEE infinities
+        NaN_Behaviors::QuietNaN,    //NaN behavior
+        Signedness::Signed,         //It is signed
+        BF16_InfChecker(),          //Inf Functor
+        BF16_NaNChecker()           //NaN Functor
+        , stoch_len
+    );
+
     
 } //namepsace lo_float_internal
 
@@ -755,6 +831,12 @@ namespace lo_float_internal {
     template<int p, Rounding_Mode round_mode = Rounding_Mode::RoundToNearestEven, int stoch_len = 0>
     using float4_p = lo_float_internal::Templated_Float<lo_float_internal::param_float4_p<p, round_mode, stoch_len>>;
 
+    template<Rounding_Mode round_mode = Rounding_Mode::RoundToNearestEven, int stoch_len = 0>
+    using float8_e8m0 = lo_float_internal::Templated_Float<lo_float_internal::param_float8_e8m0<round_mode, stoch_len>>;
+
+    template<Rounding_Mode round_mode = Rounding_Mode::RoundToNearestEven, int stoch_len = 0>
+    using bfloat16 = lo_float_internal::Templated_Float<lo_float_internal::param_bfloat16<round_mode, stoch_len>>;
+
 
     template<typename T>
 constexpr T ConstexprAbs(T x) { return x < T{0.0} ? -x : x; }
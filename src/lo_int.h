@@ -28,24 +28,31 @@ struct get_unsigned_type {
 };
 template<int LEN> using get_unsigned_type_t = typename get_unsigned_type<LEN>::type;
 
-template<int LEN, lo_float::Signedness Signedness>
+template<int LEN, lo_float::Signedness Sign>
 class i_n {
+public:
+  static constexpr int bits = LEN;
+  static constexpr bool is_signed = Sign == lo_float::Signedness::Signed;
+
+private:
   using Storage = get_unsigned_type_t<LEN>;
-  static constexpr Storage MASK = (LEN == 64) ? Storage(-1) : ((Storage(1) << LEN) - 1);
+  //  the value as a host integer of the same width, two's complement for signed
+  using Value = std::conditional_t<is_signed, std::make_signed_t<Storage>, Storage>;
+  static constexpr Storage MASK = Storage(Storage(~Storage(0)) >> (8*sizeof(Storage) - LEN));
 
   Storage v_{0};
 
   static constexpr Storage mask(Storage x) { return x & MASK; }
 
   static constexpr Storage sign_extend(Storage x) {
-    if constexpr (Signedness != lo_float::Signedness::Signed) return mask(x);              // unsigned view
+    if constexpr (!is_signed) return mask(x);              // unsigned view
     else {
       const Storage sign_bit = Storage(1) << (LEN - 1);
-      return mask(x) ^ sign_bit ? (mask(x) | ~MASK) : mask(x);
+      return (mask(x) & sign_bit) ? Storage(mask(x) | ~MASK) : mask(x);
     }
   }
 
-  constexpr Storage int_value() const { return sign_extend(v_); }
+  constexpr Value int_value() const { return static_cast<Value>(sign_extend(v_)); }
 
 public:
   /* --------------------- ctors --------------------- */
@@ -57,6 +64,10 @@ public:
   template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
   explicit constexpr i_n(T x) : v_(mask(Storage(x))) {}
 
+  //  the stored LEN bits as they are
+  static constexpr i_n FromRep(Storage bits) { return i_n(bits); }
+  constexpr Storage rep() const { return v_; }
+
   /* ---------------- arithmetic / bit-wise ---------------- */
   #define LOF_BINARY_OP(op)                                           \
     constexpr i_n operator op(const i_n& o) const {                   \
@@ -75,7 +86,7 @@ public:
   constexpr i_n operator~() const { return i_n(~int_value()); }
   constexpr i_n operator<<(int k) const { return i_n(mask(v_ << k)); }
   constexpr i_n operator>>(int k) const {
-    if constexpr (Signedness = lo_float::Signedness::Signed) return i_n(int_value() >> k);   // arithmetic shift
+    if constexpr (is_signed) return i_n(int_value() >> k);   // arithmetic shift
     else                  return i_n(v_ >> k);            // logical shift
   }
 
@@ -105,7 +116,7 @@ public:
   constexpr i_n  operator--(int)           { i_n t=*this; --*this; return t; }
 
   /* --------------- cast helpers --------------- */
-  template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  template<typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
   explicit constexpr operator T() const    { return static_cast<T>(int_value()); }
 
   constexpr operator std::optional<int64_t>() const {
@@ -114,10 +125,10 @@ public:
 
   /* --------------- limits --------------- */
   static constexpr i_n lowest() {
-    if constexpr (Signed) return i_n(Storage(1) << (LEN - 1)); // two's-complement min
-    else                  return i_n(0);
+    if constexpr (is_signed) return i_n(Storage(1) << (LEN - 1)); // two's-complement min
+    else                     return i_n(0);
   }
-  static constexpr i_n highest() { return i_n(MASK - (Signed ? (Storage(1) << (LEN - 1)) : 0)); }
+  static constexpr i_n highest() { return i_n(MASK - (is_signed ? (Storage(1) << (LEN - 1)) : 0)); }
 
   /* --------------- misc --------------- */
   friend std::ostream& operator<<(std::ostream& os, const i_n& x) {
@@ -130,8 +141,8 @@ public:
 }; // class i_n
 
 /* -------------------- convenience aliases -------------------- */
-template<int LEN> using  int_n = i_n<LEN, true>;
-template<int LEN> using uint_n = i_n<LEN, false>;
+template<int LEN> using  int_n = i_n<LEN, lo_float::Signedness::Signed>;
+template<int LEN> using uint_n = i_n<LEN, lo_float::Signedness::Unsigned>;
 
 using  int4 = int_n<4>;
 using uint4 = uint_n<4>;
@@ -142,8 +153,9 @@ using uint8 = uint_n<8>;              // … and so on
  *          numeric_limits specialisation (partial)                *
  * =============================================================== */
 namespace internal {
-template<int LEN, bool Signed>
+template<int LEN, lo_float::Signedness Sign>
 struct intn_numeric_limits_base {
+  static constexpr bool Signed = Sign == lo_float::Signedness::Signed;
   static constexpr bool is_specialized = true;
   static constexpr bool is_signed      = Signed;
   static constexpr bool is_integer     = true;
@@ -166,24 +178,24 @@ struct intn_numeric_limits_base {
   static constexpr bool traps = true;
   static constexpr bool tinyness_before = false;
 
-  static constexpr i_n<LEN, Signed> min()      noexcept { return i_n<LEN, Signed>::lowest(); }
-  static constexpr i_n<LEN, Signed> lowest()   noexcept { return i_n<LEN, Signed>::lowest(); }
-  static constexpr i_n<LEN, Signed> max()      noexcept { return i_n<LEN, Signed>::highest(); }
-  static constexpr i_n<LEN, Signed> epsilon()  noexcept { return i_n<LEN, Signed>(0); }
-  static constexpr i_n<LEN, Signed> round_error() noexcept { return i_n<LEN, Signed>(0); }
-  static constexpr i_n<LEN, Signed> infinity() noexcept { return i_n<LEN, Signed>(0); }
-  static constexpr i_n<LEN, Signed> quiet_NaN() noexcept { return i_n<LEN, Signed>(0); }
-  static constexpr i_n<LEN, Signed> signaling_NaN() noexcept { return i_n<LEN, Signed>(0); }
-  static constexpr i_n<LEN, Signed> denorm_min() noexcept { return i_n<LEN, Signed>(0); }
+  static constexpr i_n<LEN, Sign> min()      noexcept { return i_n<LEN, Sign>::lowest(); }
+  static constexpr i_n<LEN, Sign> lowest()   noexcept { return i_n<LEN, Sign>::lowest(); }
+  static constexpr i_n<LEN, Sign> max()      noexcept { return i_n<LEN, Sign>::highest(); }
+  static constexpr i_n<LEN, Sign> epsilon()  noexcept { return i_n<LEN, Sign>(0); }
+  static constexpr i_n<LEN, Sign> round_error() noexcept { return i_n<LEN, Sign>(0); }
+  static constexpr i_n<LEN, Sign> infinity() noexcept { return i_n<LEN, Sign>(0); }
+  static constexpr i_n<LEN, Sign> quiet_NaN() noexcept { return i_n<LEN, Sign>(0); }
+  static constexpr i_n<LEN, Sign> signaling_NaN() noexcept { return i_n<LEN, Sign>(0); }
+  static constexpr i_n<LEN, Sign> denorm_min() noexcept { return i_n<LEN, Sign>(0); }
 };
 } // namespace internal
 } // namespace lo_float
 
 /* -------- std::numeric_limits specialisations (all LEN) -------- */
 namespace std {
-template<int LEN, bool Signed>
-struct numeric_limits<lo_float::i_n<LEN, Signed>>
-    : public lo_float::internal::intn_numeric_limits_base<LEN, Signed> {};
+template<int LEN, lo_float::Signedness Sign>
+struct numeric_limits<lo_float::i_n<LEN, Sign>>
+    : public lo_float::internal::intn_numeric_limits_base<LEN, Sign> {};
 } // namespace std
 
 #endif /* LO_FLOAT_INTN_H_ */
@@ -0,0 +1,382 @@
+#ifndef LO_FLOAT_INTN_PACKED_H_
+#define LO_FLOAT_INTN_PACKED_H_
+
+/* ------------------------------------------------------------------ *
+ *  Bit packed arrays of i_n<LEN, Sign> : element k at bits            *
+ *  [k*LEN, k*LEN + LEN) of the byte stream, low bits first, so int4   *
+ *  is two per byte, int2 four per byte and odd LEN runs across bytes. *
+ *  unpack / pack move between the stream and int8 / int16 lanes       *
+ *  (nibbles and crumbs 32 / 64 per SSE step with AVX2 builds), and    *
+ *  the elementwise add, sub, mul, shl and shr work a chunk at a time  *
+ *  in int16 lanes, 16 per AVX2 instruction, with wrap (two's          *
+ *  complement, as i_n does) or saturating results.                    *
+ * ------------------------------------------------------------------ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "lo_int.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace lo_float {
+
+enum Overflow_Behavior : uint8_t {
+  /// @brief keep the low LEN bits of the result
+  Wrap = 0,
+  /// @brief clamp the result to [lowest, highest]
+  Saturate = 1
+};
+
+template<int LEN, lo_float::Signedness Sign = lo_float::Signedness::Signed>
+class packed_i_n {
+  static_assert(LEN >= 1 && LEN <= 16, "packed_i_n holds 1 to 16 bit integers");
+
+public:
+  using value_type = i_n<LEN, Sign>;
+  static constexpr int bits = LEN;
+  static constexpr bool is_signed = Sign == lo_float::Signedness::Signed;
+  static constexpr int32_t lowest  = is_signed ? -(int32_t(1) << (LEN - 1)) : 0;
+  static constexpr int32_t highest = is_signed ? (int32_t(1) << (LEN - 1)) - 1 : (int32_t(1) << LEN) - 1;
+
+  explicit packed_i_n(std::size_t n = 0) : n_(n), bytes_(byte_count(n) + slack, 0) {}
+
+  static constexpr std::size_t byte_count(std::size_t n) { return (n*LEN + 7) / 8; }
+
+  std::size_t size() const  { return n_; }
+  std::size_t bytes() const { return byte_count(n_); }
+  uint8_t* data()             { return bytes_.data(); }
+  const uint8_t* data() const { return bytes_.data(); }
+
+  value_type get(std::size_t k) const {
+    const std::size_t bit = k*LEN;
+    uint32_t w;
+    std::memcpy(&w, bytes_.data() + bit/8, 4);
+    return value_type::FromRep(static_cast<typename std::conditional_t<(LEN <= 8), uint8_t, uint16_t>>(
+        (w >> (bit % 8)) & ((1u << LEN) - 1u)));
+  }
+
+  void set(std::size_t k, value_type v) {
+    const std::size_t bit = k*LEN;
+    uint32_t w;
+    std::memcpy(&w, bytes_.data() + bit/8, 4);
+    const uint32_t m = ((1u << LEN) - 1u) << (bit % 8);
+    w = (w & ~m) | ((static_cast<uint32_t>(v.rep()) << (bit % 8)) & m);
+    std::memcpy(bytes_.data() + bit/8, &w, 4);
+  }
+
+private:
+  //  whole words are read and written at the end of the stream
+  static constexpr std::size_t slack = 4;
+  std::size_t n_;
+  std::vector<uint8_t> bytes_;
+}; // class packed_i_n
+
+template<int LEN> using  packed_int_n = packed_i_n<LEN, lo_float::Signedness::Signed>;
+template<int LEN> using packed_uint_n = packed_i_n<LEN, lo_float::Signedness::Unsigned>;
+
+using  packed_int2 = packed_int_n<2>;
+using packed_uint2 = packed_uint_n<2>;
+using  packed_int4 = packed_int_n<4>;
+using packed_uint4 = packed_uint_n<4>;
+
+namespace packed_internal {
+
+//  elements processed per chunk of the elementwise ops, a multiple of 8 so chunks start on a byte
+constexpr std::size_t chunk = 256;
+
+//  codes[k] ← bits of element k, n elements from the start of src
+template<int LEN, typename Code>
+inline void unpack_codes(const uint8_t* src, std::size_t n, Code* codes) {
+  std::size_t k = 0;
+  if constexpr (LEN == 8) {
+    for (; k < n; ++k) codes[k] = src[k];
+    return;
+  }
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<Code, uint8_t> && LEN == 4) {
+    const __m128i m = _mm_set1_epi8(0x0F);
+    for (; k + 32 <= n; k += 32) {
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k/2));
+      const __m128i lo = _mm_and_si128(b, m), hi = _mm_and_si128(_mm_srli_epi16(b, 4), m);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k), _mm_unpacklo_epi8(lo, hi));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k + 16), _mm_unpackhi_epi8(lo, hi));
+    }
+  } else if constexpr (std::is_same_v<Code, uint8_t> && LEN == 2) {
+    const __m128i m = _mm_set1_epi8(0x03);
+    for (; k + 64 <= n; k += 64) {
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k/4));
+      const __m128i v0 = _mm_and_si128(b, m), v1 = _mm_and_si128(_mm_srli_epi16(b, 2), m);
+      const __m128i v2 = _mm_and_si128(_mm_srli_epi16(b, 4), m), v3 = _mm_and_si128(_mm_srli_epi16(b, 6), m);
+      const __m128i a_lo = _mm_unpacklo_epi8(v0, v1), a_hi = _mm_unpackhi_epi8(v0, v1);
+      const __m128i b_lo = _mm_unpacklo_epi8(v2, v3), b_hi = _mm_unpackhi_epi8(v2, v3);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k),      _mm_unpacklo_epi16(a_lo, b_lo));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k + 16), _mm_unpackhi_epi16(a_lo, b_lo));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k + 32), _mm_unpacklo_epi16(a_hi, b_hi));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k + 48), _mm_unpackhi_epi16(a_hi, b_hi));
+    }
+  }
+#endif
+  //  rest through a 64 bit window, k is a multiple of 8 here so the stream is byte aligned
+  src += k*LEN/8;
+  uint64_t acc = 0;
+  int have = 0;
+  for (; k < n; ++k) {
+    while (have < LEN) { acc |= static_cast<uint64_t>(*src++) << have; have += 8; }
+    codes[k] = static_cast<Code>(acc & ((1u << LEN) - 1u));
+    acc >>= LEN;
+    have -= LEN;
+  }
+}
+
+//  bits of n codes (already reduced to LEN bits) into the stream, the bits after the last one kept
+template<int LEN, typename Code>
+inline void pack_codes(const Code* codes, std::size_t n, uint8_t* dst) {
+  std::size_t k = 0;
+  if constexpr (LEN == 8) {
+    for (; k < n; ++k) dst[k] = static_cast<uint8_t>(codes[k]);
+    return;
+  }
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<Code, uint8_t> && (LEN == 4 || LEN == 2)) {
+    //  pairs of bytes e0 | e1 << 8 become e0 | e1 << LEN in the low byte
+    auto pair = [](__m128i v, int w) {
+      return _mm_and_si128(_mm_or_si128(v, _mm_srli_epi16(v, 8 - w)), _mm_set1_epi16(0x00FF));
+    };
+    if constexpr (LEN == 4) {
+      for (; k + 32 <= n; k += 32) {
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + k));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + k + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k/2), _mm_packus_epi16(pair(v0, 4), pair(v1, 4)));
+      }
+    } else {
+      for (; k + 64 <= n; k += 64) {
+        __m128i v[4];
+        for (int q = 0; q < 4; ++q) v[q] = pair(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + k + 16*q)), 2);
+        const __m128i n0 = _mm_packus_epi16(v[0], v[1]), n1 = _mm_packus_epi16(v[2], v[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k/4), _mm_packus_epi16(pair(n0, 4), pair(n1, 4)));
+      }
+    }
+  }
+#endif
+  dst += k*LEN/8;
+  uint64_t acc = 0;
+  int have = 0;
+  for (; k < n; ++k) {
+    acc |= static_cast<uint64_t>(codes[k]) << have;
+    have += LEN;
+    while (have >= 8) { *dst++ = static_cast<uint8_t>(acc); acc >>= 8; have -= 8; }
+  }
+  if (have > 0) *dst = static_cast<uint8_t>((*dst & ~((1u << have) - 1u)) | acc);
+}
+
+//  lanes[k] ← value of codes[k], sign extended for signed types
+template<int LEN, bool Signed, typename Code, typename Lane>
+inline void codes_to_lanes(const Code* codes, std::size_t n, Lane* lanes) {
+  std::size_t k = 0;
+  const int32_t sb = Signed ? int32_t(1) << (LEN - 1) : 0;
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<Code, uint8_t> && sizeof(Lane) == 2) {
+    const __m256i s = _mm256_set1_epi16(static_cast<int16_t>(sb));
+    for (; k + 16 <= n; k += 16) {
+      const __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + k)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes + k), _mm256_sub_epi16(_mm256_xor_si256(c, s), s));
+    }
+  } else if constexpr (std::is_same_v<Code, uint8_t> && sizeof(Lane) == 1) {
+    const __m256i s = _mm256_set1_epi8(static_cast<int8_t>(sb));
+    for (; k + 32 <= n; k += 32) {
+      const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + k));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes + k), _mm256_sub_epi8(_mm256_xor_si256(c, s), s));
+    }
+  }
+#endif
+  for (; k < n; ++k) lanes[k] = static_cast<Lane>((static_cast<int32_t>(codes[k]) ^ sb) - sb);
+}
+
+//  codes[k] ← low LEN bits of lanes[k], clamped to [lo, hi] first when saturating
+template<int LEN, typename Lane, typename Code>
+inline void lanes_to_codes(const Lane* lanes, std::size_t n, Code* codes, Overflow_Behavior mode, int32_t lo, int32_t hi) {
+  std::size_t k = 0;
+  const uint32_t mask = (1u << LEN) - 1u;
+#if defined(__AVX2__)
+  if constexpr (std::is_same_v<Lane, int16_t> && std::is_same_v<Code, uint8_t>) {
+    const __m256i vlo = _mm256_set1_epi16(static_cast<int16_t>(lo)), vhi = _mm256_set1_epi16(static_cast<int16_t>(hi));
+    const __m256i vm = _mm256_set1_epi16(static_cast<int16_t>(mask));
+    for (; k + 16 <= n; k += 16) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes + k));
+      if (mode == Saturate) v = _mm256_min_epi16(_mm256_max_epi16(v, vlo), vhi);
+      v = _mm256_and_si256(v, vm);
+      const __m128i p = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(codes + k), p);
+    }
+  }
+#endif
+  for (; k < n; ++k) {
+    int32_t v = static_cast<int32_t>(lanes[k]);
+    if (mode == Saturate) v = std::clamp(v, lo, hi);
+    codes[k] = static_cast<Code>(static_cast<uint32_t>(v) & mask);
+  }
+}
+
+enum Arith : uint8_t { Add, Sub, Mul, Shl, Shr };
+
+//  r ← a op b (or a shifted by s) in int16 lanes. For LEN ≤ 8 every exact result fits 16 bits,
+//  read as unsigned for the unsigned products and left shifts, so saturation clamps the exact value.
+template<bool Signed>
+inline void lanes_op(Arith op, const int16_t* a, const int16_t* b, int s, int16_t* r, std::size_t n,
+                     Overflow_Behavior mode, int32_t lo, int32_t hi) {
+  std::size_t k = 0;
+#if defined(__AVX2__)
+  const bool wide = !Signed && (op == Mul || op == Shl);
+  const __m128i cnt = _mm_cvtsi32_si128(s);
+  const __m256i vlo = _mm256_set1_epi16(static_cast<int16_t>(lo)), vhi = _mm256_set1_epi16(static_cast<int16_t>(hi));
+  for (; k + 16 <= n; k += 16) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k));
+    __m256i v;
+    switch (op) {
+      case Add: v = _mm256_add_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k))); break;
+      case Sub: v = _mm256_sub_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k))); break;
+      case Mul: v = _mm256_mullo_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k))); break;
+      case Shl: v = _mm256_sll_epi16(x, cnt); break;
+      default:  v = Signed ? _mm256_sra_epi16(x, cnt) : _mm256_srl_epi16(x, cnt); break;
+    }
+    if (mode == Saturate) {
+      if (wide) v = _mm256_min_epu16(v, vhi);
+      else v = _mm256_min_epi16(_mm256_max_epi16(v, vlo), vhi);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + k), v);
+  }
+#endif
+  for (; k < n; ++k) {
+    const int32_t x = a[k];
+    int32_t v;
+    switch (op) {
+      case Add: v = x + b[k]; break;
+      case Sub: v = x - b[k]; break;
+      case Mul: v = x * b[k]; break;
+      case Shl: v = x * (int32_t(1) << s); break;
+      default:  v = x >> s; break;
+    }
+    if (mode == Saturate) v = std::clamp(v, lo, hi);
+    r[k] = static_cast<int16_t>(v);
+  }
+}
+
+//  c ← a op b over whole chunks of the streams, spread over threads
+template<int LEN, lo_float::Signedness Sign>
+inline void elementwise(Arith op, const packed_i_n<LEN, Sign>& a, const packed_i_n<LEN, Sign>* b, int s,
+                        packed_i_n<LEN, Sign>& c, Overflow_Behavior mode) {
+  static_assert(LEN <= 8, "packed arithmetic works in int16 lanes, LEN <= 8");
+  using P = packed_i_n<LEN, Sign>;
+  const std::size_t n = a.size();
+  assert(c.size() == n && (!b || b->size() == n));
+  const std::size_t chunks = (n + chunk - 1) / chunk;
+
+  #pragma omp parallel
+  {
+    alignas(32) uint8_t codes[chunk]{};
+    alignas(32) int16_t la[chunk], lb[chunk], lr[chunk];
+
+    #pragma omp for schedule(static)
+    for (std::size_t q = 0; q < chunks; ++q) {
+      const std::size_t k0 = q*chunk, len = std::min(chunk, n - k0);
+      const std::size_t byte0 = k0*LEN/8;
+      unpack_codes<LEN>(a.data() + byte0, len, codes);
+      codes_to_lanes<LEN, P::is_signed>(codes, len, la);
+      if (b) {
+        unpack_codes<LEN>(b->data() + byte0, len, codes);
+        codes_to_lanes<LEN, P::is_signed>(codes, len, lb);
+      }
+      lanes_op<P::is_signed>(op, la, lb, s, lr, len, mode, P::lowest, P::highest);
+      //  the lanes are exact or already clamped, what is left is the wrap to LEN bits
+      lanes_to_codes<LEN>(lr, len, codes, Wrap, P::lowest, P::highest);
+      pack_codes<LEN>(codes, len, c.data() + byte0);
+    }
+  }
+}
+
+} // namespace packed_internal
+
+/* ---------------- unpack / pack ---------------- */
+
+//  out[k] ← a[first + k] for k < count (all elements from first by default), first a multiple of 8.
+//  Lane is any integer type that holds every value of the element type.
+template<int LEN, lo_float::Signedness Sign, typename Lane>
+void unpack(const packed_i_n<LEN, Sign>& a, Lane* out, std::size_t first = 0, std::size_t count = std::size_t(-1)) {
+  using P = packed_i_n<LEN, Sign>;
+  static_assert(std::is_integral_v<Lane>, "unpack into integer lanes");
+  static_assert(P::lowest >= std::numeric_limits<Lane>::min() && P::highest <= std::numeric_limits<Lane>::max(),
+                "the lane type cannot hold every element");
+  using Code = std::conditional_t<(LEN <= 8), uint8_t, uint16_t>;
+  assert(first % 8 == 0 && first <= a.size());
+  count = std::min(count, a.size() - first);
+  const std::size_t chunks = (count + packed_internal::chunk - 1) / packed_internal::chunk;
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t q = 0; q < chunks; ++q) {
+    alignas(32) Code codes[packed_internal::chunk]{};
+    const std::size_t k0 = q*packed_internal::chunk, len = std::min(packed_internal::chunk, count - k0);
+    packed_internal::unpack_codes<LEN>(a.data() + (first + k0)*LEN/8, len, codes);
+    packed_internal::codes_to_lanes<LEN, P::is_signed>(codes, len, out + k0);
+  }
+}
+
+//  a[first + k] ← in[k] for k < count, first a multiple of 8, out of range values wrapped or clamped
+template<typename Lane, int LEN, lo_float::Signedness Sign>
+void pack(const Lane* in, std::size_t count, packed_i_n<LEN, Sign>& a, std::size_t first = 0, Overflow_Behavior mode = Wrap) {
+  using P = packed_i_n<LEN, Sign>;
+  static_assert(std::is_integral_v<Lane>, "pack from integer lanes");
+  using Code = std::conditional_t<(LEN <= 8), uint8_t, uint16_t>;
+  assert(first % 8 == 0 && first + count <= a.size());
+  const std::size_t chunks = (count + packed_internal::chunk - 1) / packed_internal::chunk;
+
+  #pragma omp parallel for schedule(static)
+  for (std::size_t q = 0; q < chunks; ++q) {
+    alignas(32) Code codes[packed_internal::chunk]{};
+    const std::size_t k0 = q*packed_internal::chunk, len = std::min(packed_internal::chunk, count - k0);
+    packed_internal::lanes_to_codes<LEN>(in + k0, len, codes, mode, P::lowest, P::highest);
+    packed_internal::pack_codes<LEN>(codes, len, a.data() + (first + k0)*LEN/8);
+  }
+}
+
+/* ---------------- elementwise arithmetic ---------------- */
+
+//  c ← a + b, a − b, a·b
+template<int LEN, lo_float::Signedness Sign>
+void add(const packed_i_n<LEN, Sign>& a, const packed_i_n<LEN, Sign>& b, packed_i_n<LEN, Sign>& c, Overflow_Behavior mode = Wrap) {
+  packed_internal::elementwise(packed_internal::Add, a, &b, 0, c, mode);
+}
+
+template<int LEN, lo_float::Signedness Sign>
+void sub(const packed_i_n<LEN, Sign>& a, const packed_i_n<LEN, Sign>& b, packed_i_n<LEN, Sign>& c, Overflow_Behavior mode = Wrap) {
+  packed_internal::elementwise(packed_internal::Sub, a, &b, 0, c, mode);
+}
+
+template<int LEN, lo_float::Signedness Sign>
+void mul(const packed_i_n<LEN, Sign>& a, const packed_i_n<LEN, Sign>& b, packed_i_n<LEN, Sign>& c, Overflow_Behavior mode = Wrap) {
+  packed_internal::elementwise(packed_internal::Mul, a, &b, 0, c, mode);
+}
+
+//  c ← a << s (wrapped or clamped), a >> s (arithmetic for signed types, logical otherwise)
+template<int LEN, lo_float::Signedness Sign>
+void shl(const packed_i_n<LEN, Sign>& a, int s, packed_i_n<LEN, Sign>& c, Overflow_Behavior mode = Wrap) {
+  packed_internal::elementwise(packed_internal::Shl, a, static_cast<const packed_i_n<LEN, Sign>*>(nullptr),
+                               std::clamp(s, 0, LEN), c, mode);
+}
+
+template<int LEN, lo_float::Signedness Sign>
+void shr(const packed_i_n<LEN, Sign>& a, int s, packed_i_n<LEN, Sign>& c) {
+  packed_internal::elementwise(packed_internal::Shr, a, static_cast<const packed_i_n<LEN, Sign>*>(nullptr),
+                               std::clamp(s, 0, LEN), c, Wrap);
+}
+
+} // namespace lo_float
+
+#endif  // LO_FLOAT_INTN_PACKED_H_
@@ -0,0 +1,246 @@
+///@author Sudhanva Kulkarni
+/// Level 1 kernels on Lo_Gemm::MX_Vector that work block by block, the way MX dot product units do :
+///     mx_dot  : Σ_i x_i·y_i
+///     mx_sum  : Σ_i x_i
+///     mx_axpy : y ← alpha·x + y, y a plain Vector or an MX_Vector
+/// MX_Vector::operator() scales every element by its shared exponent. Here the codes of a block are decoded
+/// (decode_n, eight per AVX2 gather) and multiplied / added in Accum1 without any scaling, the block result
+/// is turned into one partial per block, and only then are the shared scales applied : for integral or E8M0
+/// exponents
+///     2^(ex_b + ey_b)
+/// is formed by adding the exponents and building the double directly from the sum, in a pass over all blocks
+/// that also does the multiply-add into the Accum2 result, four blocks per AVX2 instruction. Products of two
+/// elements of at most 12 significant bits are exact in float, so with the default Accum1 (the decoded format,
+/// float for lo_float) the only roundings are the sums within a block and the one of each block partial; integer
+/// and block floating point elements sum exactly in int32_t / int64_t (mx_accum1_t).
+/// Both operands of mx_dot must use the same block size. Blocks are spread over threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "Vector.h"
+#include "gemm_helpers.hpp"
+#include "mx_quantize.hpp"
+
+namespace LoGemm {
+
+namespace mx_blas1_internal {
+
+//  Σ a_i·b_i / Σ a_i over one block in Acc
+template<typename Acc, typename P>
+inline Acc block_dot(const P* a, const P* b, std::size_t n) noexcept
+{
+    Acc acc{};
+    std::size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    if constexpr (std::is_same_v<Acc, float> && std::is_same_v<P, float>) {
+        __m256 v = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) v = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), v);
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, v);
+        for (float l : lanes) acc += l;
+    }
+#endif
+    for (; i < n; ++i) acc_fma(acc, a[i], b[i]);
+    return acc;
+}
+
+template<typename Acc, typename P>
+inline Acc block_sum(const P* a, std::size_t n) noexcept
+{
+    Acc acc{};
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<Acc, float> && std::is_same_v<P, float>) {
+        __m256 v = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) v = _mm256_add_ps(_mm256_loadu_ps(a + i), v);
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, v);
+        for (float l : lanes) acc += l;
+    }
+#endif
+    for (; i < n; ++i) acc_add(acc, a[i]);
+    return acc;
+}
+
+//  2^e as a double, e well inside the normal range (sums of two E8M0 exponents are)
+inline double pow2(int e) noexcept
+{
+    const uint64_t bits = static_cast<uint64_t>(e + 1023) << 52;
+    double d;
+    std::memcpy(&d, &bits, 8);
+    return d;
+}
+
+//  Σ_b part_b·2^e_b in double, the scale of every block built from its exponent
+inline double scaled_sum(const double* part, const int* e, std::size_t nb) noexcept
+{
+    std::size_t b = 0;
+    double s = 0.0;
+#if defined(__AVX2__)
+    __m256d acc = _mm256_setzero_pd();
+    const __m128i bias = _mm_set1_epi32(1023);
+    for (; b + 4 <= nb; b += 4) {
+        const __m128i eb = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(e + b)), bias);
+        const __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(eb), 52));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(part + b), scale));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    s = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; b < nb; ++b) s += part[b] * pow2(e[b]);
+    return s;
+}
+
+//  the partials of every block and their scales, then their sum in Acc2
+template<typename Acc2, typename S1, typename S2>
+inline Acc2 combine(const std::vector<double>& part, const S1* ex, const S2* ey, std::size_t nb)
+{
+    constexpr bool exp1 = std::is_integral_v<S1> || Lo_Gemm::is_exponent_format_v<S1>;
+    constexpr bool exp2 = [] {
+        if constexpr (std::is_void_v<S2>) return true;
+        else return std::is_integral_v<S2> || Lo_Gemm::is_exponent_format_v<S2>;
+    }();
+    if constexpr (exp1 && exp2) {
+        std::vector<int> e(nb);
+        for (std::size_t b = 0; b < nb; ++b) {
+            e[b] = Lo_Gemm::scale_exponent(ex[b]);
+            if constexpr (!std::is_void_v<S2>) e[b] += Lo_Gemm::scale_exponent(ey[b]);
+        }
+        if constexpr (std::is_same_v<Acc2, double>) {
+            return scaled_sum(part.data(), e.data(), nb);
+        } else {
+            Acc2 s{};
+            for (std::size_t b = 0; b < nb; ++b) acc_add(s, part[b] * pow2(e[b]));
+            return s;
+        }
+    } else {
+        Acc2 s{};
+        for (std::size_t b = 0; b < nb; ++b) {
+            double scale = Lo_Gemm::shared_scale<double>(ex[b]);
+            if constexpr (!std::is_void_v<S2>) scale *= Lo_Gemm::shared_scale<double>(ey[b]);
+            acc_add(s, part[b] * scale);
+        }
+        return s;
+    }
+}
+
+} // namespace mx_blas1_internal
+
+
+//  Σ_i x_i·y_i, products of a block accumulated in Accum1, blocks combined in Accum2
+template<typename Accum1 = void, typename Accum2 = double,
+         typename T_x, typename T_y, typename idx, typename S_x, typename S_y>
+Accum2 mx_dot(const Lo_Gemm::MX_Vector<T_x, idx, S_x>& x, const Lo_Gemm::MX_Vector<T_y, idx, S_y>& y)
+{
+    using pack_t = pack_type_t<T_x>;
+    using acc1_t = default_if_void_t<Accum1, mx_accum1_t<T_x>>;
+    const std::size_t n = x.size(), r = x.block_size();
+    assert(y.size() == x.size() && y.block_size() == x.block_size());
+    const std::size_t nb = (n + r - 1) / r;
+    std::vector<double> part(nb);
+
+    #pragma omp parallel
+    {
+        std::vector<pack_t> bx(r), by(r);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < nb; ++b) {
+            const std::size_t c = std::min(r, n - b*r);
+            decode_n(x.ptr() + b*r*x.inc(), static_cast<std::ptrdiff_t>(x.inc()), bx.data(), c);
+            decode_n(y.ptr() + b*r*y.inc(), static_cast<std::ptrdiff_t>(y.inc()), by.data(), c);
+            part[b] = lo_cast<double>(mx_blas1_internal::block_dot<acc1_t>(bx.data(), by.data(), c));
+        }
+    }
+    return mx_blas1_internal::combine<Accum2>(part, x.exps(), y.exps(), nb);
+}
+
+//  Σ_i x_i
+template<typename Accum1 = void, typename Accum2 = double, typename T_x, typename idx, typename S_x>
+Accum2 mx_sum(const Lo_Gemm::MX_Vector<T_x, idx, S_x>& x)
+{
+    using pack_t = pack_type_t<T_x>;
+    using acc1_t = default_if_void_t<Accum1, mx_accum1_t<T_x>>;
+    const std::size_t n = x.size(), r = x.block_size();
+    const std::size_t nb = (n + r - 1) / r;
+    std::vector<double> part(nb);
+
+    #pragma omp parallel
+    {
+        std::vector<pack_t> bx(r);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < nb; ++b) {
+            const std::size_t c = std::min(r, n - b*r);
+            decode_n(x.ptr() + b*r*x.inc(), static_cast<std::ptrdiff_t>(x.inc()), bx.data(), c);
+            part[b] = lo_cast<double>(mx_blas1_internal::block_sum<acc1_t>(bx.data(), c));
+        }
+    }
+    return mx_blas1_internal::combine<Accum2, S_x, void>(part, x.exps(), nullptr, nb);
+}
+
+//  y ← alpha·x + y : one scale alpha·2^e_b per block, y_i rounded once into its format
+template<typename T_x, typename idx, typename S_x, typename T_y>
+void mx_axpy(float alpha, const Lo_Gemm::MX_Vector<T_x, idx, S_x>& x, Lo_Gemm::Vector<T_y, idx>& y)
+{
+    const std::size_t n = x.size(), r = x.block_size();
+    assert(y.size() == x.size());
+    const std::size_t nb = (n + r - 1) / r;
+    const std::ptrdiff_t iy = static_cast<std::ptrdiff_t>(y.inc());
+
+    #pragma omp parallel
+    {
+        std::vector<float> bx(r), by(r);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < nb; ++b) {
+            const std::size_t c = std::min(r, n - b*r);
+            const float s = alpha * Lo_Gemm::shared_scale<float>(x.exps()[b]);
+            decode_n(x.ptr() + b*r*x.inc(), static_cast<std::ptrdiff_t>(x.inc()), bx.data(), c);
+            T_y* yb = y.ptr() + static_cast<std::ptrdiff_t>(b*r)*iy;
+            decode_n(yb, iy, by.data(), c);
+            for (std::size_t i = 0; i < c; ++i) yb[static_cast<std::ptrdiff_t>(i)*iy] = lo_cast<T_y>(std::fma(s, bx[i], by[i]));
+        }
+    }
+}
+
+//  y ← alpha·x + y for an MX y with the block size of x : every block of y is decoded, updated in float and
+//  requantized with a new shared exponent (mx_quantize's rule)
+template<typename T_x, typename idx, typename S_x, typename T_y, typename S_y>
+void mx_axpy(float alpha, const Lo_Gemm::MX_Vector<T_x, idx, S_x>& x, Lo_Gemm::MX_Vector<T_y, idx, S_y>& y)
+{
+    const std::size_t n = x.size(), r = x.block_size();
+    assert(y.size() == x.size() && y.block_size() == x.block_size());
+    const std::size_t nb = (n + r - 1) / r;
+    const std::ptrdiff_t iy = static_cast<std::ptrdiff_t>(y.inc());
+
+    #pragma omp parallel
+    {
+        std::vector<float> bx(r), by(r);
+        std::vector<T_y> q(r);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < nb; ++b) {
+            const std::size_t c = std::min(r, n - b*r);
+            const float sx = alpha * Lo_Gemm::shared_scale<float>(x.exps()[b]);
+            const float sy = Lo_Gemm::shared_scale<float>(y.exps()[b]);
+            decode_n(x.ptr() + b*r*x.inc(), static_cast<std::ptrdiff_t>(x.inc()), bx.data(), c);
+            T_y* yb = y.ptr() + static_cast<std::ptrdiff_t>(b*r)*iy;
+            decode_n(yb, iy, by.data(), c);
+            for (std::size_t i = 0; i < c; ++i) by[i] = std::fma(sx, bx[i], sy*by[i]);
+
+            y.exps()[b] = mx_internal::store_scale<S_y>(mx_internal::quantize_block(by.data(), c, q.data()));
+            for (std::size_t i = 0; i < c; ++i) yb[static_cast<std::ptrdiff_t>(i)*iy] = q[i];
+        }
+    }
+}
+
+} // namespace LoGemm
@@ -0,0 +1,385 @@
+///@author Sudhanva Kulkarni
+/// MX block quantization (OCP Microscaling) : X ≈ 2^e_b · q for every block b of X, with q in the element format T
+/// and one shared power of two exponent per block,
+///     e_b = clamp(floor(log2(amax_b)) − emax_T, −127, 127)        (the E8M0 range)
+/// where emax_T is the exponent of the largest finite T. Elements are scaled by 2^−e_b, clamped to the largest
+/// magnitude T holds with either sign (as OCP MX prescribes) and rounded to nearest even.
+/// Blocks follow Lo_Gemm::MX_tuple, and the exponents are stored row major over the block grid with lde entries
+/// per line of blocks (0 : as many as there are blocks in that line) :
+///     byRow    : blk.m consecutive elements of a row       exps[i*lde + j/blk.m]
+///     byColumn : blk.m consecutive elements of a column    exps[j*lde + i/blk.m]
+///     byBlock  : blk.m×blk.n tiles                         exps[(i/blk.m)*lde + j/blk.n]
+/// An integral T_scal stores e_b, lo_float::float8_e8m0 the code e_b + 127, any other type the scale 2^e_b, as in
+/// Lo_Gemm::shared_scale.
+/// Each block is read once into a small buffer (decode_n, so narrow inputs decode eight at a time), its amax and
+/// the scaled, rounded codes are computed there with AVX2, and the codes are written out. The encoder works on the
+/// bit pattern of the scaled float, for any lo_float of at most 8 bits that rounds to nearest even and has a sign
+/// bit; other element formats go through lo_cast one element at a time. lo_float::int_n elements (block floating
+/// point, see bfp.hpp) are rounded and clamped to ±(2^(LEN−1) − 1) directly, emax being LEN − 2 for them.
+/// Blocks are spread over threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "Matrix.h"
+#include "Vector.h"
+#include "gemm_helpers.hpp"
+
+namespace LoGemm {
+
+namespace mx_internal {
+
+//  RNE float → code of an 8-bit-or-narrower lo_float from the bits of |x| :
+//      normal    : round the float mantissa to M bits and rebias the exponent field
+//      subnormal : code = rint(|x|·2^(M + bias − 1)), which also yields the smallest normal on carry
+//  bias is recovered from the decode table and the whole code range is checked once, so formats whose
+//  encoding is not of this shape simply report ok = false.
+template<typename T>
+struct Encoder {
+    static constexpr int M = T::mantissa_bits;
+    bool ok = false;
+    int bias = 0;
+    float maxval = 0.0f;                // largest value finite with either sign
+    float minnorm = 0.0f;               // smallest normal value
+    float subscale = 0.0f;              // 2^(M + bias − 1)
+    uint8_t signbit = 0;
+    bool neg_zero = true;               // whether −0 has its own code
+
+    uint8_t encode_abs(float ax) const noexcept
+    {
+        ax = std::min(ax, maxval);
+        if (ax < minnorm) return static_cast<uint8_t>(std::lrint(ax * subscale));
+        uint32_t b;
+        std::memcpy(&b, &ax, 4);
+        b += ((1u << (22 - M)) - 1u) + ((b >> (23 - M)) & 1u);
+        return static_cast<uint8_t>((b >> (23 - M)) - (static_cast<uint32_t>(127 - bias) << M));
+    }
+
+    uint8_t encode(float x) const noexcept
+    {
+        const uint8_t c = encode_abs(std::abs(x));
+        return (std::signbit(x) && (c != 0 || neg_zero)) ? static_cast<uint8_t>(c | signbit) : c;
+    }
+
+    Encoder()
+    {
+        if constexpr (has_decode_table_v<T>) {
+            if (T::rounding_mode != lo_float::RoundToNearestEven || T::is_signed != lo_float::Signed) return;
+            const float* lut = decode_table<T>();
+            const unsigned half = 1u << (T::bitwidth - 1);
+            signbit = static_cast<uint8_t>(half);
+            unsigned top = 0;
+            for (unsigned c = 0; c < half; ++c)
+                if (std::isfinite(lut[c]) && lut[c | half] == -lut[c] && lut[c] > lut[top]) top = c;
+            maxval = lut[top];
+            minnorm = lut[1u << M];
+            if (!(minnorm > 0.0f)) return;
+            bias = 1 - std::ilogb(minnorm);
+            subscale = std::ldexp(1.0f, M + bias - 1);
+            neg_zero = !std::isnan(lut[half]);
+            for (unsigned c = 0; c <= top; ++c)
+                if (lut[c] < 0.0f || encode_abs(lut[c]) != c) return;
+            ok = true;
+        }
+    }
+};
+
+template<typename T>
+inline const Encoder<T>& encoder()
+{
+    static const Encoder<T> e;
+    return e;
+}
+
+inline float block_amax(const float* x, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    float amax = 0.0f;
+#if defined(__AVX2__)
+    const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 vmax = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+        vmax = _mm256_max_ps(vmax, _mm256_and_ps(_mm256_loadu_ps(x + i), absmask));
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, vmax);
+    for (float v : lanes) amax = std::max(amax, v);
+#endif
+    for (; i < n; ++i) amax = std::max(amax, std::abs(x[i]));
+    return amax;
+}
+
+//  codes[i] ← code of x[i]·s
+template<typename T>
+inline void encode_block(const Encoder<T>& enc, const float* x, float s, uint8_t* codes, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    constexpr int M = T::mantissa_bits;
+    const __m256 vs = _mm256_set1_ps(s);
+    const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 maxv = _mm256_set1_ps(enc.maxval);
+    const __m256 minn = _mm256_set1_ps(enc.minnorm);
+    const __m256 subs = _mm256_set1_ps(enc.subscale);
+    const __m256i half = _mm256_set1_epi32((1 << (22 - M)) - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i rebias = _mm256_set1_epi32((127 - enc.bias) << M);
+    const __m256i sign = _mm256_set1_epi32(enc.signbit);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + i), vs);
+        const __m256 ax = _mm256_min_ps(_mm256_and_ps(v, absmask), maxv);
+        const __m256i b = _mm256_castps_si256(ax);
+        const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(b, 23 - M), one);
+        __m256i nor = _mm256_srli_epi32(_mm256_add_epi32(b, _mm256_add_epi32(half, lsb)), 23 - M);
+        nor = _mm256_sub_epi32(nor, rebias);
+        const __m256i sub = _mm256_cvtps_epi32(_mm256_mul_ps(ax, subs));
+        __m256i c = _mm256_blendv_epi8(nor, sub, _mm256_castps_si256(_mm256_cmp_ps(ax, minn, _CMP_LT_OQ)));
+
+        __m256i neg = _mm256_srai_epi32(_mm256_castps_si256(v), 31);
+        if (!enc.neg_zero) neg = _mm256_andnot_si256(_mm256_cmpeq_epi32(c, zero), neg);
+        c = _mm256_or_si256(c, _mm256_and_si256(neg, sign));
+
+        const __m128i p16 = _mm_packus_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(codes + i), _mm_packus_epi16(p16, p16));
+    }
+#endif
+    for (; i < n; ++i) codes[i] = enc.encode(x[i] * s);
+}
+
+//  lo_int elements : q = clamp(rint(x·s), ±(2^(LEN−1) − 1)), symmetric as the OCP MXINT8 mantissas are.
+//  Eight lanes per AVX2 instruction, narrowed to bytes / halfwords for 8 and 16 bit mantissas.
+template<typename T>
+inline void encode_int_block(const float* x, float s, T* q, std::size_t n) noexcept
+{
+    const float lim = static_cast<float>(std::numeric_limits<T>::max());
+    const float low = T::is_signed ? -lim : 0.0f;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (T::is_signed && (T::bits == 8 || T::bits == 16) && sizeof(T) == T::bits/8) {
+        const __m256 vs = _mm256_set1_ps(s), hi = _mm256_set1_ps(lim), lo = _mm256_set1_ps(-lim);
+        for (; i + 8 <= n; i += 8) {
+            const __m256 v = _mm256_round_ps(_mm256_mul_ps(_mm256_loadu_ps(x + i), vs), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            const __m256i w = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi));
+            const __m128i h = _mm_packs_epi32(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+            if constexpr (T::bits == 8) _mm_storel_epi64(reinterpret_cast<__m128i*>(q + i), _mm_packs_epi16(h, h));
+            else _mm_storeu_si128(reinterpret_cast<__m128i*>(q + i), h);
+        }
+    }
+#endif
+    for (; i < n; ++i) q[i] = T(static_cast<int64_t>(std::nearbyint(std::clamp(x[i] * s, low, lim))));
+}
+
+//  largest finite exponent of T
+template<typename T>
+inline int emax()
+{
+    return std::ilogb(static_cast<double>(std::numeric_limits<T>::max()));
+}
+
+using Lo_Gemm::store_scale;
+
+template<typename T_scal>
+inline int load_scale(T_scal s)
+{
+    if constexpr (std::is_integral_v<T_scal> || Lo_Gemm::is_exponent_format_v<T_scal>) return Lo_Gemm::scale_exponent(s);
+    else return std::ilogb(static_cast<double>(s));
+}
+
+//  q ← x·2^−e in T for one block of len values, returns its exponent e
+template<typename T>
+inline int quantize_block(const float* x, std::size_t len, T* q)
+{
+    const float amax = block_amax(x, len);
+    const int e = (amax > 0.0f && std::isfinite(amax)) ? std::clamp(std::ilogb(amax) - emax<T>(), -127, 127) : -127;
+    const float s = std::ldexp(1.0f, -e);
+
+    if constexpr (is_lo_int_v<T>) {
+        encode_int_block(x, s, q, len);
+        return e;
+    } else if constexpr (has_decode_table_v<T>) {
+        const Encoder<T>& enc = encoder<T>();
+        if (enc.ok) {
+            encode_block(enc, x, s, reinterpret_cast<uint8_t*>(q), len);
+            return e;
+        }
+    }
+    if constexpr (!is_lo_int_v<T>) {
+        const float lim = Lo_Gemm::mx_element_limit<T>();
+        for (std::size_t i = 0; i < len; ++i) q[i] = lo_cast<T>(std::clamp(x[i] * s, -lim, lim));
+    }
+    return e;
+}
+
+//  block b of an m×n operand : first element, extent, and index of its exponent
+struct BlockGrid {
+    Lo_Gemm::MX_tuple blk;
+    std::size_t m, n, lde;
+    std::size_t br, bc;                 // blocks per column / per row of the grid
+
+    BlockGrid(std::size_t m, std::size_t n, Lo_Gemm::MX_tuple blk, std::size_t lde) : blk(blk), m(m), n(n)
+    {
+        const std::size_t bm = static_cast<std::size_t>(std::max(blk.m, 1));
+        const std::size_t bn = static_cast<std::size_t>(std::max(blk.n, 1));
+        switch (blk.layout) {
+            case Lo_Gemm::byRow:    br = m;                  bc = (n + bm - 1) / bm; break;
+            case Lo_Gemm::byColumn: br = (m + bm - 1) / bm;  bc = n;                 break;
+            default:                br = (m + bm - 1) / bm;  bc = (n + bn - 1) / bn; break;
+        }
+        const std::size_t per_line = blk.layout == Lo_Gemm::byColumn ? br : bc;
+        this->lde = lde ? lde : per_line;
+    }
+
+    std::size_t count() const noexcept { return br * bc; }
+
+    //  rows i0:i0+r, columns j0:j0+c and exponent index of block (p, q) of the grid
+    void block(std::size_t p, std::size_t q, std::size_t& i0, std::size_t& j0, std::size_t& r, std::size_t& c,
+               std::size_t& e) const noexcept
+    {
+        const std::size_t bm = static_cast<std::size_t>(std::max(blk.m, 1));
+        const std::size_t bn = static_cast<std::size_t>(std::max(blk.n, 1));
+        switch (blk.layout) {
+            case Lo_Gemm::byRow:
+                i0 = p; r = 1; j0 = q*bm; c = std::min(bm, n - j0); e = p*lde + q; break;
+            case Lo_Gemm::byColumn:
+                i0 = p*bm; r = std::min(bm, m - i0); j0 = q; c = 1; e = q*lde + p; break;
+            default:
+                i0 = p*bm; r = std::min(bm, m - i0); j0 = q*bn; c = std::min(bn, n - j0); e = p*lde + q; break;
+        }
+    }
+};
+
+} // namespace mx_internal
+
+
+//  number of exponents an m×n operand needs with the default lde
+inline std::size_t mx_scale_count(std::size_t m, std::size_t n, Lo_Gemm::MX_tuple blk)
+{
+    return mx_internal::BlockGrid(m, n, blk, 0).count();
+}
+
+//---------------------------------------------------------------------
+//  Q, exps ← MX quantization of X. X and Q are Lo_Gemm::Matrix views of  //
+//  the same shape (any layouts, any input format, float fastest).        //
+//---------------------------------------------------------------------
+template<typename MatrixX, typename MatrixQ, typename T_scal>
+void mx_quantize(const MatrixX& X, MatrixQ& Q, T_scal* exps, Lo_Gemm::MX_tuple blk, std::size_t lde = 0)
+{
+    using namespace mx_internal;
+    using T = typename MatrixQ::value_type;
+    const std::size_t m = X.rows(), n = X.cols();
+    const BlockGrid grid(m, n, blk, lde);
+    const std::size_t bsize = static_cast<std::size_t>(std::max(blk.m, 1)) *
+                              (blk.layout == Lo_Gemm::byBlock ? static_cast<std::size_t>(std::max(blk.n, 1)) : 1);
+
+    const auto* xd = X.data;
+    auto* qd = Q.data;
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+    const std::ptrdiff_t qrs = Q.row_stride(), qcs = Q.col_stride();
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(bsize);
+        std::vector<T> q(bsize);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < grid.count(); ++b) {
+            std::size_t i0, j0, r, c, ei;
+            grid.block(b / grid.bc, b % grid.bc, i0, j0, r, c, ei);
+
+            //  block rows, one after the other, into buf
+            for (std::size_t i = 0; i < r; ++i)
+                decode_n(xd + (i0+i)*xrs + j0*xcs, xcs, buf.data() + i*c, c);
+            const std::size_t len = r*c;
+
+            exps[ei] = store_scale<T_scal>(quantize_block(buf.data(), len, q.data()));
+            for (std::size_t i = 0; i < r; ++i)
+                for (std::size_t j = 0; j < c; ++j)
+                    qd[(i0+i)*qrs + (j0+j)*qcs] = q[i*c + j];
+        }
+    }
+}
+
+//  X ← 2^e_b·q for every block, rounded into the format of X
+template<typename MatrixQ, typename T_scal, typename MatrixX>
+void mx_dequantize(const MatrixQ& Q, const T_scal* exps, Lo_Gemm::MX_tuple blk, MatrixX& X, std::size_t lde = 0)
+{
+    using namespace mx_internal;
+    using T_x = typename MatrixX::value_type;
+    const std::size_t m = Q.rows(), n = Q.cols();
+    const BlockGrid grid(m, n, blk, lde);
+    const std::size_t bsize = static_cast<std::size_t>(std::max(blk.m, 1)) *
+                              (blk.layout == Lo_Gemm::byBlock ? static_cast<std::size_t>(std::max(blk.n, 1)) : 1);
+
+    const auto* qd = Q.data;
+    auto* xd = X.data;
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+    const std::ptrdiff_t qrs = Q.row_stride(), qcs = Q.col_stride();
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(bsize);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < grid.count(); ++b) {
+            std::size_t i0, j0, r, c, ei;
+            grid.block(b / grid.bc, b % grid.bc, i0, j0, r, c, ei);
+            const float s = std::ldexp(1.0f, load_scale(exps[ei]));
+            for (std::size_t i = 0; i < r; ++i) {
+                float* row = buf.data();
+                decode_n(qd + (i0+i)*qrs + j0*qcs, qcs, row, c);
+                for (std::size_t j = 0; j < c; ++j)
+                    xd[(i0+i)*xrs + (j0+j)*xcs] = lo_cast<T_x>(row[j] * s);
+            }
+        }
+    }
+}
+
+
+//---------------------------------------------------------------------
+//  MX containers : blocks of r elements along the storage direction  //
+//  of the MX operand (byRow for RowMajor, byColumn for ColMajor), the //
+//  arrangement MX_Matrix::get_exp reads, which needs ld % r == 0.     //
+//---------------------------------------------------------------------
+template<typename MatrixX, typename T, typename idx, typename T_scal, Lo_Gemm::Layout L>
+void mx_quantize(const MatrixX& X, Lo_Gemm::MX_Matrix<T, idx, T_scal, L>& Q)
+{
+    assert(Q.ld % Q.r == 0);
+    Lo_Gemm::Matrix<T, idx, L> codes(Q.data, Q.m, Q.n, Q.ld);
+    const Lo_Gemm::MX_tuple blk(L == Lo_Gemm::RowMajor ? Lo_Gemm::byRow : Lo_Gemm::byColumn, static_cast<int>(Q.r));
+    mx_quantize(X, codes, Q.shared_exps, blk, static_cast<std::size_t>(Q.ld / Q.r));
+}
+
+template<typename T, typename idx, typename T_scal, Lo_Gemm::Layout L, typename MatrixX>
+void mx_dequantize(const Lo_Gemm::MX_Matrix<T, idx, T_scal, L>& Q, MatrixX& X)
+{
+    assert(Q.ld % Q.r == 0);
+    const Lo_Gemm::Matrix<T, idx, L> codes(Q.data, Q.m, Q.n, Q.ld);
+    const Lo_Gemm::MX_tuple blk(L == Lo_Gemm::RowMajor ? Lo_Gemm::byRow : Lo_Gemm::byColumn, static_cast<int>(Q.r));
+    mx_dequantize(codes, Q.shared_exps, blk, X, static_cast<std::size_t>(Q.ld / Q.r));
+}
+
+//  vectors : blocks of r1 consecutive elements, exps[i / r1]
+template<typename T_in, typename T, typename idx, typename T_scal>
+void mx_quantize(const Lo_Gemm::Vector<T_in, idx>& x, Lo_Gemm::MX_Vector<T, idx, T_scal>& q)
+{
+    const Lo_Gemm::Matrix<T_in, idx> xm(x.ptr(), 1, x.size(), x.inc());
+    Lo_Gemm::Matrix<T, idx> qm(q.ptr(), 1, q.size(), q.inc());
+    mx_quantize(xm, qm, q.exps(), Lo_Gemm::MX_tuple(Lo_Gemm::byRow, static_cast<int>(q.block_size())));
+}
+
+template<typename T, typename idx, typename T_scal, typename T_out>
+void mx_dequantize(const Lo_Gemm::MX_Vector<T, idx, T_scal>& q, Lo_Gemm::Vector<T_out, idx>& x)
+{
+    const Lo_Gemm::Matrix<T, idx> qm(q.ptr(), 1, q.size(), q.inc());
+    Lo_Gemm::Matrix<T_out, idx> xm(x.ptr(), 1, x.size(), x.inc());
+    mx_dequantize(qm, q.exps(), Lo_Gemm::MX_tuple(Lo_Gemm::byRow, static_cast<int>(q.block_size())), xm);
+}
+
+} // namespace LoGemm
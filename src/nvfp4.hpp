@@ -0,0 +1,243 @@
+///@author Sudhanva Kulkarni
+/// NVFP4 : two level scaled fp4,
+///     x ≈ t · s_b · q,    q float4_e2m1 (|q| ≤ 6), s_b float8_e4m3_fn per block of 16, t one float per tensor
+/// The tensor scale t = amax / (6·448) maps the largest block scale onto the e4m3 range, so the block scales
+/// keep their 3 bit mantissas for the whole dynamic range of the tensor and are not limited to powers of two
+/// as the E8M0 scales of MX are. The price is range : blocks whose amax is below about 2^−15 of the tensor amax
+/// get subnormal e4m3 scales, and below 2^−18 a zero scale.
+/// Lo_Gemm::NVFP4_Matrix stores the codes packed two per byte (element s of the storage order in the low nibble
+/// of byte s/2 when s is even, the high one otherwise) and the scales like MX_Matrix does, one per r = 16
+/// consecutive elements of the storage order, which needs ld % 16 == 0. get_exp returns t·s_b, so the matrix is
+/// an MX format (is_MX_format) and MXGemm multiplies it as it is, a k-block of 16 at a time for a row major A
+/// and a column major B; NVFP4Gemm names that instantiation.
+/// nvfp4_quantize is two passes over X : the tensor amax, then per block of 16 the block amax, the e4m3 scale
+///     s_b = e4m3(amax_b / (6·t))                          rounded to nearest even
+/// and the elements q = e2m1(x / (t·s_b)), clamped to ±6, with the SIMD e2m1 encoder of mx_quantize.hpp and
+/// the block decoded once into a small buffer. Blocks are spread over threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Matrix.h"
+#include "OP_gemm.hpp"
+#include "gemm_helpers.hpp"
+#include "lo_float.h"
+#include "mx_quantize.hpp"
+
+namespace Lo_Gemm {
+
+template<typename idx, Layout L = ColMajor>
+class NVFP4_Matrix {
+    public:
+    using fp4_type = lo_float::float4_e2m1<>;
+    using scale_type = lo_float::float8_e4m3_fn<>;
+
+    idx m;
+    idx n;
+    idx ld;
+    idx r;                  //elements per block scale, 16
+    uint8_t* data;          //packed codes, (storage size + 1)/2 bytes
+    scale_type* scales;     //one per block of r in storage order
+    float tensor_scale;
+    static constexpr Layout layout = L;
+    using scalar_type = fp4_type;
+    using value_type = fp4_type;
+    using index_type = idx;
+    using shared_exp_type = float;
+
+    NVFP4_Matrix(uint8_t* data, scale_type* scales, idx m, idx n, idx ld, float tensor_scale = 1.0f, idx r = static_cast<idx>(16))
+        : m(m), n(n), ld(ld), r(r), data(data), scales(scales), tensor_scale(tensor_scale) {}
+
+    //bytes of packed codes and number of block scales for an m×n matrix with leading dimension ld
+    static constexpr std::size_t code_bytes(idx m, idx n, idx ld) {
+        const std::size_t lines = L == ColMajor ? n : m, len = L == ColMajor ? m : n;
+        return lines == 0 ? 0 : ((lines - 1)*ld + len + 1)/2;
+    }
+    static constexpr std::size_t scale_count(idx m, idx n, idx ld, idx r = static_cast<idx>(16)) {
+        const std::size_t lines = L == ColMajor ? n : m, len = L == ColMajor ? m : n;
+        return lines == 0 ? 0 : ((lines - 1)*ld + len + r - 1)/r;
+    }
+
+    constexpr inline idx get_idx(idx row, idx col) const {
+        if constexpr (L == ColMajor) return col*ld + row;
+        else return row*ld + col;
+    }
+
+    constexpr inline uint8_t code(idx row, idx col) const {
+        const idx s = get_idx(row, col);
+        return (s & 1) ? static_cast<uint8_t>(data[s/2] >> 4) : static_cast<uint8_t>(data[s/2] & 0x0F);
+    }
+
+    constexpr inline void set_code(idx row, idx col, uint8_t c) const {
+        const idx s = get_idx(row, col);
+        data[s/2] = (s & 1) ? static_cast<uint8_t>((data[s/2] & 0x0F) | (c << 4)) : static_cast<uint8_t>((data[s/2] & 0xF0) | (c & 0x0F));
+    }
+
+    //the fp4 element, unscaled (by value, the codes are packed)
+    constexpr inline value_type operator()(idx row, idx col) const {
+        return value_type::FromRep(code(row, col));
+    }
+
+    //t·s_b of the block of (row, col)
+    constexpr inline float get_exp(idx row, idx col) const {
+        return tensor_scale * static_cast<float>(scales[get_idx(row, col)/r]);
+    }
+
+    template<typename V = float>
+    constexpr inline V scaled_val(idx row, idx col) const {
+        return static_cast<V>(operator()(row, col)) * static_cast<V>(get_exp(row, col));
+    }
+
+    constexpr inline idx rows() const {
+        return this->m;
+    }
+
+    constexpr inline idx cols() const {
+        return this->n;
+    }
+};
+
+template<typename idx, Layout L>
+struct is_MX_format<NVFP4_Matrix<idx, L>> {
+    static constexpr bool value = true;
+};
+
+} //namespace Lo_Gemm
+
+
+namespace LoGemm {
+
+//  block-scaled GEMM on NVFP4 operands, row major A / column major B for 16-long k-blocks
+template<typename MatrixC, typename Accum1 = void, typename Accum2 = void, typename idx = int>
+using NVFP4Gemm = MXGemm<Lo_Gemm::NVFP4_Matrix<idx, Lo_Gemm::RowMajor>, Lo_Gemm::NVFP4_Matrix<idx, Lo_Gemm::ColMajor>,
+                         MatrixC, Accum1, Accum2>;
+
+namespace nvfp4_internal {
+
+inline constexpr float fp4_max = 6.0f;
+inline constexpr float scale_max = 448.0f;
+
+//  the storage lines of an NVFP4 matrix and element p of line l as (row, col)
+template<Lo_Gemm::Layout L>
+inline void line_coords(std::size_t l, std::size_t p, std::size_t& i, std::size_t& j) noexcept
+{
+    if constexpr (L == Lo_Gemm::ColMajor) { i = p; j = l; }
+    else { i = l; j = p; }
+}
+
+} // namespace nvfp4_internal
+
+//---------------------------------------------------------------------
+//  Q ← NVFP4 quantization of X (any Lo_Gemm::Matrix of the same      //
+//  shape). Sets Q.tensor_scale, the block scales and the codes.      //
+//---------------------------------------------------------------------
+template<typename MatrixX, typename idx, Lo_Gemm::Layout L>
+void nvfp4_quantize(const MatrixX& X, Lo_Gemm::NVFP4_Matrix<idx, L>& Q)
+{
+    using namespace nvfp4_internal;
+    using NV = Lo_Gemm::NVFP4_Matrix<idx, L>;
+    using fp4 = typename NV::fp4_type;
+    using e4m3 = typename NV::scale_type;
+    assert(Q.ld % Q.r == 0 && Q.r % 2 == 0);
+
+    const std::size_t lines = L == Lo_Gemm::ColMajor ? Q.n : Q.m;
+    const std::size_t len = L == Lo_Gemm::ColMajor ? Q.m : Q.n;
+    const std::size_t r = static_cast<std::size_t>(Q.r);
+    const std::size_t per_line = (len + r - 1) / r;
+    if (lines == 0 || len == 0) return;
+
+    const auto* xd = X.data;
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+    //  step of X along a storage line of Q
+    const std::ptrdiff_t xinc = L == Lo_Gemm::ColMajor ? xrs : xcs;
+    const std::ptrdiff_t xline = L == Lo_Gemm::ColMajor ? xcs : xrs;
+
+    //  pass 1 : tensor amax
+    float amax = 0.0f;
+    #pragma omp parallel
+    {
+        std::vector<float> buf(len);
+        float local = 0.0f;
+        #pragma omp for schedule(static)
+        for (std::size_t l = 0; l < lines; ++l) {
+            decode_n(xd + static_cast<std::ptrdiff_t>(l)*xline, xinc, buf.data(), len);
+            local = std::max(local, mx_internal::block_amax(buf.data(), len));
+        }
+        #pragma omp critical
+        amax = std::max(amax, local);
+    }
+    const float t = amax > 0.0f && std::isfinite(amax) ? amax / (fp4_max * scale_max) : 1.0f;
+    Q.tensor_scale = t;
+
+    //  pass 2 : block amax, e4m3 scale, e2m1 codes
+    const auto& enc = mx_internal::encoder<fp4>();
+    #pragma omp parallel
+    {
+        std::vector<float> buf(r);
+        std::vector<uint8_t> codes(r);
+
+        #pragma omp for schedule(static)
+        for (std::size_t b = 0; b < lines*per_line; ++b) {
+            const std::size_t l = b / per_line, p0 = (b % per_line)*r;
+            const std::size_t c = std::min(r, len - p0);
+            decode_n(xd + static_cast<std::ptrdiff_t>(l)*xline + static_cast<std::ptrdiff_t>(p0)*xinc, xinc, buf.data(), c);
+
+            const float bmax = mx_internal::block_amax(buf.data(), c);
+            const e4m3 sb = e4m3(std::min(bmax / (fp4_max * t), scale_max));
+            const float sbf = static_cast<float>(sb);
+            const std::size_t s0 = l*static_cast<std::size_t>(Q.ld) + p0;
+            Q.scales[s0 / r] = sb;
+
+            const float inv = sbf > 0.0f ? 1.0f / (sbf * t) : 0.0f;
+            if (enc.ok) {
+                mx_internal::encode_block(enc, buf.data(), inv, codes.data(), c);
+            } else {
+                for (std::size_t q = 0; q < c; ++q)
+                    codes[q] = code_of(lo_cast<fp4>(std::clamp(buf[q] * inv, -fp4_max, fp4_max)));
+            }
+            for (std::size_t q = c; q < r; ++q) codes[q] = 0;
+
+            //  s0 is even (r even, ld % r == 0), so the block packs into whole bytes
+            uint8_t* dst = Q.data + s0/2;
+            for (std::size_t q = 0; q + 1 < c; q += 2)
+                dst[q/2] = static_cast<uint8_t>((codes[q] & 0x0F) | (codes[q+1] << 4));
+            if (c & 1) dst[c/2] = static_cast<uint8_t>((dst[c/2] & 0xF0) | (codes[c-1] & 0x0F));
+        }
+    }
+}
+
+//  X ← t·s_b·q, rounded into the format of X
+template<typename idx, Lo_Gemm::Layout L, typename MatrixX>
+void nvfp4_dequantize(const Lo_Gemm::NVFP4_Matrix<idx, L>& Q, MatrixX& X)
+{
+    using NV = Lo_Gemm::NVFP4_Matrix<idx, L>;
+    using T_x = typename MatrixX::value_type;
+    const float* lut = decode_table<typename NV::fp4_type>();
+
+    const std::size_t lines = L == Lo_Gemm::ColMajor ? Q.n : Q.m;
+    const std::size_t len = L == Lo_Gemm::ColMajor ? Q.m : Q.n;
+    const std::size_t r = static_cast<std::size_t>(Q.r);
+    const std::size_t per_line = (len + r - 1) / r;
+
+    #pragma omp parallel for schedule(static)
+    for (std::size_t b = 0; b < lines*per_line; ++b) {
+        const std::size_t l = b / per_line, p0 = (b % per_line)*r;
+        const std::size_t c = std::min(r, len - p0);
+        const std::size_t s0 = l*static_cast<std::size_t>(Q.ld) + p0;
+        const float s = Q.tensor_scale * static_cast<float>(Q.scales[s0 / r]);
+        for (std::size_t q = 0; q < c; ++q) {
+            const std::size_t st = s0 + q;
+            const uint8_t code = (st & 1) ? static_cast<uint8_t>(Q.data[st/2] >> 4) : static_cast<uint8_t>(Q.data[st/2] & 0x0F);
+            std::size_t i, j;
+            nvfp4_internal::line_coords<L>(l, p0 + q, i, j);
+            X(static_cast<typename MatrixX::index_type>(i), static_cast<typename MatrixX::index_type>(j)) = lo_cast<T_x>(lut[code] * s);
+        }
+    }
+}
+
+} // namespace LoGemm
@@ -0,0 +1,169 @@
+///@author Sudhanva Kulkarni
+/// Emulated high precision GEMM (Ozaki scheme) : C ← epi(op(A)·op(B)) for float / double operands, computed from
+/// products of low precision slices.
+/// Every row of op(A) is scaled by a power of two μ_i so its entries lie in (−1, 1) and is split error free into
+/// S slices of β = Slice::mantissa_bits + 1 bits each,
+///     a_ip = μ_i · Σ_s 2^(−β·s) · q^s_ip,     q^s integers with |q^s| ≤ 2^β,
+/// and the columns of op(B) likewise with ν_j. Such integers are exact in Slice, so every slice product
+/// A^s·B^t runs through the regular Gemm on Slice inputs, and as long as k·2^(2β) fits in the significand of
+/// Accum the integer dot products are accumulated exactly (longer K is cut into chunks that do). Products of
+/// the same level l = s + t are summed exactly in double, and the levels are combined from the smallest up :
+///     C_ij = μ_i ν_j Σ_l 2^(−β·l) Σ_{s+t=l} (A^s·B^t)_ij
+/// With triangular() (the default) only levels l ≤ S + 1 are formed, S(S+1)/2 products, which drops terms
+/// below the 2^(−β·S) accuracy the slices carry anyway. slices_for(bits) gives the S for a target accuracy :
+/// fp8 e4m3 slices need 7 for fp32 and 15 for fp64 accuracy, relative to the largest entry of each row and
+/// column.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Matrix.h"
+#include "gemm_epilogue.hpp"
+#include "gemms.hpp"
+#include "lo_float.h"
+
+namespace LoGemm {
+
+template<typename Slice = lo_float::float8_e4m3_fn<>, typename Accum = float>
+class OzakiGemm {
+    using SliceMatrix = Lo_Gemm::Matrix<Slice, int>;
+    using LevelMatrix = Lo_Gemm::Matrix<double, int>;
+    using GemmT       = Gemm<SliceMatrix, SliceMatrix, LevelMatrix, Accum, Accum>;
+
+public:
+    //  bits per slice, and the longest K whose slice products Accum holds exactly
+    static constexpr int bits = Slice::mantissa_bits + 1;
+    static_assert(2*bits < std::numeric_limits<Accum>::digits, "slice products do not fit the accumulator exactly");
+    static constexpr std::size_t k_exact = std::size_t{1} << (std::numeric_limits<Accum>::digits - 2*bits);
+
+    //  slices needed for a relative accuracy of 2^(−target_bits)
+    static constexpr int slices_for(int target_bits) noexcept { return (target_bits + bits - 1) / bits + 1; }
+
+private:
+    int S_ = slices_for(std::numeric_limits<double>::digits);
+    bool triangular_ = true;
+    GemmT gemm_;
+
+    std::vector<Slice> As_, Bs_;        // S slices of op(A) (m×k) and op(B) (k×n), column major
+    std::vector<int> mu_, nu_;          // row exponents of op(A), column exponents of op(B)
+    std::vector<double> D_;             // one level, m×n column major
+    std::vector<double> W_;             // the result, m×n row major
+
+    //  q^s of every element of one line (a row of op(A) or a column of op(B)) of length k
+    template<typename Get>
+    void split_line(Get get, std::size_t k, int& e, Slice* out, std::size_t inc, std::size_t slice_stride) const
+    {
+        double amax = 0.0;
+        for (std::size_t p = 0; p < k; ++p) amax = std::max(amax, std::abs(get(p)));
+        e = 0;
+        if (amax != 0.0) std::frexp(amax, &e);          // amax < 2^e
+
+        for (std::size_t p = 0; p < k; ++p) {
+            double r = std::ldexp(get(p), -e);
+            for (int s = 1; s <= S_; ++s) {
+                const double q = std::rint(std::ldexp(r, bits*s));
+                r -= std::ldexp(q, -bits*s);
+                out[(s-1)*slice_stride + p*inc] = lo_cast<Slice>(static_cast<float>(q));
+            }
+        }
+    }
+
+public:
+    OzakiGemm() = default;
+    explicit OzakiGemm(int slices) { set_slices(slices); }
+
+    int slices() const noexcept { return S_; }
+    void set_slices(int s) noexcept { S_ = std::max(s, 1); }
+
+    bool triangular() const noexcept { return triangular_; }
+    void set_triangular(bool t) noexcept { triangular_ = t; }
+
+    //  number of slice products one run performs (per K chunk)
+    int products() const noexcept { return triangular_ ? S_*(S_ + 1)/2 : S_*S_; }
+
+    //  the Gemm the slice products run through, to pin its kernel or blocking
+    GemmT& gemm() noexcept { return gemm_; }
+
+    template<typename MatrixA, typename MatrixB, typename MatrixC>
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        epilogue_for_t<double, typename MatrixC::value_type> epi;
+        run(C, A, B, epi, opA, opB);
+    }
+
+    template<typename MatrixA, typename MatrixB, typename MatrixC, typename Epi>
+    void run(MatrixC& C, const MatrixA& A, const MatrixB& B, Epi& epi,
+             Lo_Gemm::Op opA = Lo_Gemm::NoTrans, Lo_Gemm::Op opB = Lo_Gemm::NoTrans)
+    {
+        using ia = typename MatrixA::index_type;
+        using ib = typename MatrixB::index_type;
+        const std::size_t m = opA == Lo_Gemm::NoTrans ? A.rows() : A.cols();
+        const std::size_t k = opA == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+        const std::size_t n = opB == Lo_Gemm::NoTrans ? B.cols() : B.rows();
+        if (m == 0 || n == 0) return;
+
+        const std::size_t S = static_cast<std::size_t>(S_);
+        As_.resize(std::max<std::size_t>(S*m*k, 1));
+        Bs_.resize(std::max<std::size_t>(S*k*n, 1));
+        mu_.resize(m);
+        nu_.resize(n);
+        D_.resize(m*n);
+        W_.assign(m*n, 0.0);
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < m; ++i) {
+            auto get = [&](std::size_t p) {
+                return opA == Lo_Gemm::NoTrans ? lo_cast<double>(A(static_cast<ia>(i), static_cast<ia>(p)))
+                                               : lo_cast<double>(A(static_cast<ia>(p), static_cast<ia>(i)));
+            };
+            split_line(get, k, mu_[i], As_.data() + i, m, m*k);
+        }
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < n; ++j) {
+            auto get = [&](std::size_t p) {
+                return opB == Lo_Gemm::NoTrans ? lo_cast<double>(B(static_cast<ib>(p), static_cast<ib>(j)))
+                                               : lo_cast<double>(B(static_cast<ib>(j), static_cast<ib>(p)));
+            };
+            split_line(get, k, nu_[j], Bs_.data() + j*k, 1, k*n);
+        }
+
+        //  D += A^s·B^t, exact : integer tiles below 2^digits(Accum) added in double
+        epilogue_for_t<typename GemmT::accum2_type, double> add;
+        add.beta = 1;
+        LevelMatrix D(D_.data(), static_cast<int>(m), static_cast<int>(n), static_cast<int>(m));
+
+        const std::size_t top = triangular_ ? S + 1 : 2*S;
+        for (std::size_t l = top; l >= 2; --l) {
+            std::fill(D_.begin(), D_.end(), 0.0);
+            for (std::size_t s = l > S ? l - S : 1; s <= std::min(S, l - 1); ++s) {
+                const std::size_t t = l - s;
+                for (std::size_t p0 = 0; p0 < k; p0 += k_exact) {
+                    const std::size_t kc = std::min(k_exact, k - p0);
+                    SliceMatrix As(As_.data() + (s-1)*m*k + p0*m, static_cast<int>(m), static_cast<int>(kc), static_cast<int>(m));
+                    SliceMatrix Bt(Bs_.data() + (t-1)*k*n + p0, static_cast<int>(kc), static_cast<int>(n), static_cast<int>(k));
+                    gemm_.run(D, As, Bt, add);
+                }
+            }
+
+            const int shift = -bits*static_cast<int>(l);
+            #pragma omp parallel for schedule(static)
+            for (std::size_t i = 0; i < m; ++i)
+                for (std::size_t j = 0; j < n; ++j)
+                    W_[i*n + j] += std::ldexp(D_[i + j*m], shift);
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < m; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                W_[i*n + j] = std::ldexp(W_[i*n + j], mu_[i] + nu_[j]);
+
+        epi.apply(W_.data(), n, 0, 0, m, n, C);
+    }
+};
+
+} // namespace LoGemm
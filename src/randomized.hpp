@@ -0,0 +1,345 @@
+///@author Sudhanva Kulkarni
+/// Randomized low rank approximation (Halko, Martinsson, Tropp) with low precision sketches :
+///     range_finder : Q (m×l, orthonormal) with range(Q) ≈ range(A), from Y = A·Ω and q power iterations
+///     svd          : A ≈ U·diag(S)·Vᵀ of rank r, from B = Qᵀ·A
+///     nystrom      : A ≈ U·diag(λ)·Uᵀ of rank r for symmetric positive semidefinite A
+/// with l = r + oversample. Every product with A (A·Ω, Aᵀ·Q, A·Q) runs through Gemm on Sketch inputs with the
+/// Accum1 / Accum2 policy and writes double : A is rounded into Sketch once, and each thin factor it is
+/// multiplied with is scaled by a power of two to the top of the Sketch range before it is rounded, the scale
+/// being undone through the epilogue's alpha. The QR factorizations and SVDs of the thin factors run in double
+/// (geqrf, one-sided Jacobi).
+/// Factors are returned column major in std::vector<double>. The Gaussian test matrix is generated column by
+/// column from seed, so results do not depend on the number of threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "Matrix.h"
+#include "blas3.hpp"
+#include "factorizations.hpp"
+#include "gemms.hpp"
+#include "lo_float.h"
+
+namespace LoGemm {
+
+struct SketchOptions {
+    std::size_t oversample = 10;
+    int power_iters = 1;
+    std::uint64_t seed = 0;
+    double theta = 0.5;             // fraction of the largest Sketch value scaled operands may reach
+    double cut = 0.0;               // Nyström : core eigenvalues below cut·largest are dropped, 0 : u/√n, u of Sketch
+};
+
+namespace sketch_internal {
+
+using DMatrix = Lo_Gemm::Matrix<double, int>;
+
+//  X (m×l) ← Q of its thin QR, in double
+inline void orthonormalize(std::vector<double>& X, std::size_t m, std::size_t l)
+{
+    DMatrix Xm(X.data(), static_cast<int>(m), static_cast<int>(l), static_cast<int>(m));
+    std::vector<double> tau;
+    geqrf<double>(Xm, tau);
+
+    //  Q = H_0···H_{l−1}·I(:, 0:l), reflectors applied from the last one
+    std::vector<double> Q(m*l, 0.0);
+    for (std::size_t c = 0; c < l; ++c) Q[c + c*m] = 1.0;
+    for (std::size_t c = l; c-- > 0;) {
+        const double t = tau[c];
+        if (t == 0.0) continue;
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = c; j < l; ++j) {
+            double w = Q[c + j*m];
+            for (std::size_t r = c + 1; r < m; ++r) w += X[r + c*m] * Q[r + j*m];
+            w *= t;
+            Q[c + j*m] -= w;
+            for (std::size_t r = c + 1; r < m; ++r) Q[r + j*m] -= w * X[r + c*m];
+        }
+    }
+    X.swap(Q);
+}
+
+//  One-sided Jacobi on X (m×l) : X ← X·V with orthogonal columns, V (l×l) orthogonal.
+//  On return sigma holds the column norms in decreasing order, X the normalized columns and V the
+//  rotations, all permuted alike, so X_in = X·diag(sigma)·Vᵀ.
+inline void jacobi_svd(std::vector<double>& X, std::size_t m, std::size_t l,
+                       std::vector<double>& V, std::vector<double>& sigma)
+{
+    V.assign(l*l, 0.0);
+    for (std::size_t c = 0; c < l; ++c) V[c + c*l] = 1.0;
+    const double tol = std::numeric_limits<double>::epsilon() * std::sqrt(static_cast<double>(m));
+
+    for (int sweep = 0; sweep < 60; ++sweep) {
+        bool rotated = false;
+        for (std::size_t p = 0; p + 1 < l; ++p)
+            for (std::size_t q = p + 1; q < l; ++q) {
+                double* xp = &X[p*m];
+                double* xq = &X[q*m];
+                double a = 0.0, b = 0.0, g = 0.0;
+                for (std::size_t r = 0; r < m; ++r) { a += xp[r]*xp[r]; b += xq[r]*xq[r]; g += xp[r]*xq[r]; }
+                if (std::abs(g) <= tol * std::sqrt(a*b)) continue;
+                rotated = true;
+
+                const double zeta = (b - a) / (2.0*g);
+                const double t = std::copysign(1.0, zeta) / (std::abs(zeta) + std::sqrt(1.0 + zeta*zeta));
+                const double c = 1.0 / std::sqrt(1.0 + t*t), s = c*t;
+                for (std::size_t r = 0; r < m; ++r) {
+                    const double u = xp[r], v = xq[r];
+                    xp[r] = c*u - s*v;
+                    xq[r] = s*u + c*v;
+                }
+                for (std::size_t r = 0; r < l; ++r) {
+                    const double u = V[r + p*l], v = V[r + q*l];
+                    V[r + p*l] = c*u - s*v;
+                    V[r + q*l] = s*u + c*v;
+                }
+            }
+        if (!rotated) break;
+    }
+
+    std::vector<double> norm(l);
+    for (std::size_t c = 0; c < l; ++c) {
+        double s = 0.0;
+        for (std::size_t r = 0; r < m; ++r) s += X[r + c*m]*X[r + c*m];
+        norm[c] = std::sqrt(s);
+    }
+    std::vector<std::size_t> order(l);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) { return norm[x] > norm[y]; });
+
+    std::vector<double> Xs(m*l), Vs(l*l);
+    sigma.resize(l);
+    for (std::size_t c = 0; c < l; ++c) {
+        const std::size_t o = order[c];
+        sigma[c] = norm[o];
+        const double inv = norm[o] > 0.0 ? 1.0 / norm[o] : 0.0;
+        for (std::size_t r = 0; r < m; ++r) Xs[r + c*m] = X[r + o*m] * inv;
+        std::copy_n(&V[o*l], l, &Vs[c*l]);
+    }
+    X.swap(Xs);
+    V.swap(Vs);
+}
+
+} // namespace sketch_internal
+
+
+template<typename Sketch = lo_float::float8_e4m3_fn<>, typename Accum1 = void, typename Accum2 = void>
+class RandomizedSketch {
+    using SMatrix = Lo_Gemm::Matrix<Sketch, int>;
+    using DMatrix = sketch_internal::DMatrix;
+    using GemmT   = Gemm<SMatrix, SMatrix, DMatrix, Accum1, Accum2>;
+    using Epi     = epilogue_for_t<typename GemmT::accum2_type, double>;
+
+    SketchOptions opt_;
+    GemmT gemm_;
+
+    std::vector<Sketch> As_, Xs_;   // A and the current thin factor, rounded
+    int a_exp_ = 0;                 // As_ holds 2^a_exp_·A
+    std::size_t m_ = 0, n_ = 0;
+
+    //  exponent e with max|x|·2^e at most theta·max of Sketch; native formats are not scaled
+    int scale_exp(double amax) const
+    {
+        if constexpr (!is_lo_float_v<Sketch>) return 0;
+        if (amax == 0.0) return 0;
+        const double fmax = static_cast<double>(std::numeric_limits<Sketch>::max());
+        return static_cast<int>(std::floor(std::log2(opt_.theta) + std::log2(fmax) - std::log2(amax)));
+    }
+
+    template<typename MatrixA>
+    void load(const MatrixA& A)
+    {
+        using idx = typename MatrixA::index_type;
+        m_ = A.rows();
+        n_ = A.cols();
+        double amax = 0.0;
+        for (std::size_t j = 0; j < n_; ++j)
+            for (std::size_t i = 0; i < m_; ++i)
+                amax = std::max(amax, std::abs(lo_cast<double>(A(static_cast<idx>(i), static_cast<idx>(j)))));
+        a_exp_ = scale_exp(amax);
+
+        As_.resize(std::max<std::size_t>(m_*n_, 1));
+        #pragma omp parallel for schedule(static)
+        for (std::size_t j = 0; j < n_; ++j)
+            for (std::size_t i = 0; i < m_; ++i)
+                As_[i + j*m_] = lo_cast<Sketch>(std::ldexp(lo_cast<double>(A(static_cast<idx>(i), static_cast<idx>(j))), a_exp_));
+    }
+
+    //  Y (rows×l) ← op(A)·X for X (inner×l) in double
+    void product(Lo_Gemm::Op op, const std::vector<double>& X, std::size_t l, std::vector<double>& Y)
+    {
+        const std::size_t rows = op == Lo_Gemm::NoTrans ? m_ : n_;
+        const std::size_t inner = op == Lo_Gemm::NoTrans ? n_ : m_;
+
+        double xmax = 0.0;
+        for (std::size_t i = 0; i < inner*l; ++i) xmax = std::max(xmax, std::abs(X[i]));
+        const int x_exp = scale_exp(xmax);
+        Xs_.resize(std::max<std::size_t>(inner*l, 1));
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < inner*l; ++i) Xs_[i] = lo_cast<Sketch>(std::ldexp(X[i], x_exp));
+
+        Y.assign(rows*l, 0.0);
+        const SMatrix Am(As_.data(), static_cast<int>(m_), static_cast<int>(n_), static_cast<int>(m_));
+        const SMatrix Xm(Xs_.data(), static_cast<int>(inner), static_cast<int>(l), static_cast<int>(inner));
+        DMatrix Ym(Y.data(), static_cast<int>(rows), static_cast<int>(l), static_cast<int>(rows));
+        Epi epi;
+        epi.alpha = std::ldexp(1.0, -a_exp_ - x_exp);
+        epi.beta = 0;
+        gemm_.run(Ym, Am, Xm, epi, op, Lo_Gemm::NoTrans);
+    }
+
+    //  cols×l standard Gaussian, column c drawn from its own stream
+    void gaussian(std::size_t cols, std::size_t l, std::vector<double>& G) const
+    {
+        G.resize(cols*l);
+        #pragma omp parallel for schedule(static)
+        for (std::size_t c = 0; c < l; ++c) {
+            std::mt19937_64 gen(opt_.seed * 0x9E3779B97F4A7C15ull + c);
+            std::normal_distribution<double> dist;
+            for (std::size_t r = 0; r < cols; ++r) G[r + c*cols] = dist(gen);
+        }
+    }
+
+    //  range finder on the loaded A
+    void range(std::size_t l, std::vector<double>& Q)
+    {
+        using sketch_internal::orthonormalize;
+        std::vector<double> Om, Z;
+        gaussian(n_, l, Om);
+        product(Lo_Gemm::NoTrans, Om, l, Q);
+        for (int it = 0; it < opt_.power_iters; ++it) {
+            orthonormalize(Q, m_, l);
+            product(Lo_Gemm::Trans, Q, l, Z);
+            orthonormalize(Z, n_, l);
+            product(Lo_Gemm::NoTrans, Z, l, Q);
+        }
+        orthonormalize(Q, m_, l);
+    }
+
+    static double unit_roundoff()
+    {
+        if constexpr (is_lo_float_v<Sketch>) return std::ldexp(1.0, -(Sketch::mantissa_bits + 1));
+        else return static_cast<double>(std::numeric_limits<Sketch>::epsilon()) / 2;
+    }
+
+    std::size_t sketch_size(std::size_t rank, std::size_t lmax) const
+    {
+        return std::min(rank + opt_.oversample, lmax);
+    }
+
+public:
+    RandomizedSketch() = default;
+    explicit RandomizedSketch(const SketchOptions& opt) : opt_(opt) {}
+
+    const SketchOptions& options() const noexcept { return opt_; }
+    void set_options(const SketchOptions& opt) noexcept { opt_ = opt; }
+
+    //  the Gemm the sketch products run through, to pin its kernel or blocking
+    GemmT& gemm() noexcept { return gemm_; }
+
+    //  Q (m×l) with orthonormal columns, l = min(rank + oversample, m, n); returns l
+    template<typename MatrixA>
+    std::size_t range_finder(const MatrixA& A, std::size_t rank, std::vector<double>& Q)
+    {
+        load(A);
+        const std::size_t l = sketch_size(rank, std::min(m_, n_));
+        range(l, Q);
+        return l;
+    }
+
+    //  A ≈ U·diag(S)·Vᵀ, U m×r, V n×r, r = min(rank, m, n); returns r
+    template<typename MatrixA>
+    std::size_t svd(const MatrixA& A, std::size_t rank, std::vector<double>& U, std::vector<double>& S,
+                    std::vector<double>& V)
+    {
+        load(A);
+        const std::size_t l = sketch_size(rank, std::min(m_, n_));
+        const std::size_t r = std::min(rank, l);
+        std::vector<double> Q, Bt, W;
+        range(l, Q);
+
+        //  Bᵀ = Aᵀ·Q (n×l) = V'·Σ·Wᵀ, so A ≈ Q·B = (Q·W)·Σ·V'ᵀ
+        product(Lo_Gemm::Trans, Q, l, Bt);
+        sketch_internal::jacobi_svd(Bt, n_, l, W, S);
+
+        U.assign(m_*r, 0.0);
+        DMatrix Qm(Q.data(), static_cast<int>(m_), static_cast<int>(l), static_cast<int>(m_));
+        DMatrix Wm(W.data(), static_cast<int>(l), static_cast<int>(r), static_cast<int>(l));
+        DMatrix Um(U.data(), static_cast<int>(m_), static_cast<int>(r), static_cast<int>(m_));
+        Gemm<DMatrix, DMatrix, DMatrix>().run(Um, Qm, Wm);
+
+        S.resize(r);
+        Bt.resize(n_*r);
+        V.swap(Bt);
+        return r;
+    }
+
+    //  A ≈ U·diag(lambda)·Uᵀ for symmetric positive semidefinite A (n×n), U n×r; returns r
+    template<typename MatrixA>
+    std::size_t nystrom(const MatrixA& A, std::size_t rank, std::vector<double>& U, std::vector<double>& lambda)
+    {
+        using sketch_internal::orthonormalize;
+        load(A);
+        const std::size_t n = n_;
+        const std::size_t l = sketch_size(rank, n);
+        const std::size_t r = std::min(rank, l);
+
+        std::vector<double> Om, Y, M(l*l), Vl;
+        gaussian(n, l, Om);
+        orthonormalize(Om, n, l);
+        product(Lo_Gemm::NoTrans, Om, l, Y);
+
+        //  core M = Ωᵀ·Y, symmetrized, = W·diag(μ)·Wᵀ. A shift ν·I as in exact arithmetic Nyström would have
+        //  to cover the rounding of the sketch and then biases every eigenvalue; eigenvalues of M below that
+        //  level (negative ones included) are dropped instead, and A ≈ (Y·W_k·μ_k^(−1/2))·(…)ᵀ = B·Bᵀ.
+        DMatrix Omm(Om.data(), static_cast<int>(n), static_cast<int>(l), static_cast<int>(n));
+        DMatrix Ym(Y.data(), static_cast<int>(n), static_cast<int>(l), static_cast<int>(n));
+        DMatrix Mm(M.data(), static_cast<int>(l), static_cast<int>(l), static_cast<int>(l));
+        epilogue_for_t<double, double> overwrite;
+        overwrite.beta = 0;
+        Gemm<DMatrix, DMatrix, DMatrix>().run(Mm, Omm, Ym, overwrite, Lo_Gemm::Trans, Lo_Gemm::NoTrans);
+        for (std::size_t j = 0; j < l; ++j)
+            for (std::size_t i = j + 1; i < l; ++i)
+                M[i + j*l] = M[j + i*l] = 0.5 * (M[i + j*l] + M[j + i*l]);
+
+        //  M = X·diag(σ)·Vᵀ with σ = |μ|, so the sign is recovered from the Rayleigh quotient
+        //  μ_c = v_cᵀ·M·v_c = σ_c·(x_c·v_c). Kept columns of V are packed to the front, scaled by μ^(−1/2).
+        //  Rounding errors of the n term products mostly cancel, hence u/√n.
+        std::vector<double> mu;
+        sketch_internal::jacobi_svd(M, l, l, Vl, mu);
+        const double rel = opt_.cut > 0.0 ? opt_.cut : unit_roundoff() / std::sqrt(static_cast<double>(n));
+        const double cut = rel * mu[0];
+        std::size_t k = 0;
+        for (std::size_t c = 0; c < l; ++c) {
+            double d = 0.0;
+            for (std::size_t i = 0; i < l; ++i) d += M[i + c*l] * Vl[i + c*l];
+            const double ev = mu[c] * d;
+            if (ev <= cut) continue;
+            const double s = 1.0 / std::sqrt(ev);
+            for (std::size_t i = 0; i < l; ++i) Vl[i + k*l] = Vl[i + c*l] * s;
+            ++k;
+        }
+
+        std::vector<double> B(n*std::max<std::size_t>(k, 1), 0.0), Wk;
+        DMatrix Vm(Vl.data(), static_cast<int>(l), static_cast<int>(k), static_cast<int>(l));
+        DMatrix Bm(B.data(), static_cast<int>(n), static_cast<int>(k), static_cast<int>(n));
+        Gemm<DMatrix, DMatrix, DMatrix>().run(Bm, Ym, Vm);
+
+        //  B = U·Σ·Vᵀ, λ = σ²
+        sketch_internal::jacobi_svd(B, n, k, Wk, lambda);
+        lambda.resize(r, 0.0);
+        for (double& s : lambda) s *= s;
+        B.resize(n*r, 0.0);
+        U.swap(B);
+        return r;
+    }
+};
+
+} // namespace LoGemm
@@ -0,0 +1,290 @@
+///@author Sudhanva Kulkarni
+/// Scaled quantization into a narrow float, as fp8 training recipes do it :
+///     x ≈ s_c · q,    q in T, one float scale s_c per tensor, row or column (Lo_Gemm::Scale_Granularity)
+/// with delayed scaling : the scales of a step come from the amaxes recorded at the steps before it,
+///     s_c = 2^margin · max(amax history of channel c) / maxval_T
+/// so that quantizing is one pass over X that scales, rounds (to nearest even, saturating at ±maxval_T) and
+/// records the amax of the step at the same time. Only the first step of a history, with nothing recorded yet,
+/// reads X twice (its amax first, as current scaling would).
+/// DelayedScaling is the state of one tensor : a ring buffer of the last history_len amaxes of every channel,
+/// and the scales of the last quantization, the ones scaled_dequantize needs. A channel with an all zero history
+/// gets scale 1.
+/// X is read along its contiguous direction, a line at a time into a buffer. When the whole line shares one scale
+/// its amax and codes come from block_amax and the SIMD encoder of mx_quantize.hpp, otherwise (per column scales
+/// of a row major X, per row scales of a column major one) the amax of every channel is kept in a per thread
+/// array and the line is multiplied by the inverse scales before the encoder. Lines are spread over threads.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Matrix.h"
+#include "gemm_helpers.hpp"
+#include "layouts.h"
+#include "mx_quantize.hpp"
+
+namespace LoGemm {
+
+class DelayedScaling {
+    public:
+    Lo_Gemm::Scale_Granularity granularity;
+    std::size_t history_len;
+    int margin;
+
+    DelayedScaling(Lo_Gemm::Scale_Granularity granularity = Lo_Gemm::perTensor, std::size_t history_len = 16, int margin = 0)
+        : granularity(granularity), history_len(std::max<std::size_t>(history_len, 1)), margin(margin) {}
+
+    std::size_t channels() const { return scale_.size(); }
+    std::size_t steps() const { return steps_; }
+
+    //  scales of the last quantization
+    const float* scales() const { return scale_.data(); }
+    float scale(std::size_t c) const { return scale_[c]; }
+
+    //  amax of channel c recorded k steps ago (0 : the last step)
+    float amax(std::size_t c, std::size_t k = 0) const
+    {
+        assert(k < std::min(steps_, history_len));
+        return hist_[((head_ + history_len - 1 - k) % history_len)*channels() + c];
+    }
+
+    //  max of the recorded amaxes of channel c
+    float history_amax(std::size_t c) const
+    {
+        float a = 0.0f;
+        for (std::size_t k = 0; k < std::min(steps_, history_len); ++k) a = std::max(a, hist_[k*channels() + c]);
+        return a;
+    }
+
+    //  one scale per channel, the history is dropped when the number of channels changes
+    void resize(std::size_t channels)
+    {
+        if (channels == scale_.size()) return;
+        scale_.assign(channels, 1.0f);
+        hist_.assign(history_len*channels, 0.0f);
+        head_ = steps_ = 0;
+    }
+
+    void reset()
+    {
+        std::fill(scale_.begin(), scale_.end(), 1.0f);
+        std::fill(hist_.begin(), hist_.end(), 0.0f);
+        head_ = steps_ = 0;
+    }
+
+    //  scales for a format whose largest value is maxval, from the history and the optional amaxes of the
+    //  current step
+    void update_scales(float maxval, const float* current = nullptr)
+    {
+        for (std::size_t c = 0; c < channels(); ++c) {
+            float a = history_amax(c);
+            if (current) a = std::max(a, current[c]);
+            scale_[c] = a > 0.0f && std::isfinite(a) ? std::ldexp(a / maxval, margin) : 1.0f;
+        }
+    }
+
+    //  appends the amaxes of one step, overwriting the oldest once the history is full
+    void record(const float* amax)
+    {
+        std::copy(amax, amax + channels(), hist_.begin() + head_*channels());
+        head_ = (head_ + 1) % history_len;
+        ++steps_;
+    }
+
+    private:
+    std::vector<float> hist_;       // history_len rows of one amax per channel
+    std::vector<float> scale_;
+    std::size_t head_ = 0;          // row of the next step
+    std::size_t steps_ = 0;
+};
+
+namespace scaled_internal {
+
+//  largest magnitude of T with either sign
+template<typename T>
+inline float format_max()
+{
+    if constexpr (has_decode_table_v<T>) {
+        const auto& enc = mx_internal::encoder<T>();
+        if (enc.ok) return enc.maxval;
+    }
+    return Lo_Gemm::mx_element_limit<T>();
+}
+
+//  storage lines of X : rows when X is row major, columns otherwise, and (row, col) of element p of line l
+struct Lines {
+    bool by_rows;
+    std::size_t count, len;
+
+    template<typename MatrixX>
+    explicit Lines(const MatrixX& X)
+        : by_rows(X.col_stride() == 1 && X.row_stride() != 1),
+          count(by_rows ? X.rows() : X.cols()), len(by_rows ? X.cols() : X.rows()) {}
+
+    std::ptrdiff_t offset(std::size_t l, std::size_t p, std::ptrdiff_t rs, std::ptrdiff_t cs) const noexcept
+    {
+        return by_rows ? static_cast<std::ptrdiff_t>(l)*rs + static_cast<std::ptrdiff_t>(p)*cs
+                       : static_cast<std::ptrdiff_t>(p)*rs + static_cast<std::ptrdiff_t>(l)*cs;
+    }
+
+    //  whether every element of a line has the same scale
+    bool uniform(Lo_Gemm::Scale_Granularity g) const noexcept
+    {
+        return g == Lo_Gemm::perTensor || (g == Lo_Gemm::perRow) == by_rows;
+    }
+};
+
+inline std::size_t channel_count(Lo_Gemm::Scale_Granularity g, std::size_t m, std::size_t n) noexcept
+{
+    return g == Lo_Gemm::perTensor ? 1 : (g == Lo_Gemm::perRow ? m : n);
+}
+
+//  amax of every channel of X, for the first step of a history
+template<typename MatrixX>
+void channel_amax(const MatrixX& X, Lo_Gemm::Scale_Granularity g, float* amax)
+{
+    const Lines ln(X);
+    const std::size_t channels = channel_count(g, X.rows(), X.cols());
+    const bool uniform = ln.uniform(g);
+    const std::ptrdiff_t rs = X.row_stride(), cs = X.col_stride();
+    const std::ptrdiff_t step = ln.by_rows ? cs : rs;
+    std::fill(amax, amax + channels, 0.0f);
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(ln.len), la(channels, 0.0f);
+
+        #pragma omp for schedule(static)
+        for (std::size_t l = 0; l < ln.count; ++l) {
+            decode_n(X.data + ln.offset(l, 0, rs, cs), step, buf.data(), ln.len);
+            if (uniform) {
+                const std::size_t c = g == Lo_Gemm::perTensor ? 0 : l;
+                la[c] = std::max(la[c], mx_internal::block_amax(buf.data(), ln.len));
+            } else {
+                for (std::size_t p = 0; p < ln.len; ++p) la[p] = std::max(la[p], std::abs(buf[p]));
+            }
+        }
+        #pragma omp critical
+        for (std::size_t c = 0; c < channels; ++c) amax[c] = std::max(amax[c], la[c]);
+    }
+}
+
+} // namespace scaled_internal
+
+//---------------------------------------------------------------------
+//  Q ← X / s with the scales of st, in one pass that also records the //
+//  amax of every channel of X in st. X and Q are Lo_Gemm::Matrix     //
+//  views of the same shape (any layouts, any input format).           //
+//---------------------------------------------------------------------
+template<typename MatrixX, typename MatrixQ>
+void scaled_quantize(const MatrixX& X, MatrixQ& Q, DelayedScaling& st)
+{
+    using namespace scaled_internal;
+    using T = typename MatrixQ::value_type;
+    const std::size_t m = X.rows(), n = X.cols();
+    const Lo_Gemm::Scale_Granularity g = st.granularity;
+    const std::size_t channels = channel_count(g, m, n);
+    st.resize(channels);
+    const float maxval = format_max<T>();
+
+    std::vector<float> amax(channels, 0.0f);
+    if (st.steps() == 0) {
+        channel_amax(X, g, amax.data());
+        st.update_scales(maxval, amax.data());
+    } else {
+        st.update_scales(maxval);
+    }
+    std::vector<float> inv(channels);
+    for (std::size_t c = 0; c < channels; ++c) inv[c] = 1.0f / st.scale(c);
+    std::fill(amax.begin(), amax.end(), 0.0f);
+
+    const Lines ln(X);
+    const bool uniform = ln.uniform(g);
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+    const std::ptrdiff_t qrs = Q.row_stride(), qcs = Q.col_stride();
+    const std::ptrdiff_t xstep = ln.by_rows ? xcs : xrs, qstep = ln.by_rows ? qcs : qrs;
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(ln.len), la(channels, 0.0f);
+        std::vector<uint8_t> codes(ln.len);
+
+        #pragma omp for schedule(static)
+        for (std::size_t l = 0; l < ln.count; ++l) {
+            float* b = buf.data();
+            decode_n(X.data + ln.offset(l, 0, xrs, xcs), xstep, b, ln.len);
+            float s = 1.0f;
+            if (uniform) {
+                const std::size_t c = g == Lo_Gemm::perTensor ? 0 : l;
+                la[c] = std::max(la[c], mx_internal::block_amax(b, ln.len));
+                s = inv[c];
+            } else {
+                for (std::size_t p = 0; p < ln.len; ++p) {
+                    la[p] = std::max(la[p], std::abs(b[p]));
+                    b[p] *= inv[p];
+                }
+            }
+
+            T* q = Q.data + ln.offset(l, 0, qrs, qcs);
+            bool done = false;
+            if constexpr (has_decode_table_v<T>) {
+                const auto& enc = mx_internal::encoder<T>();
+                if (enc.ok) {
+                    mx_internal::encode_block(enc, b, s, codes.data(), ln.len);
+                    if (qstep == 1) std::memcpy(q, codes.data(), ln.len);
+                    else for (std::size_t p = 0; p < ln.len; ++p) std::memcpy(q + static_cast<std::ptrdiff_t>(p)*qstep, &codes[p], 1);
+                    done = true;
+                }
+            }
+            if (!done)
+                for (std::size_t p = 0; p < ln.len; ++p)
+                    q[static_cast<std::ptrdiff_t>(p)*qstep] = lo_cast<T>(std::clamp(b[p] * s, -maxval, maxval));
+        }
+        #pragma omp critical
+        for (std::size_t c = 0; c < channels; ++c) amax[c] = std::max(amax[c], la[c]);
+    }
+    st.record(amax.data());
+}
+
+//  X ← s_c·q, rounded into the format of X
+template<typename MatrixQ, typename MatrixX>
+void scaled_dequantize(const MatrixQ& Q, const float* scales, Lo_Gemm::Scale_Granularity g, MatrixX& X)
+{
+    using namespace scaled_internal;
+    using T_x = typename MatrixX::value_type;
+    const Lines ln(Q);
+    const bool uniform = ln.uniform(g);
+    const std::ptrdiff_t xrs = X.row_stride(), xcs = X.col_stride();
+    const std::ptrdiff_t qrs = Q.row_stride(), qcs = Q.col_stride();
+    const std::ptrdiff_t xstep = ln.by_rows ? xcs : xrs, qstep = ln.by_rows ? qcs : qrs;
+
+    #pragma omp parallel
+    {
+        std::vector<float> buf(ln.len);
+
+        #pragma omp for schedule(static)
+        for (std::size_t l = 0; l < ln.count; ++l) {
+            decode_n(Q.data + ln.offset(l, 0, qrs, qcs), qstep, buf.data(), ln.len);
+            T_x* x = X.data + ln.offset(l, 0, xrs, xcs);
+            if (uniform) {
+                const float s = scales[g == Lo_Gemm::perTensor ? 0 : l];
+                for (std::size_t p = 0; p < ln.len; ++p) x[static_cast<std::ptrdiff_t>(p)*xstep] = lo_cast<T_x>(buf[p] * s);
+            } else {
+                for (std::size_t p = 0; p < ln.len; ++p) x[static_cast<std::ptrdiff_t>(p)*xstep] = lo_cast<T_x>(buf[p] * scales[p]);
+            }
+        }
+    }
+}
+
+template<typename MatrixQ, typename MatrixX>
+void scaled_dequantize(const MatrixQ& Q, const DelayedScaling& st, MatrixX& X)
+{
+    scaled_dequantize(Q, st.scales(), st.granularity, X);
+}
+
+} // namespace LoGemm
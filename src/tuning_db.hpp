@@ -0,0 +1,204 @@
+///@author Sudhanva Kulkarni
+/// Persistent store of tuned GEMM configurations. Entries are keyed by
+/// (input format, accumulator policy, shape class, thread count) and grouped by CPU model, so one file can be
+/// shared between machines. The database is loaded the first time it is used and Gemm consults it for every
+/// call whose configuration has not been set explicitly.
+///
+/// File format (text, one record per line):
+///     lofloat-gemm-tuning <version>
+///     cpu <model string>
+///     entry <input> <accum> <shape> <threads> <kernel> <MR> <NR> <MC> <KC> <NC> <gflops>
+/// entry lines belong to the closest preceding cpu line. Files with a different version are ignored.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include "cache_info.h"
+#include "gemm_helpers.hpp"
+
+namespace LoGemm {
+
+inline constexpr int tuning_db_version = 1;
+
+struct GemmConfig {
+    std::string kernel = "ref";
+    std::size_t MR = 4;
+    std::size_t NR = 4;
+    std::size_t MC = 0;
+    std::size_t KC = 0;
+    std::size_t NC = 0;
+    double gflops = 0.0;    // measured when tuned
+};
+
+//  short, space free name for an element format
+template<typename T>
+inline std::string format_tag()
+{
+    if constexpr (std::is_void_v<T>)                     return "default";
+    else if constexpr (std::is_same_v<T, float>)         return "f32";
+    else if constexpr (std::is_same_v<T, double>)        return "f64";
+    else if constexpr (is_lo_float_v<T>) {
+        std::ostringstream ss;
+        ss << "lf" << T::bitwidth << "m" << T::mantissa_bits << "b" << T::bias
+           << (T::is_signed == lo_float::Signedness::Signed ? "s" : "u");
+        return ss.str();
+    }
+    else if constexpr (std::is_integral_v<T>) {
+        return (std::is_signed_v<T> ? "i" : "u") + std::to_string(8*sizeof(T));
+    }
+    else return typeid(T).name();
+}
+
+//  shape class : each of m, n, k bucketed as S (<= 64), M (<= 512) or L
+inline char dim_class(std::size_t d) { return d <= 64 ? 'S' : (d <= 512 ? 'M' : 'L'); }
+
+inline std::string shape_class(std::size_t m, std::size_t n, std::size_t k)
+{
+    return std::string{dim_class(m), dim_class(n), dim_class(k)};
+}
+
+inline std::string get_cpu_model()
+{
+#if defined(__linux__)
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("model name", 0) == 0 || line.rfind("Model", 0) == 0) {
+            auto pos = line.find(':');
+            if (pos == std::string::npos) continue;
+            pos = line.find_first_not_of(" \t", pos + 1);
+            return pos == std::string::npos ? "unknown" : line.substr(pos);
+        }
+    }
+#elif defined(__APPLE__)
+    char buf[256];
+    size_t len = sizeof(buf);
+    if (sysctlbyname("machdep.cpu.brand_string", buf, &len, nullptr, 0) == 0)
+        return std::string(buf);
+#endif
+    return "unknown";
+}
+
+//  LOFLOAT_GEMM_TUNING_DB overrides the default $HOME/.lofloat_gemm_tuning
+inline std::string default_tuning_db_path()
+{
+    if (const char* p = std::getenv("LOFLOAT_GEMM_TUNING_DB")) return p;
+    if (const char* h = std::getenv("HOME")) return std::string(h) + "/.lofloat_gemm_tuning";
+    return ".lofloat_gemm_tuning";
+}
+
+class TuningDatabase {
+    //  cpu model -> key -> config
+    std::map<std::string, std::map<std::string, GemmConfig>> entries_;
+    std::string cpu_ = get_cpu_model();
+    std::string path_;
+    mutable std::mutex mtx_;
+    std::atomic<std::uint64_t> generation_{0};   // bumped whenever entries change
+
+public:
+    static std::string make_key(const std::string& input, const std::string& accum,
+                                const std::string& shape, int threads)
+    {
+        return input + " " + accum + " " + shape + " " + std::to_string(threads);
+    }
+
+    explicit TuningDatabase(std::string path = default_tuning_db_path()) : path_(std::move(path)) { load(); }
+
+    const std::string& cpu_model() const noexcept { return cpu_; }
+    const std::string& path() const noexcept { return path_; }
+
+    //  callers caching a lookup compare this to notice inserts and reloads without taking the lock
+    std::uint64_t generation() const noexcept { return generation_.load(std::memory_order_acquire); }
+
+    //  returns false if the file is missing or has another version; entries already held are kept
+    bool load()
+    {
+        std::ifstream in(path_);
+        if (!in) return false;
+
+        std::string line, word;
+        int version = 0;
+        if (!std::getline(in, line)) return false;
+        std::istringstream header(line);
+        if (!(header >> word >> version) || word != "lofloat-gemm-tuning" || version != tuning_db_version)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::string cpu = "unknown";
+        while (std::getline(in, line)) {
+            if (line.rfind("cpu ", 0) == 0) {
+                cpu = line.substr(4);
+                continue;
+            }
+            std::istringstream ss(line);
+            std::string input, accum, shape;
+            int threads;
+            GemmConfig c;
+            if (!(ss >> word) || word != "entry") continue;
+            if (!(ss >> input >> accum >> shape >> threads >> c.kernel
+                     >> c.MR >> c.NR >> c.MC >> c.KC >> c.NC >> c.gflops)) continue;
+            entries_[cpu][make_key(input, accum, shape, threads)] = c;
+        }
+        generation_.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    bool save() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::ofstream out(path_, std::ios::trunc);
+        if (!out) return false;
+        out << "lofloat-gemm-tuning " << tuning_db_version << "\n";
+        for (const auto& [cpu, table] : entries_) {
+            out << "cpu " << cpu << "\n";
+            for (const auto& [key, c] : table) {
+                out << "entry " << key << " " << c.kernel << " " << c.MR << " " << c.NR << " "
+                    << c.MC << " " << c.KC << " " << c.NC << " " << c.gflops << "\n";
+            }
+        }
+        return static_cast<bool>(out);
+    }
+
+    std::optional<GemmConfig> find(const std::string& key) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto cpu = entries_.find(cpu_);
+        if (cpu == entries_.end()) return std::nullopt;
+        auto it = cpu->second.find(key);
+        if (it == cpu->second.end()) return std::nullopt;
+        return it->second;
+    }
+
+    void insert(const std::string& key, const GemmConfig& c)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        entries_[cpu_][key] = c;
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto cpu = entries_.find(cpu_);
+        return cpu == entries_.end() ? 0 : cpu->second.size();
+    }
+};
+
+//  process wide database, loaded from default_tuning_db_path() on first use
+inline TuningDatabase& tuning_database()
+{
+    static TuningDatabase db;
+    return db;
+}
+
+} // namespace LoGemm
@@ -0,0 +1,293 @@
+///@author Sudhanva Kulkarni
+/// checks SYRK / TRMM / TRSM and the blocked LU, Cholesky and QR factorizations (and the solves built on them) against naive products,
+/// mixed precision iterative refinement with fp8 factors and randomized low rank approximation with fp8 sketches
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <cmath>
+#include "blas3.hpp"
+#include "factorizations.hpp"
+#include "iterative_refinement.hpp"
+#include "randomized.hpp"
+
+using namespace lo_float;
+using Mat = Lo_Gemm::Matrix<double, int>;
+
+//max |X - Y| for two n×n column major arrays
+double max_diff(const std::vector<double>& X, const std::vector<double>& Y) {
+    double e = 0.0;
+    for (size_t i = 0; i < X.size(); i++) e = std::max(e, std::abs(X[i] - Y[i]));
+    return e;
+}
+
+int main() {
+    //an empty tuning database, so results do not depend on what earlier runs saved under $HOME
+    const std::string tuning_path = (std::filesystem::temp_directory_path() / "lofloat_factorization_test_tuning").string();
+    std::ofstream(tuning_path, std::ios::trunc);
+    setenv("LOFLOAT_GEMM_TUNING_DB", tuning_path.c_str(), 1);
+
+    const int n = 150, nb = 32;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    int failures = 0;
+
+    std::vector<double> a0(n*n);
+    for (auto& x : a0) x = dist(gen);
+
+    //SYRK on both triangles and both ops (the other triangle untouched), TRMM and TRSM for every side, uplo, op and
+    //diag against products with the triangle of A made explicit. The unused triangle of A holds large values and
+    //its diagonal is not 1, so reading either shows up.
+    {
+        const int k = 70, nr = 40;
+        std::vector<double> sa(n*k), c0(n*n), tr(n*n);
+        for (auto& x : sa) x = dist(gen);
+        for (auto& x : c0) x = dist(gen);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) tr[i + j*n] = i == j ? 2.0 + dist(gen) : dist(gen) / n;
+        const Mat TA(tr.data(), n, n, n);
+
+        double es = 0.0;
+        for (auto uplo : {Lo_Gemm::Lower, Lo_Gemm::Upper})
+            for (auto op : {Lo_Gemm::NoTrans, Lo_Gemm::Trans}) {
+                std::vector<double> c = c0;
+                Mat C(c.data(), n, n, n);
+                const Mat SA(sa.data(), op == Lo_Gemm::NoTrans ? n : k, op == Lo_Gemm::NoTrans ? k : n, op == Lo_Gemm::NoTrans ? n : k);
+                LoGemm::Syrk<Mat, Mat> syrk;
+                syrk.set_block_size(nb);
+                syrk.run(uplo, C, SA, op, 0.5, 2.0);
+                for (int i = 0; i < n; i++)
+                    for (int j = 0; j < n; j++) {
+                        double ref = c0[i + j*n];
+                        if (uplo == Lo_Gemm::Lower ? i >= j : i <= j) {
+                            double s = 0.0;
+                            for (int p = 0; p < k; p++)
+                                s += (op == Lo_Gemm::NoTrans ? SA(i, p)*SA(j, p) : SA(p, i)*SA(p, j));
+                            ref = 0.5*s + 2.0*ref;
+                        }
+                        es = std::max(es, std::abs(C(i, j) - ref));
+                    }
+            }
+
+        double em = 0.0, et = 0.0;
+        for (auto side : {Lo_Gemm::Left, Lo_Gemm::Right})
+            for (auto uplo : {Lo_Gemm::Lower, Lo_Gemm::Upper})
+                for (auto op : {Lo_Gemm::NoTrans, Lo_Gemm::Trans})
+                    for (auto diag : {Lo_Gemm::NonUnit, Lo_Gemm::Unit}) {
+                        //op(A) with only the uplo triangle of A
+                        std::vector<double> t(n*n, 0.0);
+                        for (int i = 0; i < n; i++)
+                            for (int j = 0; j < n; j++) {
+                                const int r = op == Lo_Gemm::NoTrans ? i : j, c = op == Lo_Gemm::NoTrans ? j : i;
+                                if (r == c) t[i + j*n] = diag == Lo_Gemm::Unit ? 1.0 : TA(r, c);
+                                else if ((uplo == Lo_Gemm::Lower) == (r > c)) t[i + j*n] = TA(r, c);
+                            }
+                        std::vector<double> wa(tr);
+                        for (int i = 0; i < n; i++)
+                            for (int j = 0; j < n; j++)
+                                if (i != j && (uplo == Lo_Gemm::Lower) != (i > j)) wa[i + j*n] = 100.0*dist(gen);
+                        const Mat WA(wa.data(), n, n, n);
+
+                        const int bm = side == Lo_Gemm::Left ? n : nr, bn = side == Lo_Gemm::Left ? nr : n;
+                        std::vector<double> b0(bm*bn);
+                        for (auto& x : b0) x = dist(gen);
+                        //(T·X or X·T)(i, j)
+                        auto prod = [&](const std::vector<double>& x, int i, int j) {
+                            double s = 0.0;
+                            if (side == Lo_Gemm::Left) for (int p = 0; p < n; p++) s += t[i + p*n]*x[p + j*bm];
+                            else                       for (int p = 0; p < n; p++) s += x[i + p*bm]*t[p + j*n];
+                            return s;
+                        };
+
+                        std::vector<double> bm_ = b0, bs = b0;
+                        Mat BM(bm_.data(), bm, bn, bm), BS(bs.data(), bm, bn, bm);
+                        LoGemm::Trmm<Mat, Mat> trmm;
+                        LoGemm::Trsm<Mat, Mat> trsm;
+                        trmm.set_block_size(nb);
+                        trsm.set_block_size(nb);
+                        trmm.run(side, uplo, op, diag, BM, WA, 0.5);
+                        trsm.run(side, uplo, op, diag, BS, WA, 0.5);
+                        for (int i = 0; i < bm; i++)
+                            for (int j = 0; j < bn; j++) {
+                                em = std::max(em, std::abs(BM(i, j) - 0.5*prod(b0, i, j)));
+                                et = std::max(et, std::abs(prod(bs, i, j) - 0.5*b0[i + j*bm]));
+                            }
+                    }
+        std::cout << "syrk max err : " << es << "   trmm max err : " << em << "   trsm max residual : " << et << "\n";
+        failures += es > 1e-12 || em > 1e-12 || et > 1e-12;
+    }
+
+    //LU : P·A = L·U
+    {
+        std::vector<double> a = a0;
+        Mat A(a.data(), n, n, n);
+        std::vector<size_t> ipiv;
+        int info = LoGemm::getrf<double>(A, ipiv, nb);
+
+        std::vector<double> pa = a0, lu(n*n, 0.0);
+        for (int j = 0; j < n; j++)
+            for (int c = 0; c < n; c++) std::swap(pa[j + c*n], pa[ipiv[j] + c*n]);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                for (int p = 0; p <= std::min(i, j); p++)
+                    lu[i + j*n] += (p == i ? 1.0 : a[i + p*n]) * a[p + j*n];
+        double err = max_diff(pa, lu);
+        std::cout << "getrf info " << info << " max |PA - LU| : " << err << "\n";
+        failures += info != 0 || err > 1e-12;
+
+        //solve A·x = b for b = A·1
+        std::vector<double> b(n, 0.0);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) b[i] += a0[i + j*n];
+        Mat B(b.data(), n, 1, n);
+        LoGemm::getrs(A, ipiv, B, nb);
+        err = max_diff(b, std::vector<double>(n, 1.0));
+        std::cout << "getrs max |x - 1| : " << err << "\n";
+        failures += err > 1e-10;
+    }
+
+    //Cholesky of A0ᵀ·A0 + n·I
+    std::vector<double> spd(n*n, 0.0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            for (int p = 0; p < n; p++) spd[i + j*n] += a0[p + i*n] * a0[p + j*n];
+            if (i == j) spd[i + j*n] += n;
+        }
+    {
+        std::vector<double> l = spd;
+        Mat L(l.data(), n, n, n);
+        int info = LoGemm::potrf<double>(L, nb);
+        double err = 0.0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j <= i; j++) {
+                double v = 0.0;
+                for (int p = 0; p <= j; p++) v += l[i + p*n] * l[j + p*n];
+                err = std::max(err, std::abs(v - spd[i + j*n]));
+            }
+        std::cout << "potrf info " << info << " max |A - LLt| : " << err << "\n";
+        failures += info != 0 || err > 1e-10;
+    }
+
+    //QR : R has the same Gram matrix as A, AᵀA = RᵀR
+    {
+        const int m = 170;
+        std::vector<double> q(m*n);
+        for (auto& x : q) x = dist(gen);
+        std::vector<double> q0 = q;
+        Lo_Gemm::Matrix<double, int> Q(q.data(), m, n, m);
+        std::vector<double> tau;
+        LoGemm::geqrf<double>(Q, tau, 16);
+        double err = 0.0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) {
+                double ata = 0.0, rtr = 0.0;
+                for (int p = 0; p < m; p++) ata += q0[p + i*m] * q0[p + j*m];
+                for (int p = 0; p <= std::min(i, j); p++) rtr += q[p + i*m] * q[p + j*m];
+                err = std::max(err, std::abs(ata - rtr));
+            }
+        std::cout << "geqrf max |AtA - RtR| : " << err << "\n";
+        failures += err > 1e-9;
+    }
+
+    //fp8 storage, float working format : LU of a diagonally dominant matrix still solves to fp8 accuracy
+    {
+        using fp8 = float8_e4m3_fn<>;
+        std::vector<fp8> a8(n*n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) a8[i + j*n] = fp8(static_cast<float>(a0[i + j*n] + (i == j ? 2.0*n : 0.0)) / n);
+        std::vector<fp8> f8 = a8;
+        Lo_Gemm::Matrix<fp8, int> A8(f8.data(), n, n, n);
+        std::vector<size_t> ipiv;
+        int info = LoGemm::getrf<float, float>(A8, ipiv, nb);
+        //the right hand side has to be held in the format of the factors
+        std::vector<fp8> b8(n);
+        for (int i = 0; i < n; i++) {
+            double s = 0.0;
+            for (int j = 0; j < n; j++) s += static_cast<double>(a8[i + j*n]);
+            b8[i] = fp8(static_cast<float>(s));
+        }
+        Lo_Gemm::Matrix<fp8, int> B8(b8.data(), n, 1, n);
+        LoGemm::getrs<float>(A8, ipiv, B8, nb);
+        double err = 0.0;
+        for (int i = 0; i < n; i++) err = std::max(err, std::abs(static_cast<double>(b8[i]) - 1.0));
+        std::cout << "fp8 getrf/getrs info " << info << " max |x - 1| : " << err << "\n";
+        failures += info != 0 || err > 0.25;
+    }
+
+    //iterative refinement with fp8 factors : LU-IR on a well conditioned matrix, GMRES-IR on the random one
+    {
+        using fp8 = float8_e4m3_fn<>;
+        std::vector<double> a = a0;
+        for (int i = 0; i < n; i++) a[i + i*n] += n / 4.0;
+        std::vector<double> xt(n), b(n, 0.0), x(n, 0.0);
+        for (auto& v : xt) v = dist(gen);
+        for (auto* m : {&a, &a0}) {
+            for (int i = 0; i < n; i++) {
+                b[i] = 0.0;
+                for (int j = 0; j < n; j++) b[i] += (*m)[i + j*n] * xt[j];
+            }
+            Mat A(m->data(), n, n, n);
+            Lo_Gemm::Vector<double, int> B(b.data(), n), X(x.data(), n);
+            LoGemm::IROptions opt;
+            opt.method = m == &a ? LoGemm::Refinement::LU : LoGemm::Refinement::GMRES;
+            opt.nb = nb;
+            LoGemm::IterativeRefinement<fp8> ir(opt);
+            LoGemm::IRStats st = ir.run(A, B, X);
+            std::cout << (m == &a ? "LU-IR" : "GMRES-IR") << " fp8 : converged " << st.converged
+                      << " after " << st.iterations << " steps (" << st.inner_iterations << " GMRES iterations), "
+                      << "backward error " << st.backward_error << ", factor " << st.factor_seconds
+                      << " s, residual " << st.residual_seconds << " s, correction " << st.correction_seconds << " s\n";
+            failures += !st.converged || st.info != 0;
+        }
+    }
+
+    //randomized SVD and Nyström with fp8 sketches of rank 8 matrices : singular values to sketch accuracy
+    {
+        const int ms = 300, ns = 200, r = 8;
+        std::vector<double> g(ms*r), h(ns*r), sig(r);
+        for (auto& v : g) v = dist(gen);
+        for (auto& v : h) v = dist(gen);
+        LoGemm::sketch_internal::orthonormalize(g, ms, r);
+        LoGemm::sketch_internal::orthonormalize(h, ns, r);
+        for (int c = 0; c < r; c++) sig[c] = std::ldexp(1.0, -c);
+        std::vector<double> a(ms*ns, 0.0), p(ns*ns, 0.0);
+        for (int c = 0; c < r; c++)
+            for (int j = 0; j < ns; j++)
+                for (int i = 0; i < ms; i++) {
+                    a[i + j*ms] += g[i + c*ms] * sig[c] * h[j + c*ns];
+                    if (i < ns) p[i + j*ns] += h[i + c*ns] * sig[c] * h[j + c*ns];
+                }
+
+        LoGemm::RandomizedSketch<float8_e4m3_fn<>, float, float> rs;
+        std::vector<double> U, S, V, lam;
+        Mat A(a.data(), ms, ns, ms), P(p.data(), ns, ns, ns);
+        rs.svd(A, r, U, S, V);
+        rs.nystrom(P, r, U, lam);
+        double es = 0.0, el = 0.0;
+        for (int c = 0; c < r; c++) {
+            es = std::max(es, std::abs(S[c] - sig[c]));
+            el = std::max(el, std::abs(lam[c] - sig[c]));
+        }
+        std::cout << "randomized SVD max |s - sigma| : " << es << ", Nystrom max |lambda - sigma| : " << el << "\n";
+        failures += es > 0.02 || el > 0.05;
+
+        //a direction with eigenvalue −1/4, larger in magnitude than the smallest positive ones, must not
+        //come back as a positive eigenvalue
+        std::vector<double> w(ns*(r + 1));
+        std::copy(h.begin(), h.end(), w.begin());
+        for (int i = 0; i < ns; i++) w[i + r*ns] = dist(gen);
+        LoGemm::sketch_internal::orthonormalize(w, ns, r + 1);
+        for (int j = 0; j < ns; j++)
+            for (int i = 0; i < ns; i++) p[i + j*ns] -= 0.25 * w[i + r*ns] * w[j + r*ns];
+        rs.nystrom(P, r, U, lam);
+        double ei = 0.0;
+        for (int c = 0; c < r; c++) ei = std::max(ei, std::abs(lam[c] - sig[c]));
+        std::cout << "Nystrom, one negative eigenvalue, max |lambda - sigma| : " << ei << "\n";
+        failures += ei > 0.05;
+    }
+
+    std::cout << (failures ? "FAILED" : "PASSED") << "\n";
+    return failures;
+}
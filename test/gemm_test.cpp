@@ -0,0 +1,1150 @@
+///@author Sudhanva Kulkarni
+/// checks LoGemm::Gemm against a naive triple loop, with and without the fused epilogue
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include "gemms.hpp"
+#include "ozaki_gemm.hpp"
+#include "complex_gemm.hpp"
+#include "mx_quantize.hpp"
+#include "mx_blas1.hpp"
+#include "e8m0_scale.hpp"
+#include "nvfp4.hpp"
+#include "bfp.hpp"
+#include "scaled_quant.hpp"
+#include "adaptive_tensor.hpp"
+#include "int_gemm.hpp"
+#include "gemv.hpp"
+#include "batched_gemm.hpp"
+#include "autotune.h"
+
+using namespace lo_float;
+
+using fp8 = float8_e4m3_fn<>;
+
+template<typename Mat>
+double max_err(const Mat& C, const std::vector<double>& ref, int m, int n) {
+    double err = 0.0;
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            err = std::max(err, std::abs(static_cast<double>(C(i, j)) - ref[i*n + j]));
+    return err;
+}
+
+//epilogue that records the largest tile Gemm hands it before forwarding to the default one
+struct TileSizeEpilogue {
+    LoGemm::Epilogue<double> inner;
+    std::atomic<std::size_t> mr{0}, nr{0};
+
+    template<typename T_tile, typename MatrixC>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr_, std::size_t nr_, MatrixC& C)
+    {
+        LoGemm::atomic_max(mr, mr_);
+        LoGemm::atomic_max(nr, nr_);
+        inner.apply(tile, ld, i0, j0, mr_, nr_, C);
+    }
+};
+
+//epilogue that records which threads hand it tiles before forwarding to the default one
+struct ThreadSetEpilogue {
+    LoGemm::Epilogue<float> inner;
+    std::atomic<unsigned> threads{0};
+
+    template<typename T_tile, typename MatrixC>
+    void apply(const T_tile* tile, std::size_t ld, std::size_t i0, std::size_t j0,
+               std::size_t mr, std::size_t nr, MatrixC& C)
+    {
+        threads.fetch_or(1u << (LoGemm::thread_id() % 32));
+        inner.apply(tile, ld, i0, j0, mr, nr, C);
+    }
+};
+
+//SIMD MX encoder against lo_cast on values across the whole range of T, ties and subnormals included
+//(magnitudes through lo_cast, which can drop the sign of negatives that round up to the top code)
+template<typename T>
+int check_mx_encode(std::mt19937& gen, const char* name) {
+    const auto& enc = LoGemm::mx_internal::encoder<T>();
+    const float lim = enc.maxval;
+    std::uniform_real_distribution<float> e(std::log2(static_cast<float>(std::numeric_limits<T>::denorm_min())) - 1.0f,
+                                            std::log2(lim));
+    std::vector<float> x(4099);
+    for (size_t i = 0; i < x.size(); i++) {
+        const float v = std::exp2(e(gen)) * (i % 2 ? -1.0f : 1.0f);
+        x[i] = i % 5 == 0 ? static_cast<float>(T(v)) : (i % 7 == 0 ? 0.0f : v);
+        if (i % 11 == 0) x[i] = 0.5f*(static_cast<float>(T(v)) + static_cast<float>(T(v*1.2f)));
+    }
+    std::vector<uint8_t> codes(x.size());
+    LoGemm::mx_internal::encode_block(enc, x.data(), 1.0f, codes.data(), x.size());
+    int bad = 0;
+    for (size_t i = 0; i < x.size(); i++)
+        bad += LoGemm::decode_table<T>()[codes[i]] !=
+               std::copysign(static_cast<float>(LoGemm::lo_cast<T>(std::min(std::abs(x[i]), lim))), x[i]);
+    std::cout << "MX encode " << name << (enc.ok ? "" : " (no fast path)") << " mismatches : " << bad << "\n";
+    return !enc.ok || bad != 0;
+}
+
+int main() {
+    //an empty tuning database, so results do not depend on what earlier runs saved under $HOME
+    const std::string tuning_path = (std::filesystem::temp_directory_path() / "lofloat_gemm_test_tuning").string();
+    std::ofstream(tuning_path, std::ios::trunc);
+    setenv("LOFLOAT_GEMM_TUNING_DB", tuning_path.c_str(), 1);
+
+    const int m = 37, n = 45, k = 300;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    std::vector<fp8> a(m*k), b(k*n);
+    for (auto& x : a) x = fp8(dist(gen));
+    for (auto& x : b) x = fp8(dist(gen));
+
+    //reference in double from the decoded inputs
+    std::vector<double> ref(m*n, 0.0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            for (int p = 0; p < k; p++)
+                ref[i*n + j] += static_cast<double>(a[i + p*m]) * static_cast<double>(b[p + j*k]);
+
+    using MatA = Lo_Gemm::Matrix<fp8, int>;
+    using MatC = Lo_Gemm::Matrix<float, int>;
+    MatA A(a.data(), m, k, m);
+    MatA B(b.data(), k, n, k);
+
+    int failures = 0;
+
+    //plain C ← C + A·B with float accumulation
+    std::vector<float> c(m*n, 0.0f);
+    MatC C(c.data(), m, n, m);
+    LoGemm::Gemm<MatA, MatA, MatC, float, double> gemm;
+    gemm.run(C, A, B);
+    double err = max_err(C, ref, m, n);
+    std::cout << "C += A*B               max err : " << err << "\n";
+    failures += err > 1e-4;
+
+    //fused epilogue : relu(2*A·B + 0.5*C + bias) with amax
+    std::vector<float> c0(m*n);
+    for (auto& x : c0) x = dist(gen);
+    std::vector<float> bias(m);
+    for (auto& x : bias) x = dist(gen);
+    std::vector<double> ref2(m*n);
+    double ref_amax = 0.0;
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++) {
+            double v = 2.0*ref[i*n + j] + 0.5*c0[i + j*m] + bias[i];
+            ref2[i*n + j] = v > 0.0 ? v : 0.0;
+            ref_amax = std::max(ref_amax, ref2[i*n + j]);
+        }
+
+    c = c0;
+    LoGemm::Epilogue<float> epi;
+    epi.alpha = 2.0f;
+    epi.beta = 0.5f;
+    epi.bias = bias.data();
+    epi.bias_mode = LoGemm::BiasMode::PerRow;
+    epi.act = LoGemm::Activation::ReLU;
+    epi.track_amax = true;
+    gemm.run(C, A, B, epi);
+    err = max_err(C, ref2, m, n);
+    std::cout << "relu(2AB + C/2 + bias)  max err : " << err << ", amax " << epi.amax() << " (ref " << ref_amax << ")\n";
+    failures += err > 1e-4;
+    failures += std::abs(epi.amax() - ref_amax) > 1e-4;
+
+    //quantized output : fp8 C with beta = 0
+    std::vector<fp8> c8(m*n);
+    using MatC8 = Lo_Gemm::Matrix<fp8, int>;
+    MatC8 C8(c8.data(), m, n, m);
+    LoGemm::Gemm<MatA, MatA, MatC8, float> gemm8;
+    LoGemm::Epilogue<float> q;
+    q.beta = 0.0f;
+    q.out_scale = 0.25f;
+    gemm8.run(C8, A, B, q);
+    int mismatches = 0;
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < n; j++)
+            mismatches += std::abs(static_cast<float>(C8(i, j)) - static_cast<float>(fp8(static_cast<float>(0.25*ref[i*n + j])))) > 1e-6f;
+    std::cout << "fp8 output mismatches : " << mismatches << "\n";
+    failures += mismatches > 0;
+
+    //op(A) = Aᵀ with Aᵀ stored row major (k×m), row major B and C
+    std::vector<fp8> at(k*m), br(k*n);
+    for (int i = 0; i < m; i++)
+        for (int p = 0; p < k; p++) at[i + p*m] = a[i + p*m];   //row major k×m with ld m is A col major
+    for (int p = 0; p < k; p++)
+        for (int j = 0; j < n; j++) br[p*n + j] = b[p + j*k];
+    using MatAr = Lo_Gemm::Matrix<fp8, int, Lo_Gemm::RowMajor>;
+    using MatCr = Lo_Gemm::Matrix<float, int, Lo_Gemm::RowMajor>;
+    MatAr At(at.data(), k, m, m);
+    MatAr Br(br.data(), k, n, n);
+    std::vector<float> cr(m*n, 0.0f);
+    MatCr Cr(cr.data(), m, n, n);
+    LoGemm::Gemm<MatAr, MatAr, MatCr, float, double> gemm_t;
+    gemm_t.run(Cr, At, Br, Lo_Gemm::Trans, Lo_Gemm::NoTrans);
+    err = max_err(Cr, ref, m, n);
+    std::cout << "C += At^T * B (row major) max err : " << err << "\n";
+    failures += err > 1e-4;
+
+    //op(B) = Bᵀ with Bᵀ stored col major (n×k)
+    std::vector<fp8> bt(n*k);
+    for (int p = 0; p < k; p++)
+        for (int j = 0; j < n; j++) bt[j + p*n] = b[p + j*k];
+    MatA Bt(bt.data(), n, k, n);
+    std::fill(c.begin(), c.end(), 0.0f);
+    gemm.run(C, A, Bt, Lo_Gemm::NoTrans, Lo_Gemm::Trans);
+    err = max_err(C, ref, m, n);
+    std::cout << "C += A * Bt^T           max err : " << err << "\n";
+    failures += err > 1e-4;
+
+    //small blocking so every loop takes several trips
+    const auto& cache = LoGemm::cache_info();
+    const auto blk = gemm.blocking();
+    std::cout << "L1 " << cache.L1 << " L2 " << cache.L2 << " L3 " << cache.L3
+              << " -> MC " << blk.MC << " KC " << blk.KC << " NC " << blk.NC << "\n";
+    gemm.set_blocking({8, 16, 12});
+    std::fill(c.begin(), c.end(), 0.0f);
+    gemm.run(C, A, B);
+    err = max_err(C, ref, m, n);
+    std::cout << "C += A*B, MC=8 KC=16 NC=12 max err : " << err << "\n";
+    failures += err > 1e-4;
+
+    //pipelined packing gives the same bits as the regular path
+    {
+        std::vector<float> cp(m*n, 0.0f);
+        MatC Cp(cp.data(), m, n, m);
+        gemm.set_pipelined(true);
+        gemm.run(Cp, A, B);
+        gemm.set_pipelined(false);
+        std::cout << "pipelined == regular : " << (cp == c) << "\n";
+        failures += cp != c;
+    }
+
+    //split-K on a long K : matches the reference and is bitwise identical to a rerun
+    {
+        const int ms = 6, ns = 5, ks = 5000;
+        std::vector<fp8> as(ms*ks), bs(ks*ns);
+        for (auto& x : as) x = fp8(dist(gen));
+        for (auto& x : bs) x = fp8(dist(gen));
+        std::vector<double> refs(ms*ns, 0.0);
+        for (int i = 0; i < ms; i++)
+            for (int j = 0; j < ns; j++)
+                for (int p = 0; p < ks; p++)
+                    refs[i*ns + j] += static_cast<double>(as[i + p*ms]) * static_cast<double>(bs[p + j*ks]);
+
+        MatA As(as.data(), ms, ks, ms);
+        MatA Bs(bs.data(), ks, ns, ks);
+        std::vector<float> cs1(ms*ns, 0.0f), cs2(ms*ns, 0.0f);
+        MatC Cs1(cs1.data(), ms, ns, ms), Cs2(cs2.data(), ms, ns, ms);
+
+        LoGemm::Gemm<MatA, MatA, MatC, float, double> split;
+        split.set_blocking({8, 64, 8});
+        split.set_split_k(LoGemm::Gemm<MatA, MatA, MatC, float, double>::split_k_auto);
+        split.run(Cs1, As, Bs);
+        split.run(Cs2, As, Bs);
+        err = max_err(Cs1, refs, ms, ns);
+        std::cout << "split-K C += A*B         max err : " << err << "\n";
+        failures += err > 1e-3;
+        failures += cs1 != cs2;
+
+#ifdef _OPENMP
+        //the slice reduction order does not depend on the team size : one thread gives the same bits
+        {
+            std::vector<float> cs3(ms*ns, 0.0f), cs4(ms*ns, 0.0f);
+            MatC Cs3(cs3.data(), ms, ns, ms), Cs4(cs4.data(), ms, ns, ms);
+            const int nt = omp_get_max_threads();
+            omp_set_num_threads(1);
+            split.run(Cs3, As, Bs);
+            omp_set_num_threads(4);
+            split.run(Cs4, As, Bs);
+            omp_set_num_threads(nt);
+            std::cout << "split-K 1 vs 4 threads bitwise equal : " << (cs3 == cs4 && cs3 == cs1) << "\n";
+            failures += cs3 != cs4 || cs3 != cs1;
+        }
+#endif
+
+        //a split-K result wider than one tile still reaches the epilogue in MR×NR tiles
+        const int nw = 40;
+        std::vector<fp8> bw(ks*nw);
+        for (auto& x : bw) x = fp8(dist(gen));
+        std::vector<float> cw(ms*nw, 0.0f), cw_ref(ms*nw, 0.0f);
+        MatA Bw(bw.data(), ks, nw, ks);
+        MatC Cw(cw.data(), ms, nw, ms), Cw_ref(cw_ref.data(), ms, nw, ms);
+        TileSizeEpilogue tiles;
+        split.run(Cw, As, Bw, tiles);
+        LoGemm::Gemm<MatA, MatA, MatC, float, double> plain;
+        plain.set_blocking({8, 64, 8});
+        plain.run(Cw_ref, As, Bw);
+        double werr = 0.0;
+        for (int i = 0; i < ms; i++)
+            for (int j = 0; j < nw; j++) werr = std::max(werr, static_cast<double>(std::abs(Cw(i, j) - Cw_ref(i, j))));
+        std::cout << "split-K largest epilogue tile : " << tiles.mr << "x" << tiles.nr << "   max diff to unsplit : " << werr << "\n";
+        failures += tiles.nr > LoGemm::MAX_NR || tiles.mr > LoGemm::MAX_MR || werr > 1e-3;
+    }
+
+    //Ozaki scheme : fp8 slices emulate double GEMM, error against native double Gemm for growing slice counts
+    {
+        using MatD = Lo_Gemm::Matrix<double, int>;
+        std::vector<double> ad(m*k), bd(k*n), cn(m*n, 0.0), co(m*n);
+        for (auto& x : ad) x = std::ldexp(dist(gen), static_cast<int>(gen() % 9) - 4);
+        for (auto& x : bd) x = std::ldexp(dist(gen), static_cast<int>(gen() % 9) - 4);
+        MatD Ad(ad.data(), m, k, m), Bd(bd.data(), k, n, k), Cn(cn.data(), m, n, m), Co(co.data(), m, n, m);
+
+        auto t0 = std::chrono::steady_clock::now();
+        LoGemm::Gemm<MatD, MatD, MatD>().run(Cn, Ad, Bd);
+        const double t_native = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        double cmax = 0.0;
+        for (double x : cn) cmax = std::max(cmax, std::abs(x));
+
+        LoGemm::OzakiGemm<fp8> oz;
+        for (int S : {3, oz.slices_for(24), 11, oz.slices_for(53)}) {
+            std::fill(co.begin(), co.end(), 0.0);
+            oz.set_slices(S);
+            t0 = std::chrono::steady_clock::now();
+            oz.run(Co, Ad, Bd);
+            const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double e = 0.0;
+            for (int i = 0; i < m*n; i++) e = std::max(e, std::abs(co[i] - cn[i]));
+            std::cout << "Ozaki " << S << " fp8 slices (" << oz.products() << " products) rel err : " << e / cmax
+                      << ", " << t / t_native << "x native double\n";
+            if (S == oz.slices_for(24)) failures += e / cmax > 1e-6;
+            if (S == oz.slices_for(53)) failures += e / cmax > 1e-14;
+        }
+    }
+
+    //complex fp8 inputs in split storage, C ← alpha·A·Bᴴ + beta·C with 4M and 3M, rounding once or per product
+    {
+        using CMatA = Lo_Gemm::ComplexMatrix<fp8, int>;
+        using CMatC = Lo_Gemm::ComplexMatrix<float, int>;
+        std::vector<fp8> ar(m*k), ai(m*k), br(n*k), bi(n*k);
+        for (auto* v : {&ar, &ai, &br, &bi})
+            for (auto& x : *v) x = fp8(dist(gen));
+        std::vector<float> cr0(m*n), ci0(m*n);
+        for (auto& x : cr0) x = dist(gen);
+        for (auto& x : ci0) x = dist(gen);
+        const std::complex<double> alpha(0.5, -1.0), beta(2.0, 0.25);
+
+        //B stored n×k, op(B) = conj(B)ᵀ
+        std::vector<std::complex<double>> refc(m*n);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++) {
+                std::complex<double> s = 0.0;
+                for (int p = 0; p < k; p++)
+                    s += std::complex<double>(static_cast<double>(ar[i + p*m]), static_cast<double>(ai[i + p*m]))
+                       * std::conj(std::complex<double>(static_cast<double>(br[j + p*n]), static_cast<double>(bi[j + p*n])));
+                refc[i + j*m] = alpha*s + beta*std::complex<double>(cr0[i + j*m], ci0[i + j*m]);
+            }
+
+        CMatA Ac(ar.data(), ai.data(), m, k, m), Bc(br.data(), bi.data(), n, k, n);
+        for (auto algo : {LoGemm::ComplexAlgorithm::FourM, LoGemm::ComplexAlgorithm::ThreeM})
+            for (auto rnd : {LoGemm::ComplexRounding::Once, LoGemm::ComplexRounding::PerProduct}) {
+                std::vector<float> cr = cr0, ci = ci0;
+                CMatC Cc(cr.data(), ci.data(), m, n, m);
+                LoGemm::ComplexGemm<CMatA, CMatA, CMatC> cg(algo, rnd);
+                cg.run(Cc, Ac, Bc, alpha, beta, Lo_Gemm::NoTrans, Lo_Gemm::Trans, false, true);
+                double e = 0.0;
+                for (int i = 0; i < m; i++)
+                    for (int j = 0; j < n; j++) e = std::max(e, std::abs(Cc.value(i, j) - refc[i + j*m]));
+                std::cout << (algo == LoGemm::ComplexAlgorithm::FourM ? "4M" : "3M")
+                          << (rnd == LoGemm::ComplexRounding::Once ? " once       " : " per product")
+                          << " complex C  max err : " << e << "\n";
+                failures += e > 1e-3;
+            }
+    }
+
+    //MX block quantization : encoder, round trip for every block layout, MX_Matrix and MX_Vector
+    {
+        failures += check_mx_encode<float8_e4m3_fn<>>(gen, "e4m3");
+        failures += check_mx_encode<float8_e5m2<>>(gen, "e5m2");
+        failures += check_mx_encode<float6_e3m2<>>(gen, "e3m2");
+        failures += check_mx_encode<float4_e2m1<>>(gen, "e2m1");
+
+        const int qm = 29, qn = 48;
+        std::uniform_real_distribution<float> mag(-20.0f, 20.0f);
+        std::vector<float> x(qm*qn), y(qm*qn);
+        for (int i = 0; i < qm; i++) {
+            const float row_scale = std::exp2(mag(gen));
+            for (int j = 0; j < qn; j++) x[i + j*qm] = row_scale * dist(gen);
+        }
+        Lo_Gemm::Matrix<float, int> X(x.data(), qm, qn, qm), Y(y.data(), qm, qn, qm);
+
+        const int M = fp8::mantissa_bits, emax = std::ilogb(static_cast<double>(std::numeric_limits<fp8>::max()));
+        for (auto blk : {Lo_Gemm::MX_tuple(Lo_Gemm::byRow, 32), Lo_Gemm::MX_tuple(Lo_Gemm::byColumn, 8),
+                         Lo_Gemm::MX_tuple(Lo_Gemm::byBlock, 4, 16)}) {
+            std::vector<fp8> q(qm*qn);
+            std::vector<int8_t> exps(LoGemm::mx_scale_count(qm, qn, blk));
+            Lo_Gemm::Matrix<fp8, int, Lo_Gemm::RowMajor> Q(q.data(), qm, qn, qn);
+            LoGemm::mx_quantize(X, Q, exps.data(), blk);
+            LoGemm::mx_dequantize(Q, exps.data(), blk, Y);
+
+            //at most two units in the last place of the top binade of the block (one from clamping to max)
+            const int bm = blk.m, bn = blk.n;
+            double worst = 0.0;
+            for (int i = 0; i < qm; i++)
+                for (int j = 0; j < qn; j++) {
+                    const int eb = blk.layout == Lo_Gemm::byRow    ? exps[i*((qn + bm - 1)/bm) + j/bm]
+                                 : blk.layout == Lo_Gemm::byColumn ? exps[j*((qm + bm - 1)/bm) + i/bm]
+                                 :                                   exps[(i/bm)*((qn + bn - 1)/bn) + j/bn];
+                    worst = std::max(worst, std::abs(X(i, j) - Y(i, j)) / std::ldexp(1.0, eb + emax - M + 1));
+                }
+            std::cout << "MX quantize layout " << int(blk.layout) << " round trip err / bound : " << worst << "\n";
+            failures += worst > 1.0;
+        }
+
+        std::vector<fp8> mq(qm*qn);
+        std::vector<float> mexp(qm*qn/8);
+        Lo_Gemm::MX_Matrix<fp8, int, float, Lo_Gemm::RowMajor> MQ(mq.data(), mexp.data(), qm, qn, qn, 8);
+        LoGemm::mx_quantize(X, MQ);
+        LoGemm::mx_dequantize(MQ, Y);
+        int mism = 0;
+        for (int i = 0; i < qm; i++)
+            for (int j = 0; j < qn; j++) mism += MQ.scaled_val<float>(i, j) != Y(i, j);
+
+        std::vector<fp8> vq(qn);
+        std::vector<int8_t> vexp(qn/16);
+        std::vector<float> vy(qn);
+        Lo_Gemm::Vector<float, int> xv(x.data(), qn, qm), yv(vy.data(), qn);
+        Lo_Gemm::MX_Vector<fp8, int, int8_t> VQ(vq.data(), vexp.data(), qn, qn/16, 1, 16);
+        LoGemm::mx_quantize(xv, VQ);
+        LoGemm::mx_dequantize(VQ, yv);
+        for (int j = 0; j < qn; j++) mism += VQ(j) != vy[j];
+        std::cout << "MX_Matrix / MX_Vector scaled value mismatches : " << mism << "\n";
+        failures += mism != 0;
+
+        //transpose : plain tiles and copies, MX copy when the blocks carry over, requantization when they do not
+        std::vector<float> tc(qn*qm), tr(qn*qm);
+        Lo_Gemm::Matrix<float, int> Tc(tc.data(), qn, qm, qn);
+        Lo_Gemm::Matrix<float, int, Lo_Gemm::RowMajor> Tr(tr.data(), qn, qm, qm);
+        Lo_Gemm::transpose<decltype(X), decltype(Tc), 16, 8>(X, Tc);
+        Lo_Gemm::transpose(X, Tr);
+        int tmism = 0;
+        for (int i = 0; i < qn; i++)
+            for (int j = 0; j < qm; j++) tmism += (Tc(i, j) != X(j, i)) + (Tr(i, j) != X(j, i));
+
+        std::vector<fp8> cq(qn*qm), rq(qn*32), ref_q(qn*32);
+        std::vector<float> cexp(qn*qm/8);
+        std::vector<int8_t> rexp(qn*32/8), ref_exp(qn*32/8);
+        Lo_Gemm::MX_Matrix<fp8, int, float> MC(cq.data(), cexp.data(), qn, qm, qn, 8);
+        Lo_Gemm::MX_Matrix<fp8, int, int8_t, Lo_Gemm::RowMajor> MR(rq.data(), rexp.data(), qn, qm, 32, 8);
+        Lo_Gemm::transpose(MQ, MC);
+        Lo_Gemm::transpose<decltype(MQ), decltype(MR), 16, 8>(MQ, MR);
+
+        //MR must be what quantizing the values of MQᵀ gives
+        std::vector<float> mt(qn*qm);
+        for (int i = 0; i < qn; i++)
+            for (int j = 0; j < qm; j++) mt[i + j*qn] = MQ.scaled_val<float>(j, i);
+        Lo_Gemm::Matrix<float, int> Mt(mt.data(), qn, qm, qn);
+        Lo_Gemm::MX_Matrix<fp8, int, int8_t, Lo_Gemm::RowMajor> MRef(ref_q.data(), ref_exp.data(), qn, qm, 32, 8);
+        LoGemm::mx_quantize(Mt, MRef);
+        for (int i = 0; i < qn; i++)
+            for (int j = 0; j < qm; j++)
+                tmism += (MC.scaled_val<float>(i, j) != MQ.scaled_val<float>(j, i))
+                       + (MR.scaled_val<float>(i, j) != MRef.scaled_val<float>(i, j));
+        //E8M0 scales are stored as biased codes, the requantizing transpose must write the codes mx_quantize writes
+        std::vector<fp8> eq(qn*32), ref_eq(qn*32);
+        std::vector<LoGemm::e8m0_t> eexp(qn*32/8), ref_eexp(qn*32/8);
+        Lo_Gemm::MX_Matrix<fp8, int, LoGemm::e8m0_t, Lo_Gemm::RowMajor> ME(eq.data(), eexp.data(), qn, qm, 32, 8);
+        Lo_Gemm::MX_Matrix<fp8, int, LoGemm::e8m0_t, Lo_Gemm::RowMajor> MERef(ref_eq.data(), ref_eexp.data(), qn, qm, 32, 8);
+        Lo_Gemm::transpose(MQ, ME);
+        LoGemm::mx_quantize(Mt, MERef);
+        for (std::size_t b = 0; b < eexp.size(); b++) tmism += eexp[b].rep() != ref_eexp[b].rep();
+        tmism += eq != ref_eq;
+        std::cout << "transpose mismatches : " << tmism << "\n";
+        failures += tmism != 0;
+
+        //MX level 1 : dot, sum and axpy against the element by element scaled values. The MX axpy requantizes y,
+        //so its error is bounded by two units in the last place of the top binade of a block (2·2^-3 of its max)
+        const int vn = 1003, vr = 32, vb = (vn + vr - 1)/vr;
+        std::vector<float> xf(vn), yf(vn), yplain(vn);
+        for (int i = 0; i < vn; i++) {
+            xf[i] = std::exp2(mag(gen)) * dist(gen);
+            yf[i] = dist(gen);
+        }
+        std::vector<fp8> xq(vn), yq(vn);
+        std::vector<int8_t> xe(vb);
+        std::vector<float> ye(vb);
+        Lo_Gemm::Vector<float, int> xfv(xf.data(), vn), yfv(yf.data(), vn), ypv(yplain.data(), vn);
+        Lo_Gemm::MX_Vector<fp8, int, int8_t> XV(xq.data(), xe.data(), vn, vb, 1, vr);
+        Lo_Gemm::MX_Vector<fp8, int, float> YV(yq.data(), ye.data(), vn, vb, 1, vr);
+        LoGemm::mx_quantize(xfv, XV);
+        LoGemm::mx_quantize(yfv, YV);
+
+        double dref = 0.0, sref = 0.0, dabs = 0.0, sabs = 0.0;
+        for (int i = 0; i < vn; i++) {
+            dref += static_cast<double>(XV(i)) * YV(i);
+            dabs += std::abs(static_cast<double>(XV(i)) * YV(i));
+            sref += XV(i);
+            sabs += std::abs(XV(i));
+        }
+        const double derr = std::abs(LoGemm::mx_dot(XV, YV) - dref) / dabs;
+        const double serr = std::abs(LoGemm::mx_sum(XV) - sref) / sabs;
+
+        double aerr = 0.0, mxerr = 0.0, ymax = 0.0;
+        for (int i = 0; i < vn; i++) yplain[i] = YV(i);
+        std::vector<double> aref(vn);
+        for (int i = 0; i < vn; i++) aref[i] = -0.5*static_cast<double>(XV(i)) + YV(i);
+        LoGemm::mx_axpy(-0.5f, XV, ypv);
+        LoGemm::mx_axpy(-0.5f, XV, YV);
+        for (int i = 0; i < vn; i++) {
+            aerr = std::max(aerr, std::abs(yplain[i] - aref[i]) / std::max(std::abs(aref[i]), 1e-30));
+            mxerr = std::max(mxerr, std::abs(YV(i) - aref[i]));
+            ymax = std::max(ymax, std::abs(aref[i]));
+        }
+        std::cout << "MX dot rel err : " << derr << "   sum rel err : " << serr << "   axpy rel err : " << aerr
+                  << "   MX axpy err / max : " << mxerr / ymax << "\n";
+        failures += derr > 1e-6 || serr > 1e-6 || aerr > 1e-6 || mxerr / ymax > 0.25;
+
+        //E8M0 scales : the type, exponent-add scaling of float and bf16 lanes against ldexp, MX exps in E8M0
+        int emism = 0;
+        for (int c = 1; c < 255; c++) emism += static_cast<double>(LoGemm::e8m0_t::FromRep(c)) != std::ldexp(1.0, c - 127);
+        for (int e = -126; e <= 127; e++) emism += LoGemm::e8m0_t(std::ldexp(1.0, e)).rep() != e + 127;
+        emism += !std::isnan(Lo_Gemm::shared_scale<float>(LoGemm::e8m0_t::FromRep(0xFF)));
+
+        std::uniform_int_distribution<int> bits(0, 0x7FFFFFFF), codes(0, 254);
+        const int sn = 4099;
+        std::vector<float> lanes(sn), lref(sn);
+        std::vector<uint16_t> hl(sn), href(sn);
+        for (int c : {0, 1, 60, 100, 126, 127, 128, 160, 200, 254, codes(gen), codes(gen)}) {
+            const int d = c - 127;
+            for (int i = 0; i < sn; i++) {
+                uint32_t b = static_cast<uint32_t>(bits(gen)) | (i % 2 ? 0x80000000u : 0u);
+                if (i % 17 == 0) b &= 0x807FFFFFu;                                  // subnormals
+                std::memcpy(&lanes[i], &b, 4);
+                if (i % 101 == 0) lanes[i] = i % 3 ? std::numeric_limits<float>::infinity() : 0.0f;
+                double r = std::ldexp(static_cast<double>(lanes[i]), d);
+                if (std::isfinite(lanes[i]) && std::abs(r) > std::numeric_limits<float>::max())
+                    r = std::copysign(std::numeric_limits<float>::max(), r);
+                lref[i] = static_cast<float>(r);
+
+                hl[i] = static_cast<uint16_t>(b >> 16);
+                const float hf = LoGemm::e8m0_internal::float_from_bf16(hl[i]);
+                double hr = std::ldexp(static_cast<double>(hf), d);
+                const double ulp = std::ldexp(1.0, std::max(std::ilogb(hr), -126) - 7);
+                if (std::isfinite(hr) && hr != 0.0) hr = std::nearbyint(hr / ulp) * ulp;
+                if (std::isfinite(hf) && std::abs(hr) > 0x1.FEp127) hr = std::copysign(0x1.FEp127, hr);
+                const float hrf = static_cast<float>(hr);
+                uint32_t hb;
+                std::memcpy(&hb, &hrf, 4);
+                href[i] = std::isnan(hf) ? hl[i] : static_cast<uint16_t>(hb >> 16);
+            }
+            LoGemm::e8m0_scale_n(lanes.data(), sn, static_cast<uint8_t>(c));
+            LoGemm::e8m0_scale_n(hl.data(), sn, static_cast<uint8_t>(c));
+            for (int i = 0; i < sn; i++) {
+                emism += !(lanes[i] == lref[i] || (std::isnan(lanes[i]) && std::isnan(lref[i])))
+                       || std::signbit(lanes[i]) != std::signbit(lref[i]);
+                emism += hl[i] != href[i];
+            }
+        }
+
+        std::vector<LoGemm::e8m0_t> e8(vb);
+        std::vector<fp8> x8(vn);
+        Lo_Gemm::MX_Vector<fp8, int, LoGemm::e8m0_t> X8(x8.data(), e8.data(), vn, vb, 1, vr);
+        LoGemm::mx_quantize(xfv, X8);
+        for (int b = 0; b < vb; b++) emism += e8[b].rep() != xe[b] + 127;
+        for (int i = 0; i < vn; i++) emism += X8(i) != XV(i);
+        emism += LoGemm::mx_dot(X8, YV) != LoGemm::mx_dot(XV, YV);
+        std::cout << "E8M0 mismatches : " << emism << "\n";
+        failures += emism != 0;
+
+        //NVFP4 : quantize / dequantize against the element bound, block-scaled GEMM against the dequantized product
+        const int fm = 45, fk = 96, fn = 37;
+        std::vector<float> fa(fm*fk), fb(fk*fn);
+        for (int i = 0; i < fm; i++) {
+            const float row_scale = std::exp2(0.25f*mag(gen));
+            for (int p = 0; p < fk; p++) fa[i + p*fm] = row_scale * dist(gen);
+        }
+        for (auto& v : fb) v = dist(gen);
+        Lo_Gemm::Matrix<float, int> FA(fa.data(), fm, fk, fm), FB(fb.data(), fk, fn, fk);
+
+        using NVA = Lo_Gemm::NVFP4_Matrix<int, Lo_Gemm::RowMajor>;
+        using NVB = Lo_Gemm::NVFP4_Matrix<int, Lo_Gemm::ColMajor>;
+        std::vector<uint8_t> qa(NVA::code_bytes(fm, fk, fk)), qb(NVB::code_bytes(fk, fn, fk));
+        std::vector<NVA::scale_type> sa(NVA::scale_count(fm, fk, fk)), sb(NVB::scale_count(fk, fn, fk));
+        NVA QA(qa.data(), sa.data(), fm, fk, fk);
+        NVB QB(qb.data(), sb.data(), fk, fn, fk);
+        LoGemm::nvfp4_quantize(FA, QA);
+        LoGemm::nvfp4_quantize(FB, QB);
+
+        std::vector<float> da(fm*fk);
+        Lo_Gemm::Matrix<float, int> DA(da.data(), fm, fk, fm);
+        LoGemm::nvfp4_dequantize(QA, DA);
+        //one e2m1 step at the top of the block plus the scale rounding : 1/4 + 1/16 of the block amax
+        double qworst = 0.0;
+        for (int i = 0; i < fm; i++)
+            for (int b = 0; b < fk; b += 16) {
+                float bmax = 0.0f;
+                for (int p = b; p < b + 16; p++) bmax = std::max(bmax, std::abs(FA(i, p)));
+                for (int p = b; p < b + 16; p++) {
+                    qworst = std::max(qworst, std::abs(DA(i, p) - FA(i, p)) / (0.3125*bmax));
+                    qworst = std::max(qworst, std::abs(DA(i, p) - QA.scaled_val<double>(i, p)) / (1e-6*bmax));
+                }
+            }
+
+        std::vector<float> fc(fm*fn);
+        Lo_Gemm::Matrix<float, int> FC(fc.data(), fm, fn, fm);
+        LoGemm::NVFP4Gemm<Lo_Gemm::Matrix<float, int>> nvg;
+        LoGemm::epilogue_for_t<float, float> fover;
+        fover.beta = 0;
+        nvg.run(FC, QA, QB, fover);
+        double gworst = 0.0;
+        for (int i = 0; i < fm; i++)
+            for (int j = 0; j < fn; j++) {
+                double ref = 0.0, mag_ = 0.0;
+                for (int p = 0; p < fk; p++) {
+                    ref += QA.scaled_val<double>(i, p) * QB.scaled_val<double>(p, j);
+                    mag_ += std::abs(QA.scaled_val<double>(i, p) * QB.scaled_val<double>(p, j));
+                }
+                gworst = std::max(gworst, std::abs(FC(i, j) - ref) / mag_);
+            }
+        std::cout << "NVFP4 quantize err / bound : " << qworst << "   GEMM rel err : " << gworst << "\n";
+        failures += qworst > 1.0 || gworst > 1e-5;
+
+        //block floating point : MXINT8 (E8M0 scales) and BFP16, one mantissa unit of error, integer GEMM
+        auto check_bfp = [&](auto len_tag, auto scal_tag, const char* name) {
+            constexpr int LEN = decltype(len_tag)::value;
+            using S = decltype(scal_tag);
+            using BA = Lo_Gemm::BFP_Matrix<LEN, int, S, Lo_Gemm::RowMajor>;
+            using BB = Lo_Gemm::BFP_Matrix<LEN, int, S, Lo_Gemm::ColMajor>;
+            const int r = Lo_Gemm::mxint8_block_size;
+            std::vector<typename BA::value_type> ma(fm*fk), mb(fk*fn);
+            std::vector<S> ea(fm*fk/r), eb(fk*fn/r);
+            BA A(ma.data(), ea.data(), fm, fk, fk, r);
+            BB B(mb.data(), eb.data(), fk, fn, fk, r);
+            LoGemm::mx_quantize(FA, A);
+            LoGemm::mx_quantize(FB, B);
+
+            std::vector<float> dq(fm*fk);
+            Lo_Gemm::Matrix<float, int> DQ(dq.data(), fm, fk, fm);
+            LoGemm::mx_dequantize(A, DQ);
+            double qw = 0.0;
+            for (int i = 0; i < fm; i++)
+                for (int b = 0; b < fk; b += r) {
+                    float bmax = 0.0f;
+                    for (int p = b; p < b + r; p++) bmax = std::max(bmax, std::abs(FA(i, p)));
+                    for (int p = b; p < b + r; p++) {
+                        qw = std::max(qw, std::abs(DQ(i, p) - FA(i, p)) / std::ldexp(static_cast<double>(bmax), -(LEN - 2)));
+                        qw = std::max(qw, std::abs(DQ(i, p) - A.template scaled_val<double>(i, p)) / (1e-6*bmax));
+                    }
+                }
+
+            std::vector<float> bc(fm*fn);
+            Lo_Gemm::Matrix<float, int> BC(bc.data(), fm, fn, fm);
+            LoGemm::BFPGemm<LEN, Lo_Gemm::Matrix<float, int>, S> g;
+            g.run(BC, A, B, fover);
+            double gw = 0.0;
+            for (int i = 0; i < fm; i++)
+                for (int j = 0; j < fn; j++) {
+                    double ref = 0.0, mag_ = 0.0;
+                    for (int p = 0; p < fk; p++) {
+                        const double t = A.template scaled_val<double>(i, p) * B.template scaled_val<double>(p, j);
+                        ref += t;
+                        mag_ += std::abs(t);
+                    }
+                    gw = std::max(gw, std::abs(BC(i, j) - ref) / mag_);
+                }
+            std::cout << name << " quantize err / bound : " << qw << "   GEMM rel err : " << gw << "\n";
+            failures += qw > 1.0 || gw > 1e-5;
+        };
+        check_bfp(std::integral_constant<int, 8>{}, LoGemm::e8m0_t{}, "MXINT8");
+        check_bfp(std::integral_constant<int, 16>{}, int8_t{}, "BFP16");
+
+        //MXGemm on fp8 : k-blocked scales (row major A / column major B), scales folded into the codes (column major
+        //A, blocks down the columns), and integer operands whose scales cross k, which must be rejected
+        {
+            std::vector<fp8> ra(fm*fk), ca(fm*fk), cb(fk*fn);
+            std::vector<int8_t> rea(fm*fk/32), cea(fm*fk/9), ceb(fk*fn/32);
+            Lo_Gemm::MX_Matrix<fp8, int, int8_t, Lo_Gemm::RowMajor> RA(ra.data(), rea.data(), fm, fk, fk, 32);
+            Lo_Gemm::MX_Matrix<fp8, int, int8_t> CA(ca.data(), cea.data(), fm, fk, fm, 9);
+            Lo_Gemm::MX_Matrix<fp8, int, int8_t> CB(cb.data(), ceb.data(), fk, fn, fk, 32);
+            LoGemm::mx_quantize(FA, RA);
+            LoGemm::mx_quantize(FA, CA);
+            LoGemm::mx_quantize(FB, CB);
+
+            auto mx_err = [&](const auto& A, auto& g) {
+                std::vector<float> mc(fm*fn);
+                Lo_Gemm::Matrix<float, int> MC(mc.data(), fm, fn, fm);
+                g.run(MC, A, CB, fover);
+                double w = 0.0;
+                for (int i = 0; i < fm; i++)
+                    for (int j = 0; j < fn; j++) {
+                        double ref = 0.0, mag_ = 0.0;
+                        for (int p = 0; p < fk; p++) {
+                            const double t = A.template scaled_val<double>(i, p) * CB.template scaled_val<double>(p, j);
+                            ref += t;
+                            mag_ += std::abs(t);
+                        }
+                        w = std::max(w, std::abs(MC(i, j) - ref) / mag_);
+                    }
+                return w;
+            };
+            LoGemm::MXGemm<decltype(RA), decltype(CB), Lo_Gemm::Matrix<float, int>> gr;
+            LoGemm::MXGemm<decltype(CA), decltype(CB), Lo_Gemm::Matrix<float, int>> gc;
+            gr.set_blocking({16, 64, 16});
+            const double wr = mx_err(RA, gr), wc = mx_err(CA, gc);
+
+            using BA = Lo_Gemm::BFP_Matrix<8, int, int8_t>;
+            using BB = Lo_Gemm::BFP_Matrix<8, int, int8_t>;
+            std::vector<BA::value_type> ia(fm*fk), ib(fk*fn);
+            std::vector<int8_t> iea(fm*fk/9), ieb(fk*fn/32);
+            BA IA(ia.data(), iea.data(), fm, fk, fm, 9);
+            BB IB(ib.data(), ieb.data(), fk, fn, fk, 32);
+            std::vector<float> ic(fm*fn);
+            Lo_Gemm::Matrix<float, int> IC(ic.data(), fm, fn, fm);
+            LoGemm::MXGemm<BA, BB, Lo_Gemm::Matrix<float, int>> gi;
+            bool rejected = false;
+            try { gi.run(IC, IA, IB, fover); } catch (const std::invalid_argument&) { rejected = true; }
+            std::cout << "MXGemm rel err blocked / folded : " << wr << " / " << wc
+                      << "   integer scales across k rejected : " << rejected << "\n";
+            failures += wr > 1e-5 || wc > 1e-5 || !rejected;
+        }
+
+        //delayed scaling : every granularity against both layouts of X, codes against lo_cast of x/s, scales
+        //against the amaxes of the previous steps (a history of 3, so the ring buffer wraps)
+        int dmism = 0;
+        auto check_delayed = [&](auto layout_tag, Lo_Gemm::Scale_Granularity gr) {
+            constexpr Lo_Gemm::Layout LX = decltype(layout_tag)::value;
+            const int dm = 23, dn = 41, H = 3;
+            const float lim = LoGemm::mx_internal::encoder<fp8>().maxval;
+            std::vector<float> xv(dm*dn);
+            std::vector<fp8> qv(dm*dn);
+            Lo_Gemm::Matrix<float, int, LX> DX(xv.data(), dm, dn, LX == Lo_Gemm::RowMajor ? dn : dm);
+            Lo_Gemm::Matrix<fp8, int> DQ(qv.data(), dm, dn, dm);
+            LoGemm::DelayedScaling st(gr, H);
+            const int ch = gr == Lo_Gemm::perTensor ? 1 : (gr == Lo_Gemm::perRow ? dm : dn);
+            std::vector<std::vector<float>> seen;
+            for (int t = 0; t < 6; t++) {
+                std::vector<float> am(ch, 0.0f);
+                for (int i = 0; i < dm; i++)
+                    for (int j = 0; j < dn; j++) {
+                        DX(i, j) = std::exp2(0.5f*t*(i % 3) + 0.1f*mag(gen)) * dist(gen);
+                        float& a = am[gr == Lo_Gemm::perTensor ? 0 : (gr == Lo_Gemm::perRow ? i : j)];
+                        a = std::max(a, std::abs(DX(i, j)));
+                    }
+                LoGemm::scaled_quantize(DX, DQ, st);
+                for (int c = 0; c < ch; c++) {
+                    float h = t == 0 ? am[c] : 0.0f;
+                    for (int k = std::max(0, t - H); k < t; k++) h = std::max(h, seen[k][c]);
+                    dmism += st.scale(c) != h / lim || st.amax(c) != am[c];
+                }
+                seen.push_back(am);
+                for (int i = 0; i < dm; i++)
+                    for (int j = 0; j < dn; j++) {
+                        const float s = st.scale(gr == Lo_Gemm::perTensor ? 0 : (gr == Lo_Gemm::perRow ? i : j));
+                        const float v = DX(i, j) * (1.0f / s);
+                        dmism += static_cast<float>(DQ(i, j)) != std::copysign(static_cast<float>(LoGemm::lo_cast<fp8>(std::min(std::abs(v), lim))), v);
+                    }
+            }
+            std::vector<float> dd(dm*dn);
+            Lo_Gemm::Matrix<float, int> DD(dd.data(), dm, dn, dm);
+            LoGemm::scaled_dequantize(DQ, st, DD);
+            for (int i = 0; i < dm; i++)
+                for (int j = 0; j < dn; j++)
+                    dmism += DD(i, j) != static_cast<float>(DQ(i, j)) * st.scale(gr == Lo_Gemm::perTensor ? 0 : (gr == Lo_Gemm::perRow ? i : j));
+        };
+        for (auto gr : {Lo_Gemm::perTensor, Lo_Gemm::perRow, Lo_Gemm::perColumn}) {
+            check_delayed(std::integral_constant<Lo_Gemm::Layout, Lo_Gemm::RowMajor>{}, gr);
+            check_delayed(std::integral_constant<Lo_Gemm::Layout, Lo_Gemm::ColMajor>{}, gr);
+        }
+        std::cout << "delayed scaling mismatches : " << dmism << "\n";
+        failures += dmism != 0;
+
+        //adaptive tiles : tiles of growing dynamic range pick wider formats, every tile within the bound (or in the
+        //widest format), element access / bulk decode / GEMM agree
+        {
+            const int am = 70, ak = 90, an = 33;
+            const float tol = 0.13f;
+            std::vector<float> xa(am*ak), xb(ak*an);
+            Lo_Gemm::Matrix<float, int> XA(xa.data(), am, ak, am), XB(xb.data(), ak, an, ak);
+            for (int i = 0; i < am; i++)
+                for (int p = 0; p < ak; p++)
+                    XA(i, p) = i < 32 ? std::exp2(static_cast<float>(p % 3)) * (p % 2 ? -1.0f : 1.0f)          //e2m1 exactly
+                             : i < 64 ? 0.5f + 0.5f*std::abs(dist(gen))                                        //one binade
+                             : std::exp2((p < 64 ? 0.3f : 0.6f)*mag(gen)) * (dist(gen) < 0 ? -1.0f : 1.0f);   //12 / 24 binades
+            for (auto& v : xb) v = dist(gen);
+            using AT = Lo_Gemm::Adaptive_Matrix<int, Lo_Gemm::RowMajor, float4_e2m1<>, float6_e3m2<>, fp8, bfloat16<>>;
+            AT AA(am, ak);
+            LoGemm::adaptive_quantize(XA, AA, tol);
+
+            std::vector<float> xd(am*ak);
+            Lo_Gemm::Matrix<float, int> XD(xd.data(), am, ak, am);
+            LoGemm::adaptive_decode(AA, XD);
+            int amism = 0, used[4] = {};
+            for (int ti = 0; ti < AA.tile_rows(); ti++)
+                for (int tj = 0; tj < AA.tile_cols(); tj++) {
+                    const auto& h = AA.headers[AA.tile_index(ti, tj)];
+                    used[h.format]++;
+                    float err = 0.0f;
+                    for (int i = ti*32; i < std::min(am, ti*32 + 32); i++)
+                        for (int p = tj*32; p < std::min(ak, tj*32 + 32); p++) {
+                            err = std::max(err, std::abs(XD(i, p) - XA(i, p)) / std::abs(XA(i, p)));
+                            amism += AA(i, p) != XD(i, p);
+                        }
+                    amism += h.format + 1 < 4 && err > tol;
+                }
+            amism += (used[0] == 0) + (used[1] == 0) + (used[2] == 0) + (used[3] == 0);
+
+            std::vector<float> ca(am*an);
+            Lo_Gemm::Matrix<float, int> CA(ca.data(), am, an, am);
+            LoGemm::adaptive_gemm(CA, AA, XB, fover);
+            double aworst = 0.0;
+            for (int i = 0; i < am; i++)
+                for (int j = 0; j < an; j++) {
+                    double ref = 0.0, mag_ = 0.0;
+                    for (int p = 0; p < ak; p++) {
+                        ref += static_cast<double>(XD(i, p)) * XB(p, j);
+                        mag_ += std::abs(static_cast<double>(XD(i, p)) * XB(p, j));
+                    }
+                    aworst = std::max(aworst, std::abs(CA(i, j) - ref) / mag_);
+                }
+
+            //a per row bias must follow the rows of every strip of tiles, not restart at each one
+            std::vector<float> cbias(am*an), rbias(am);
+            for (int i = 0; i < am; i++) rbias[i] = static_cast<float>(i);
+            Lo_Gemm::Matrix<float, int> CBias(cbias.data(), am, an, am);
+            LoGemm::epilogue_for_t<float, float> ebias;
+            ebias.beta = 0;
+            ebias.bias = rbias.data();
+            ebias.bias_mode = LoGemm::BiasMode::PerRow;
+            LoGemm::adaptive_gemm(CBias, AA, XB, ebias);
+            for (int i = 0; i < am; i++)
+                for (int j = 0; j < an; j++) amism += std::abs(CBias(i, j) - CA(i, j) - rbias[i]) > 1e-5f*(std::abs(CA(i, j)) + rbias[i]);
+            std::cout << "adaptive tiles e2m1/e3m2/e4m3/bf16 : " << used[0] << "/" << used[1] << "/" << used[2] << "/" << used[3]
+                      << "   bytes " << AA.bytes() << " (e4m3 " << am*ak << ")   mismatches : " << amism << "   GEMM rel err : " << aworst << "\n";
+            failures += amism != 0 || aworst > 1e-5;
+        }
+    }
+
+    //Gemv with a double accumulator and y against a double reference, in the axpy form (column major A) and the dot
+    //form (op(A) = Aᵀ, contiguous rows), then Ger in both layouts : one rounding of the double update into A
+    {
+        const int gm = 70, gk = 300;
+        std::vector<fp8> ga(gm*gk), gx(gk), gxt(gm);
+        for (auto& v : ga) v = fp8(dist(gen));
+        for (auto& v : gx) v = fp8(dist(gen));
+        for (auto& v : gxt) v = fp8(dist(gen));
+        Lo_Gemm::Matrix<fp8, int> GA(ga.data(), gm, gk, gm);
+        Lo_Gemm::Vector<fp8, int> GX(gx.data(), gk), GXT(gxt.data(), gm);
+        LoGemm::Gemv<decltype(GA), Lo_Gemm::Vector<fp8, int>, Lo_Gemm::Vector<double, int>, double, double> gv;
+        gv.set_kc(64);
+        const double ga_alpha = 0.75, ga_beta = -0.5;
+        double gvw = 0.0;
+        for (auto op : {Lo_Gemm::NoTrans, Lo_Gemm::Trans}) {
+            const int ym = op == Lo_Gemm::NoTrans ? gm : gk, yk = op == Lo_Gemm::NoTrans ? gk : gm;
+            std::vector<double> gy(ym), gy0(ym);
+            for (auto& v : gy0) v = dist(gen);
+            gy = gy0;
+            Lo_Gemm::Vector<double, int> GY(gy.data(), ym);
+            gv.run(GY, GA, op == Lo_Gemm::NoTrans ? GX : GXT, op, ga_alpha, ga_beta);
+            for (int i = 0; i < ym; i++) {
+                double ref = ga_beta*gy0[i], mag_ = std::abs(ga_beta*gy0[i]);
+                for (int p = 0; p < yk; p++) {
+                    const double t = ga_alpha * static_cast<double>(op == Lo_Gemm::NoTrans ? GA(i, p) : GA(p, i))
+                                   * static_cast<double>(op == Lo_Gemm::NoTrans ? GX[p] : GXT[p]);
+                    ref += t;
+                    mag_ += std::abs(t);
+                }
+                gvw = std::max(gvw, std::abs(GY[i] - ref) / mag_);
+            }
+        }
+
+        int germ = 0;
+        const int gn = 41;
+        std::vector<float> fx(gm), fy(gn), gc(gm*gn), gr(gm*gn), g0(gm*gn);
+        for (auto& v : fx) v = dist(gen);
+        for (auto& v : fy) v = dist(gen);
+        for (auto& v : g0) v = dist(gen);
+        Lo_Gemm::Matrix<float, int> GC(gc.data(), gm, gn, gm);
+        Lo_Gemm::Matrix<float, int, Lo_Gemm::RowMajor> GR(gr.data(), gm, gn, gn);
+        for (int i = 0; i < gm; i++)
+            for (int j = 0; j < gn; j++) GC(i, j) = GR(i, j) = g0[i*gn + j];
+        Lo_Gemm::Vector<float, int> FX(fx.data(), gm), FY(fy.data(), gn);
+        LoGemm::Ger<decltype(GC), Lo_Gemm::Vector<float, int>, Lo_Gemm::Vector<float, int>> gerc;
+        LoGemm::Ger<decltype(GR), Lo_Gemm::Vector<float, int>, Lo_Gemm::Vector<float, int>> gerr;
+        gerc.run(GC, FX, FY, 0.3f);
+        gerr.run(GR, FX, FY, 0.3f);
+        for (int i = 0; i < gm; i++)
+            for (int j = 0; j < gn; j++) {
+                const double ref = static_cast<double>(g0[i*gn + j]) + static_cast<double>(0.3f)*fx[i]*fy[j];
+                germ += std::abs(GC(i, j) - ref) > std::abs(ref)*0x1p-24*1.000001 || GR(i, j) != GC(i, j);
+            }
+        std::cout << "Gemv double accumulation rel err : " << gvw << "   Ger mismatches : " << germ << "\n";
+        failures += gvw > 1e-13 || germ != 0;
+    }
+
+    //integer GEMM : packed int4 × int4 requantized per column into int8, uint8 × int8 with zero points into int32,
+    //int12 × int10 through int16 panels, small blocks so that every path crosses KC and NC panels
+    {
+        using i4 = lo_float::int4;
+        std::uniform_int_distribution<int> q(-1000, 1000);
+        int imism = 0;
+
+        lo_float::packed_int4 pa(m*k);
+        std::vector<i4> vb(k*n);
+        for (int t = 0; t < m*k; t++) pa.set(t, i4(q(gen) % 8));
+        for (auto& x : vb) x = i4(q(gen) % 8);
+        Lo_Gemm::Int4_Matrix<int, Lo_Gemm::RowMajor> PA(&pa, m, k, k);
+        Lo_Gemm::Matrix<i4, int> VB(vb.data(), k, n, k);
+        std::vector<lo_float::int_n<8>> c4(m*n);
+        Lo_Gemm::Matrix<lo_float::int_n<8>, int> C4(c4.data(), m, n, m);
+        std::vector<float> cs(n);
+        std::vector<int32_t> rb(m);
+        for (auto& x : cs) x = 0.01f + 0.0001f*(q(gen) + 1000);
+        for (auto& x : rb) x = q(gen);
+        LoGemm::Requantize<float> rq;
+        rq.scales = cs.data();
+        rq.granularity = Lo_Gemm::perColumn;
+        rq.bias = rb.data();
+        rq.bias_mode = LoGemm::BiasMode::PerRow;
+        rq.zero_point = 3;
+        LoGemm::IntGemm<decltype(PA), decltype(VB), decltype(C4)> g4;
+        g4.set_blocking({16, 64, 16});
+        g4.run(C4, PA, VB, rq);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++) {
+                int64_t acc = rb[i];
+                for (int p = 0; p < k; p++) acc += static_cast<int>(PA(i, p)) * static_cast<int>(VB(p, j));
+                const int64_t ex = std::clamp<int64_t>(static_cast<int64_t>(std::nearbyint(static_cast<float>(acc) * cs[j])) + 3, -128, 127);
+                imism += static_cast<int>(C4(i, j)) != ex;
+            }
+
+        std::vector<uint8_t> ua(m*k);
+        std::vector<int8_t> sb(n*k);
+        std::vector<int32_t> c32(m*n);
+        for (auto& x : ua) x = static_cast<uint8_t>(q(gen) & 255);
+        for (auto& x : sb) x = static_cast<int8_t>(q(gen) % 128);
+        Lo_Gemm::Matrix<uint8_t, int> UA(ua.data(), m, k, m);
+        Lo_Gemm::Matrix<int8_t, int> SB(sb.data(), n, k, n);
+        Lo_Gemm::Matrix<int32_t, int> C32(c32.data(), m, n, m);
+        LoGemm::IntGemm<decltype(UA), decltype(SB), decltype(C32)> g8;
+        g8.set_blocking({16, 64, 16});
+        g8.set_zero_points(128, -3);
+        g8.run(C32, UA, SB, Lo_Gemm::NoTrans, Lo_Gemm::Trans);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++) {
+                int64_t acc = 0;
+                for (int p = 0; p < k; p++) acc += (UA(i, p) - 128) * (SB(j, p) + 3);
+                imism += C32(i, j) != acc;
+            }
+
+        std::vector<lo_float::int_n<12>> wa(k*m);
+        std::vector<lo_float::int_n<10>> wb(k*n);
+        std::vector<lo_float::int_n<16>> c16(m*n);
+        for (auto& x : wa) x = lo_float::int_n<12>(q(gen) * 2);
+        for (auto& x : wb) x = lo_float::int_n<10>(q(gen) % 512);
+        Lo_Gemm::Matrix<lo_float::int_n<12>, int> WA(wa.data(), k, m, k);
+        Lo_Gemm::Matrix<lo_float::int_n<10>, int, Lo_Gemm::RowMajor> WB(wb.data(), k, n, n);
+        Lo_Gemm::Matrix<lo_float::int_n<16>, int> C16(c16.data(), m, n, m);
+        LoGemm::Requantize<float> rw;
+        rw.scale = 1.0f/1024;
+        rw.relu = true;
+        rw.round_mode = lo_float::Rounding_Mode::RoundTiesToAway;
+        LoGemm::IntGemm<decltype(WA), decltype(WB), decltype(C16)> g16;
+        g16.set_blocking({16, 64, 16});
+        g16.run(C16, WA, WB, rw, Lo_Gemm::Trans);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++) {
+                int64_t acc = 0;
+                for (int p = 0; p < k; p++) acc += static_cast<int64_t>(WA(p, i)) * static_cast<int64_t>(WB(p, j));
+                const int64_t ex = std::clamp<int64_t>(static_cast<int64_t>(std::round(static_cast<float>(acc) / 1024)), 0, 32767);
+                imism += static_cast<int>(C16(i, j)) != ex;
+            }
+
+        std::cout << "integer GEMM (int8 panels " << g4.int8_panels << "/" << g8.int8_panels << "/" << g16.int8_panels
+                  << ") mismatches : " << imism << "\n";
+        failures += imism != 0;
+    }
+
+    //batched GEMM : strided and grouped batches against double references, with problems small enough
+    //for the unpacked path (fp8 decoded once, float read in place) and large enough to go through Gemm
+    {
+        using BA = Lo_Gemm::Matrix<fp8, int>;
+        using BC = Lo_Gemm::Matrix<float, int>;
+        using BF = Lo_Gemm::Matrix<float, int>;
+        //max |C - op(A)·op(B)| relative to the largest |op(A)|·|op(B)| entry, C started at zero
+        auto batch_err = [](const auto& C, const auto& A, const auto& B, Lo_Gemm::Op opA, Lo_Gemm::Op opB) {
+            const int bm = C.rows(), bn = C.cols(), bk = opA == Lo_Gemm::NoTrans ? A.cols() : A.rows();
+            double err = 0.0, scale = 1e-30;
+            for (int i = 0; i < bm; i++)
+                for (int j = 0; j < bn; j++) {
+                    double acc = 0.0, mag = 0.0;
+                    for (int p = 0; p < bk; p++) {
+                        const double x = static_cast<double>(opA == Lo_Gemm::NoTrans ? A(i, p) : A(p, i))
+                                       * static_cast<double>(opB == Lo_Gemm::NoTrans ? B(p, j) : B(j, p));
+                        acc += x;
+                        mag += std::abs(x);
+                    }
+                    err = std::max(err, std::abs(static_cast<double>(C(i, j)) - acc));
+                    scale = std::max(scale, mag);
+                }
+            return err / scale;
+        };
+        double berr = 0.0;
+
+        //strided : 9 small fp8 problems (threads split the batch), 2 larger ones with op(A) = Aᵀ (one after
+        //the other, each parallel inside), 9 small float ones read straight from storage
+        {
+            const int bm = 7, bn = 10, bk = 24, batch = 9;
+            std::vector<fp8> sa(batch*bm*bk), sb(batch*bk*bn);
+            std::vector<float> sc(batch*bm*bn, 0.0f);
+            for (auto& x : sa) x = fp8(dist(gen));
+            for (auto& x : sb) x = fp8(dist(gen));
+            BA SA(sa.data(), bm, bk, bm), SB(sb.data(), bk, bn, bk);
+            BC SC(sc.data(), bm, bn, bm);
+            LoGemm::BatchedGemm<BA, BA, BC, float> bg;
+            bg.run_strided(SC, SA, SB, batch, bm*bk, bk*bn, bm*bn);
+            for (int b = 0; b < batch; b++)
+                berr = std::max(berr, batch_err(BC(sc.data() + b*bm*bn, bm, bn, bm), BA(sa.data() + b*bm*bk, bm, bk, bm),
+                                                BA(sb.data() + b*bk*bn, bk, bn, bk), Lo_Gemm::NoTrans, Lo_Gemm::NoTrans));
+        }
+        {
+            const int bm = 45, bn = 33, bk = 700, batch = 2;
+            std::vector<fp8> sa(batch*bk*bm), sb(batch*bk*bn);
+            std::vector<float> sc(batch*bm*bn, 0.0f);
+            for (auto& x : sa) x = fp8(dist(gen));
+            for (auto& x : sb) x = fp8(dist(gen));
+            BA SA(sa.data(), bk, bm, bk), SB(sb.data(), bk, bn, bk);
+            BC SC(sc.data(), bm, bn, bm);
+            LoGemm::BatchedGemm<BA, BA, BC, float> bg;
+            bg.run_strided(SC, SA, SB, batch, bk*bm, bk*bn, bm*bn, Lo_Gemm::Trans);
+            for (int b = 0; b < batch; b++)
+                berr = std::max(berr, batch_err(BC(sc.data() + b*bm*bn, bm, bn, bm), BA(sa.data() + b*bk*bm, bk, bm, bk),
+                                                BA(sb.data() + b*bk*bn, bk, bn, bk), Lo_Gemm::Trans, Lo_Gemm::NoTrans));
+        }
+        {
+            const int bm = 6, bn = 9, bk = 16, batch = 9;
+            std::vector<float> sa(batch*bm*bk), sb(batch*bn*bk), sc(batch*bm*bn, 0.0f);
+            for (auto& x : sa) x = dist(gen);
+            for (auto& x : sb) x = dist(gen);
+            BF SA(sa.data(), bm, bk, bm), SB(sb.data(), bn, bk, bn), SC(sc.data(), bm, bn, bm);
+            LoGemm::BatchedGemm<BF, BF, BF> bg;
+            bg.run_strided(SC, SA, SB, batch, bm*bk, bn*bk, bm*bn, Lo_Gemm::NoTrans, Lo_Gemm::Trans);
+            for (int b = 0; b < batch; b++)
+                berr = std::max(berr, batch_err(BF(sc.data() + b*bm*bn, bm, bn, bm), BF(sa.data() + b*bm*bk, bm, bk, bm),
+                                                BF(sb.data() + b*bn*bk, bn, bk, bn), Lo_Gemm::NoTrans, Lo_Gemm::Trans));
+        }
+
+        //grouped : every problem its own shape, a few of them too large for the unpacked path
+        {
+            const int count = 11;
+            std::vector<std::vector<fp8>> ga(count), gb(count);
+            std::vector<std::vector<float>> gc(count);
+            std::vector<BA> GA, GB;
+            std::vector<BC> GC;
+            for (int q = 0; q < count; q++) {
+                const int gm = 1 + 7*q % 23, gn = 2 + 5*q % 19, gk = q % 4 == 3 ? 400 + 13*q : 3 + 11*q % 37;
+                ga[q].resize(gm*gk);
+                gb[q].resize(gk*gn);
+                gc[q].assign(gm*gn, 0.0f);
+                for (auto& x : ga[q]) x = fp8(dist(gen));
+                for (auto& x : gb[q]) x = fp8(dist(gen));
+                GA.emplace_back(ga[q].data(), gm, gk, gm);
+                GB.emplace_back(gb[q].data(), gk, gn, gk);
+                GC.emplace_back(gc[q].data(), gm, gn, gm);
+            }
+            LoGemm::BatchedGemm<BA, BA, BC, float> bg;
+            bg.run_grouped(GC.data(), GA.data(), GB.data(), count);
+            for (int q = 0; q < count; q++)
+                berr = std::max(berr, batch_err(GC[q], GA[q], GB[q], Lo_Gemm::NoTrans, Lo_Gemm::NoTrans));
+        }
+#ifdef _OPENMP
+        //fewer small problems than threads are still spread over the threads
+        {
+            const int bm = 5, bn = 8, bk = 12, batch = 3;
+            std::vector<float> sa(batch*bm*bk), sb(batch*bk*bn), sc(batch*bm*bn, 0.0f);
+            for (auto& x : sa) x = dist(gen);
+            for (auto& x : sb) x = dist(gen);
+            BF SA(sa.data(), bm, bk, bm), SB(sb.data(), bk, bn, bk), SC(sc.data(), bm, bn, bm);
+            std::vector<BF> GA, GB, GC;
+            std::vector<float> gc(batch*bm*bn, 0.0f);
+            for (int b = 0; b < batch; b++) {
+                GA.emplace_back(sa.data() + b*bm*bk, bm, bk, bm);
+                GB.emplace_back(sb.data() + b*bk*bn, bk, bn, bk);
+                GC.emplace_back(gc.data() + b*bm*bn, bm, bn, bm);
+            }
+            const int nt = omp_get_max_threads();
+            omp_set_num_threads(4);
+            LoGemm::BatchedGemm<BF, BF, BF> bg;
+            ThreadSetEpilogue ts, tg;
+            bg.run_strided(SC, SA, SB, batch, bm*bk, bk*bn, bm*bn, ts);
+            bg.run_grouped(GC.data(), GA.data(), GB.data(), batch, tg);
+            omp_set_num_threads(nt);
+            const int used_s = __builtin_popcount(ts.threads.load()), used_g = __builtin_popcount(tg.threads.load());
+            for (int b = 0; b < batch; b++)
+                berr = std::max({berr, batch_err(GC[b], GA[b], GB[b], Lo_Gemm::NoTrans, Lo_Gemm::NoTrans),
+                                 batch_err(BF(sc.data() + b*bm*bn, bm, bn, bm), GA[b], GB[b], Lo_Gemm::NoTrans, Lo_Gemm::NoTrans)});
+            std::cout << "batched GEMM, 3 small problems on 4 threads, threads used : " << used_s << " / " << used_g << "\n";
+            failures += used_s < 2 || used_g < 2;
+        }
+#endif
+        std::cout << "batched GEMM (strided and grouped) max relative error : " << berr << "\n";
+        failures += berr > 1e-6;
+    }
+
+    //tuning database written and read back by a fresh instance, then one Autotuner pass on a scratch database
+    {
+        const std::string db_path = tuning_path + ".roundtrip";
+        std::filesystem::remove(db_path);
+        const std::string k1 = LoGemm::TuningDatabase::make_key("f32", "f32/f32", "SML", 4);
+        const std::string k2 = LoGemm::TuningDatabase::make_key("lf8m3b7s", "f32/f64", "LLL", 1);
+        const LoGemm::GemmConfig c1{"ref", 4, 4, 64, 128, 256, 1.5}, c2{"ref", 8, 4, 96, 256, 1024, 0.25};
+        int tmism = 0;
+        {
+            LoGemm::TuningDatabase db(db_path);
+            db.insert(k1, c1);
+            db.insert(k2, c2);
+            tmism += !db.save();
+        }
+        LoGemm::TuningDatabase back(db_path);
+        auto same = [](const std::optional<LoGemm::GemmConfig>& x, const LoGemm::GemmConfig& y) {
+            return x && x->kernel == y.kernel && x->MR == y.MR && x->NR == y.NR && x->MC == y.MC
+                     && x->KC == y.KC && x->NC == y.NC && x->gflops == y.gflops;
+        };
+        tmism += back.size() != 2;
+        tmism += !same(back.find(k1), c1);
+        tmism += !same(back.find(k2), c2);
+        tmism += back.find(LoGemm::TuningDatabase::make_key("f32", "f32/f32", "SSS", 4)).has_value();
+
+        //the tuned winner must be a registered kernel, recorded under the problem's key, and Gemm must
+        //still be correct once the process wide database hands it that configuration
+        using FMat = Lo_Gemm::Matrix<float, int>;
+        const int tm = 40, tn = 36, tk = 70;
+        LoGemm::TuningDatabase scratch(db_path + ".tuner");
+        LoGemm::Autotuner<FMat, FMat, FMat> tuner(scratch);
+        LoGemm::TuneOptions topt;
+        topt.reps = 1;
+        topt.save = false;
+        const LoGemm::GemmConfig best = tuner.tune(tm, tn, tk, topt);
+        using FGemm = LoGemm::Gemm<FMat, FMat, FMat>;
+        tmism += !LoGemm::find_micro_kernel<float, float>(best.kernel, best.MR, best.NR);
+        tmism += !same(scratch.find(FGemm::tuning_key(tm, tn, tk)), best);
+        //an empty problem has no rate to measure : nothing recorded, the default blocking handed back
+        const LoGemm::GemmConfig none = tuner.tune(0, tn, tk, topt);
+        tmism += scratch.size() != 1 || !none.MC || !none.KC || !none.NC;
+
+        std::vector<float> ta(tm*tk), tb(tk*tn), tc(tm*tn, 0.0f);
+        for (auto& x : ta) x = dist(gen);
+        for (auto& x : tb) x = dist(gen);
+        FMat TA(ta.data(), tm, tk, tm), TB(tb.data(), tk, tn, tk), TC(tc.data(), tm, tn, tm);
+        LoGemm::tuning_database().insert(FGemm::tuning_key(tm, tn, tk), best);
+        FGemm tuned;
+        tuned.run(TC, TA, TB);
+        double terr = 0.0;
+        for (int i = 0; i < tm; i++)
+            for (int j = 0; j < tn; j++) {
+                double acc = 0.0;
+                for (int p = 0; p < tk; p++) acc += static_cast<double>(ta[i + p*tm]) * tb[p + j*tk];
+                terr = std::max(terr, std::abs(tc[i + j*tm] - acc));
+            }
+        std::cout << "tuning database round trip / autotuned " << best.kernel << " " << best.MR << "x" << best.NR
+                  << " mismatches : " << tmism << ", max error " << terr << "\n";
+        failures += tmism != 0 || terr > 1e-4;
+        std::filesystem::remove(db_path);
+    }
+
+    std::cout << (failures ? "FAILED" : "PASSED") << "\n";
+    return failures;
+}
@@ -2,10 +2,64 @@
 #include <iostream>
 #include <cstdlib>  // For rand()
 #include <ctime>    // For seeding random numbers
-#include "lo_int.h"  // Assuming this provides ml_dtypes::uint4 and int4
+#include "lo_int.h"  // Assuming this provides lo_float::uint4 and int4
+#include "lo_int_packed.h"
+#include <algorithm>
+#include <vector>
 
 using namespace std;
 
+//packed arrays against i_n element by element : unpack / pack and every elementwise op, wrapped and saturated
+template<int LEN, lo_float::Signedness S>
+int check_packed(const char* name) {
+    using P = lo_float::packed_i_n<LEN, S>;
+    using V = typename P::value_type;
+    const std::size_t n = 1000 + LEN;   //several chunks and a partial byte at the end
+    P a(n), b(n), c(n);
+    std::vector<int16_t> la(n), lb(n), lc(n);
+    for (std::size_t k = 0; k < n; k++) {
+        la[k] = static_cast<int16_t>(P::lowest + rand() % (P::highest - P::lowest + 1));
+        lb[k] = static_cast<int16_t>(P::lowest + rand() % (P::highest - P::lowest + 1));
+    }
+    lo_float::pack(la.data(), n, a);
+    lo_float::pack(lb.data(), n, b);
+
+    int bad = 0;
+    std::vector<int16_t> back(n);
+    lo_float::unpack(a, back.data());
+    for (std::size_t k = 0; k < n; k++) bad += back[k] != la[k] || static_cast<int>(a.get(k)) != la[k];
+    if constexpr (LEN < 8 || !P::is_signed) {
+        using L8 = std::conditional_t<P::is_signed, int8_t, uint8_t>;
+        std::vector<L8> b8(n);
+        lo_float::unpack(b, b8.data());
+        for (std::size_t k = 0; k < n; k++) bad += b8[k] != lb[k];
+    }
+
+    const int s = 1 + rand() % LEN;
+    for (int op = 0; op < 5; op++)
+        for (auto mode : {lo_float::Wrap, lo_float::Saturate}) {
+            if (op == 4 && mode == lo_float::Saturate) continue;
+            switch (op) {
+                case 0: lo_float::add(a, b, c, mode); break;
+                case 1: lo_float::sub(a, b, c, mode); break;
+                case 2: lo_float::mul(a, b, c, mode); break;
+                case 3: lo_float::shl(a, s, c, mode); break;
+                default: lo_float::shr(a, s, c); break;
+            }
+            lo_float::unpack(c, lc.data());
+            for (std::size_t k = 0; k < n; k++) {
+                const V x(la[k]), y(lb[k]);
+                const int64_t ex = op == 0 ? int64_t(la[k]) + lb[k] : op == 1 ? int64_t(la[k]) - lb[k]
+                                 : op == 2 ? int64_t(la[k]) * lb[k] : op == 3 ? int64_t(la[k]) * (int64_t(1) << s) : int64_t(la[k]) >> s;
+                const V w = op == 0 ? x + y : op == 1 ? x - y : op == 2 ? x * y : op == 3 ? (x << s) : (x >> s);
+                const int64_t ref = mode == lo_float::Wrap ? static_cast<int64_t>(w) : std::clamp<int64_t>(ex, P::lowest, P::highest);
+                bad += lc[k] != ref;
+            }
+        }
+    cout << "packed " << name << " mismatches : " << bad << "\n";
+    return bad != 0;
+}
+
 int main() {
     srand(time(nullptr));  // Seed random number generator
 
@@ -15,11 +69,11 @@ int main() {
         int8_t rand_s = (rand() % 16) - 8;  // [-8, 7] for int4
 
         // Cast to uint4 and int4
-        ml_dtypes::uint4 a = static_cast<ml_dtypes::uint4>(rand_u);
-        ml_dtypes::uint4 b = static_cast<ml_dtypes::uint4>(rand() % 16);
+        lo_float::uint4 a = static_cast<lo_float::uint4>(rand_u);
+        lo_float::uint4 b = static_cast<lo_float::uint4>(rand() % 16);
 
-        ml_dtypes::int4 c = static_cast<ml_dtypes::int4>(rand_s);
-        ml_dtypes::int4 d = static_cast<ml_dtypes::int4>((rand() % 16) - 8);
+        lo_float::int4 c = static_cast<lo_float::int4>(rand_s);
+        lo_float::int4 d = static_cast<lo_float::int4>((rand() % 16) - 8);
 
         // Print values
         cout << "Test " << i + 1 << ":\n";
@@ -30,15 +84,26 @@ int main() {
         cout << "  uint4  -> Add: " << static_cast<int>(a + b)
              << ", Sub: " << static_cast<int>(a - b)
              << ", Mul: " << static_cast<int>(a * b)
-             << ", Div: " << (b != 0 ? static_cast<int>(a / b) : -1) << "\n";
+             << ", Div: " << (b != lo_float::uint4(0) ? static_cast<int>(a / b) : -1) << "\n";
 
         cout << "  int4   -> Add: " << static_cast<int>(c + d)
              << ", Sub: " << static_cast<int>(c - d)
              << ", Mul: " << static_cast<int>(c * d)
-             << ", Div: " << (d != 0 ? static_cast<int>(c / d) : -1) << "\n";
+             << ", Div: " << (d != lo_float::int4(0) ? static_cast<int>(c / d) : -1) << "\n";
 
         cout << "--------------------------------\n";
     }
 
-    return 0;
+    int failures = 0;
+    failures += check_packed<2, lo_float::Signed>("int2");
+    failures += check_packed<2, lo_float::Unsigned>("uint2");
+    failures += check_packed<3, lo_float::Signed>("int3");
+    failures += check_packed<4, lo_float::Signed>("int4");
+    failures += check_packed<4, lo_float::Unsigned>("uint4");
+    failures += check_packed<5, lo_float::Unsigned>("uint5");
+    failures += check_packed<7, lo_float::Signed>("int7");
+    failures += check_packed<8, lo_float::Signed>("int8");
+    failures += check_packed<8, lo_float::Unsigned>("uint8");
+    cout << (failures ? "FAILED" : "PASSED") << "\n";
+    return failures;
 }